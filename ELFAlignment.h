@@ -0,0 +1,294 @@
+#include "stdafx.h"
+
+#ifndef ELFAlignment_H
+#define ELFAlignment_H
+class ELFAlignment
+{
+public:
+	explicit ELFAlignment(string);
+	~ELFAlignment();
+	bool IsReady();
+
+	/*   Options   */
+	void setTopCount(unsigned int);
+
+	/*   Print alignment, padding and boundary crossings of the functions   */
+	void readAlignment();
+private:
+	/*   A function placed in an executable section.   */
+	typedef ELFImage::FUNCTION_SYMBOL ALIGN_FUNCTION;
+
+	/*   Contents of the bytes between two functions.   */
+	typedef struct GapBytes {
+		unsigned long long nop;
+		unsigned long long int3;
+		unsigned long long zero;
+		unsigned long long code;		// Anything else, code without a symbol.
+	} GAP_BYTES;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+	unsigned int topCount = 10;
+
+	vector<ALIGN_FUNCTION> Functions;
+
+	static constexpr unsigned long long CACHE_LINE = 64;
+	static constexpr unsigned long long PAGE_SIZE = 4096;
+
+	void collectFunctions();
+	void classifyGap(const unsigned char*, unsigned long long, GAP_BYTES&);
+};
+#endif // !~ ELFAlignment_H
+
+/*   Constructor with string of filename.   */
+ELFAlignment::ELFAlignment(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFAlignment: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short machine = this->image->getMachine();
+	if (machine != EM_X86_64 && machine != EM_386)
+	{
+		printf("ELFAlignment: Only x86 and x86-64 padding can be decoded!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFAlignment::~ELFAlignment()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFAlignment::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFAlignment::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+
+/*   Collects the sized functions of the executable sections, sorted by
+	section and offset with one entry per address.   */
+void ELFAlignment::collectFunctions()
+{
+	this->image->readFunctionSymbols(this->Functions);
+}
+
+/*   Sorts the bytes of a gap into NOPs, INT3, zero fill and other code.
+	NOPs are 90 with any 66 prefixes and the multi-byte 0F 1F forms.   */
+void ELFAlignment::classifyGap(const unsigned char* code, unsigned long long size, GAP_BYTES& bytes)
+{
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+
+	unsigned long long offset = 0;
+	while (offset < size)
+	{
+		unsigned char b = code[offset];
+		if (b == 0xCC)
+		{
+			bytes.int3++;
+			offset++;
+			continue;
+		}
+		if (b == 0x00)
+		{
+			bytes.zero++;
+			offset++;
+			continue;
+		}
+
+		X86Decoder::X86_INSTRUCTION instruction;
+		if (X86Decoder::Decode(code + offset, size - offset, is64, instruction) == false)
+		{
+			bytes.code++;
+			offset++;
+			continue;
+		}
+
+		bool nop = instruction.encoding == X86Decoder::LEGACY && instruction.repz == false &&
+			((instruction.map == 0 && instruction.opcode == 0x90 && (instruction.rex & 1) == 0) ||
+			(instruction.map == 1 && instruction.opcode == 0x1F && ((instruction.modrm >> 3) & 7) == 0));
+		if (nop == true)
+			bytes.nop += instruction.length;
+		else
+			bytes.code += instruction.length;
+		offset += instruction.length;
+	}
+}
+
+/*   Prints the entry alignment histogram, the bytes between functions by
+	kind, the entries that straddle a cache line or page, and what the
+	current code would pad to at common -falign-functions values.   */
+void ELFAlignment::readAlignment()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	collectFunctions();
+	if (this->Functions.empty())
+	{
+		printf("ELFAlignment: No sized function symbols in executable sections!\n\n");
+		return;
+	}
+
+	// Alignment histogram, entries by the largest power of two they sit on.
+	const int buckets = 13;
+	unsigned long long alignments[buckets] = { 0 };
+	unsigned long long lineCrossings = 0, smallCrossings = 0, pageCrossings = 0, smallFunctions = 0;
+	bool relocatable = (this->image->getType() == ET_REL);
+
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		ALIGN_FUNCTION& function = this->Functions[i];
+		unsigned long long address = function.address;
+		unsigned long long alignment = address & (~address + 1);
+		// In objects the section alignment caps what the offset shows.
+		unsigned long long sectionAlign = this->image->SectionHeaders[function.section].sh_addralign;
+		if (relocatable == true && (alignment == 0 || (sectionAlign > 0 && alignment > sectionAlign)))
+			alignment = (sectionAlign > 0) ? sectionAlign : 1;
+
+		int bucket = 0;
+		while (bucket + 1 < buckets && (1ULL << (bucket + 1)) <= alignment && alignment != 0)
+			bucket++;
+		if (alignment == 0)
+			bucket = buckets - 1;
+		alignments[bucket]++;
+
+		// The entry is the first cache line worth of the function.
+		unsigned long long entry = min(function.size, CACHE_LINE);
+		if (address % CACHE_LINE + entry > CACHE_LINE)
+		{
+			lineCrossings++;
+			if (function.size <= CACHE_LINE)
+				smallCrossings++;
+		}
+		if (address % PAGE_SIZE + entry > PAGE_SIZE)
+			pageCrossings++;
+		if (function.size <= CACHE_LINE)
+			smallFunctions++;
+	}
+
+	printf("Function entry alignment:\n");
+	printf("  Alignment\tFunctions\tShare\n");
+	for (int i = 0; i < buckets; i++)
+	{
+		if (alignments[i] == 0)
+			continue;
+		printf("  %llu%s\t\t%9llu\t%5.1f%%\n", 1ULL << i, (i == buckets - 1) ? "+" : "", alignments[i],
+			100.0 * alignments[i] / this->Functions.size());
+	}
+
+	// Gaps between consecutive functions, and before the first and after
+	//  the last of each section.
+	GAP_BYTES total;
+	memset(&total, 0, sizeof(total));
+	vector<pair<unsigned long long, int> > codeGaps;
+	unsigned long long functionBytes = 0;
+
+	int current = -1;
+	const unsigned char* data = NULL;
+	unsigned long long position = 0;
+	for (unsigned long long i = 0; i <= this->Functions.size(); i++)
+	{
+		bool sectionEnd = (i == this->Functions.size() || this->Functions[i].section != current);
+		if (sectionEnd == true && current >= 0 && data != NULL)
+		{
+			unsigned long long sectionSize = this->image->SectionHeaders[current].sh_size;
+			if (position < sectionSize)
+			{
+				GAP_BYTES gap;
+				memset(&gap, 0, sizeof(gap));
+				classifyGap(data + position, sectionSize - position, gap);
+				total.nop += gap.nop; total.int3 += gap.int3; total.zero += gap.zero; total.code += gap.code;
+				if (gap.code > 0)
+					codeGaps.push_back(make_pair(gap.code, i - 1));
+			}
+		}
+		if (i == this->Functions.size())
+			break;
+
+		ALIGN_FUNCTION& function = this->Functions[i];
+		if (sectionEnd == true)
+		{
+			current = function.section;
+			data = (const unsigned char*)this->image->mapSection(current);
+			position = 0;
+		}
+		if (data == NULL)
+			continue;
+
+		if (function.offset > position)
+		{
+			GAP_BYTES gap;
+			memset(&gap, 0, sizeof(gap));
+			classifyGap(data + position, function.offset - position, gap);
+			total.nop += gap.nop; total.int3 += gap.int3; total.zero += gap.zero; total.code += gap.code;
+			if (gap.code > 0)
+				codeGaps.push_back(make_pair(gap.code, i));
+		}
+
+		// Nested or overlapping symbols only advance past their end.
+		if (function.offset + function.size > position)
+		{
+			functionBytes += function.offset + function.size - max(position, function.offset);
+			position = function.offset + function.size;
+		}
+	}
+
+	unsigned long long padding = total.nop + total.int3 + total.zero;
+	printf("\nBytes between functions:\n");
+	printf("  Functions:\t\t%12llu\n", functionBytes);
+	printf("  NOP padding:\t\t%12llu\n", total.nop);
+	printf("  INT3 padding:\t\t%12llu\n", total.int3);
+	printf("  Zero fill:\t\t%12llu\n", total.zero);
+	printf("  Unattributed code:\t%12llu\n", total.code);
+	printf("  Padding is %.2f%% of the executable bytes\n", 100.0 * padding / (functionBytes + padding + total.code));
+
+	sort(codeGaps.begin(), codeGaps.end(), [](const pair<unsigned long long, int>& a, const pair<unsigned long long, int>& b)
+	{
+		return a.first > b.first;
+	});
+	if (codeGaps.empty() == false)
+	{
+		printf("\n  Largest unattributed code, by the nearest function:\n");
+		for (unsigned long long i = 0; i < codeGaps.size() && i < this->topCount; i++)
+			printf("  %12llu\t%s\n", codeGaps[i].first, this->Functions[codeGaps[i].second].name.c_str());
+	}
+
+	printf("\nEntry boundary crossings (first %llu bytes):\n", CACHE_LINE);
+	printf("  %llu entries cross a %llu byte cache line, %llu of %llu functions that fit in one line\n",
+		lineCrossings, CACHE_LINE, smallCrossings, smallFunctions);
+	printf("  %llu entries cross a %llu byte page\n", pageCrossings, PAGE_SIZE);
+
+	// The same functions laid out back to back at each alignment.
+	printf("\nProjected padding at -falign-functions:\n");
+	const unsigned long long choices[] = { 1, 16, 32, 64 };
+	for (int c = 0; c < 4; c++)
+	{
+		unsigned long long address = 0, wasted = 0;
+		for (unsigned long long i = 0; i < this->Functions.size(); i++)
+		{
+			unsigned long long aligned = (address + choices[c] - 1) / choices[c] * choices[c];
+			wasted += aligned - address;
+			address = aligned + this->Functions[i].size;
+		}
+		printf("  %2llu:\t%12llu bytes\n", choices[c], wasted);
+	}
+	printf("\n");
+}
@@ -0,0 +1,406 @@
+#include "stdafx.h"
+
+#ifndef ELFArchive_H
+#define ELFArchive_H
+class ELFArchive
+{
+public:
+	explicit ELFArchive(string);
+	~ELFArchive();
+	bool IsReady();
+	static bool IsArchive(string);
+
+	/*   Print archive contents   */
+	void readIndex();
+	void readAllSymbols();
+private:
+	/*   One member of the archive.   */
+	typedef struct ArchiveMember {
+		string name;				// Resolved member name.
+		unsigned long long headerOffset;	// Offset of the ar header.
+		unsigned long long dataOffset;		// Offset of the member data.
+		unsigned long long size;		// Size of the member data.
+	} ARCHIVE_MEMBER;
+
+	/*   One entry of the archive symbol index.   */
+	typedef struct ArchiveSymbol {
+		string name;				// Symbol name.
+		unsigned long long headerOffset;	// Header of the defining member.
+	} ARCHIVE_SYMBOL;
+
+	int fileDescriptor = -1;
+	ELFMapping* mapping = NULL;
+	bool InvalidFormat = false;
+
+	// Long name tables: GNU "//" member, BSD names live in the member itself.
+	unsigned long long longNamesOffset = 0;
+	unsigned long long longNamesSize = 0;
+
+	vector<ARCHIVE_MEMBER> Members;
+	vector<ARCHIVE_SYMBOL> Index;
+
+	bool indexMembers();
+	string GetMemberName(string);
+	void readGNUIndex(unsigned long long, unsigned long long, unsigned int);
+	void readBSDIndex(unsigned long long, unsigned long long);
+	int GetMemberAt(unsigned long long);
+
+	string readMemberSymbols(ARCHIVE_MEMBER&, ELFMapping*);
+};
+#endif // !~ ELFArchive_H
+
+/*   Constructor with string of filename.   */
+ELFArchive::ELFArchive(string FileName)
+{
+	this->fileDescriptor = open(FileName.c_str(), O_RDONLY);
+	if (this->fileDescriptor < 0)
+	{
+		printf("ELFArchive: Failed to open file! Error code: %d\n", errno);
+		this->InvalidFormat = true;
+		return;
+	}
+
+	this->mapping = new ELFMapping(this->fileDescriptor);
+	if (indexMembers() == false)
+		this->InvalidFormat = true;
+}
+
+/*   Deconstructor of the class.   */
+ELFArchive::~ELFArchive()
+{
+	if (this->mapping != NULL)
+		delete this->mapping;
+	if (this->fileDescriptor >= 0)
+		close(this->fileDescriptor);
+}
+
+/*   Checks if the class is ready.   */
+bool ELFArchive::IsReady()
+{
+	return this->InvalidFormat == false;
+}
+
+/*   Checks the ar magic of a file.   */
+bool ELFArchive::IsArchive(string FileName)
+{
+	int fd = open(FileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	char magic[SARMAG];
+	bool status = pread(fd, magic, SARMAG, 0) == SARMAG &&
+		(memcmp(magic, ARMAG, SARMAG) == 0 || memcmp(magic, "!<thin>\n", SARMAG) == 0);
+
+	close(fd);
+	return status;
+}
+
+/*   Walks the member headers once, collecting names and the symbol index.   */
+bool ELFArchive::indexMembers()
+{
+	char magic[SARMAG];
+	if (this->mapping->read(0, magic, SARMAG) == false)
+	{
+		printf("ELFArchive: failed to read bytes from file!\n");
+		return false;
+	}
+
+	if (memcmp(magic, "!<thin>\n", SARMAG) == 0)
+	{
+		printf("ELFArchive: Thin archives are not supported, members live in other files!\n");
+		return false;
+	}
+	if (memcmp(magic, ARMAG, SARMAG) != 0)
+	{
+		printf("ELFArchive: No archive magic detected!\n");
+		return false;
+	}
+
+	unsigned long long fileSize = this->mapping->getFileSize();
+	unsigned long long position = SARMAG;
+
+	// Index members are remembered and decoded once the long names are known.
+	unsigned long long gnuIndex = 0, gnuIndexSize = 0, bsdIndex = 0, bsdIndexSize = 0;
+	unsigned int gnuWordSize = 4;
+
+	while (position + sizeof(struct ar_hdr) <= fileSize)
+	{
+		struct ar_hdr header;
+		if (this->mapping->read(position, &header, sizeof(header)) == false ||
+			memcmp(header.ar_fmag, ARFMAG, 2) != 0)
+		{
+			printf("ELFArchive: Corrupt member header at 0x%llx!\n", position);
+			return false;
+		}
+
+		string rawName(header.ar_name, sizeof(header.ar_name));
+		unsigned long long size = strtoull(string(header.ar_size, sizeof(header.ar_size)).c_str(), NULL, 10);
+		unsigned long long dataOffset = position + sizeof(struct ar_hdr);
+		if (dataOffset + size > fileSize)
+		{
+			printf("ELFArchive: Member at 0x%llx runs past the end of file!\n", position);
+			return false;
+		}
+
+		// Trim the space padding of the name field.
+		rawName.erase(rawName.find_last_not_of(' ') + 1);
+
+		if (rawName == "/")
+		{
+			gnuIndex = dataOffset;
+			gnuIndexSize = size;
+		}
+		else if (rawName == "/SYM64/")
+		{
+			gnuIndex = dataOffset;
+			gnuIndexSize = size;
+			gnuWordSize = 8;
+		}
+		else if (rawName == "//")
+		{
+			this->longNamesOffset = dataOffset;
+			this->longNamesSize = size;
+		}
+		else
+		{
+			ARCHIVE_MEMBER member;
+			member.headerOffset = position;
+			member.dataOffset = dataOffset;
+			member.size = size;
+
+			// BSD names: "#1/<length>", the name is stored before the data.
+			if (rawName.compare(0, 3, "#1/") == 0)
+			{
+				unsigned long long length = strtoull(rawName.c_str() + 3, NULL, 10);
+				if (length > size)
+					length = size;
+
+				member.name = this->mapping->readString(dataOffset, length);
+				member.dataOffset += length;
+				member.size -= length;
+			}
+			else
+				member.name = GetMemberName(rawName);
+
+			if (member.name == "__.SYMDEF" || member.name == "__.SYMDEF SORTED")
+			{
+				bsdIndex = member.dataOffset;
+				bsdIndexSize = member.size;
+			}
+			else
+				this->Members.push_back(member);
+		}
+
+		// Members are aligned to 2 bytes.
+		position = dataOffset + size + (size & 1);
+	}
+
+	if (gnuIndexSize != 0)
+		readGNUIndex(gnuIndex, gnuIndexSize, gnuWordSize);
+	else if (bsdIndexSize != 0)
+		readBSDIndex(bsdIndex, bsdIndexSize);
+
+	return true;
+}
+
+/*   Resolves a GNU member name, "/<offset>" points into the long name table.   */
+string ELFArchive::GetMemberName(string rawName)
+{
+	if (rawName.size() > 1 && rawName[0] == '/' && isdigit(rawName[1]))
+	{
+		unsigned long long offset = strtoull(rawName.c_str() + 1, NULL, 10);
+		if (offset >= this->longNamesSize)
+			return rawName;
+
+		// Long names end with "/\n".
+		string name = this->mapping->readString(this->longNamesOffset + offset, this->longNamesSize - offset);
+		size_t end = name.find("/\n");
+		if (end == string::npos)
+			end = name.find('\n');
+		return name.substr(0, end);
+	}
+
+	// Short GNU names end with a slash.
+	if (rawName.size() > 0 && rawName[rawName.size() - 1] == '/')
+		rawName.erase(rawName.size() - 1);
+	return rawName;
+}
+
+/*   Reads the GNU symbol index: count, member offsets, names (big endian).   */
+void ELFArchive::readGNUIndex(unsigned long long offset, unsigned long long size, unsigned int wordSize)
+{
+	const unsigned char* p = (const unsigned char*)this->mapping->map(offset, size);
+	if (p == NULL || size < wordSize)
+		return;
+
+	unsigned long long count = 0;
+	for (unsigned int i = 0; i < wordSize; i++)
+		count = (count << 8) | p[i];
+	if (count > (size - wordSize) / wordSize)
+		return;
+
+	const char* names = (const char*)p + wordSize + count * wordSize;
+	const char* end = (const char*)p + size;
+
+	for (unsigned long long i = 0; i < count && names < end; i++)
+	{
+		unsigned long long memberOffset = 0;
+		for (unsigned int j = 0; j < wordSize; j++)
+			memberOffset = (memberOffset << 8) | p[wordSize + i * wordSize + j];
+
+		size_t length = strnlen(names, end - names);
+
+		ARCHIVE_SYMBOL symbol;
+		symbol.name = string(names, length);
+		symbol.headerOffset = memberOffset;
+		this->Index.push_back(symbol);
+
+		names += length + 1;
+	}
+}
+
+/*   Reads the BSD __.SYMDEF index: ranlib entries and a string table.   */
+void ELFArchive::readBSDIndex(unsigned long long offset, unsigned long long size)
+{
+	const char* p = this->mapping->map(offset, size);
+	if (p == NULL || size < 4)
+		return;
+
+	unsigned int entriesSize;
+	memcpy(&entriesSize, p, 4);
+	if (4ULL + entriesSize + 4 > size)
+		return;
+
+	unsigned int stringsSize;
+	memcpy(&stringsSize, p + 4 + entriesSize, 4);
+	const char* strings = p + 4 + entriesSize + 4;
+	if (4ULL + entriesSize + 4 + stringsSize > size)
+		return;
+
+	for (unsigned int i = 0; i + 8 <= entriesSize; i += 8)
+	{
+		unsigned int nameOffset, memberOffset;
+		memcpy(&nameOffset, p + 4 + i, 4);
+		memcpy(&memberOffset, p + 4 + i + 4, 4);
+		if (nameOffset >= stringsSize)
+			continue;
+
+		ARCHIVE_SYMBOL symbol;
+		symbol.name = string(strings + nameOffset, strnlen(strings + nameOffset, stringsSize - nameOffset));
+		symbol.headerOffset = memberOffset;
+		this->Index.push_back(symbol);
+	}
+}
+
+/*   Finds the member with the given header offset, -1 if none.   */
+int ELFArchive::GetMemberAt(unsigned long long headerOffset)
+{
+	// Members are indexed in file order, so this is a binary search.
+	vector<ARCHIVE_MEMBER>::iterator it = lower_bound(this->Members.begin(), this->Members.end(), headerOffset,
+		[](const ARCHIVE_MEMBER& member, unsigned long long value) { return member.headerOffset < value; });
+	if (it == this->Members.end() || it->headerOffset != headerOffset)
+		return -1;
+
+	return it - this->Members.begin();
+}
+
+/*   Prints the members and the archive symbol index.   */
+void ELFArchive::readIndex()
+{
+	if (IsReady() == false)
+	{
+		printf("ELFArchive class not ready yet!\n");
+		return;
+	}
+
+	printf("╔╔╔═════════════════════════════════════╗╗╗\n");
+	printf("║║║┼───────────────Archive─────────────┼║║║\n");
+	printf("╚╚╚═════════════════════════════════════╝╝╝\n\n");
+
+	printf("Members:\t\t\t%lu\n", this->Members.size());
+	for (unsigned long long i = 0; i < this->Members.size(); i++)
+		printf("  Member [%llu]:\t\t\t%s (%llu bytes at 0x%llx)\n", i, this->Members[i].name.c_str(),
+			this->Members[i].size, this->Members[i].dataOffset);
+
+	printf("\nIndex symbols:\t\t\t%lu\n", this->Index.size());
+	for (unsigned long long i = 0; i < this->Index.size(); i++)
+	{
+		int member = GetMemberAt(this->Index[i].headerOffset);
+		printf("  %s\t\t%s\n", this->Index[i].name.c_str(),
+			member >= 0 ? this->Members[member].name.c_str() : "<unknown member>");
+	}
+	printf("\n");
+}
+
+/*   Prints the symbols of every member, members are parsed in parallel.   */
+void ELFArchive::readAllSymbols()
+{
+	if (IsReady() == false)
+	{
+		printf("ELFArchive class not ready yet!\n");
+		return;
+	}
+
+	ThreadPool pool;
+	unsigned int threads = pool.getThreadCount();
+
+	// Every worker gets its own windows on the same file descriptor,
+	//  mappings aren't shared between threads.
+	vector<ELFMapping*> mappings;
+	for (unsigned int i = 0; i < threads; i++)
+		mappings.push_back(new ELFMapping(this->fileDescriptor));
+
+	// Members are printed in archive order as soon as they and every
+	//  member before them are done, instead of after the whole archive.
+	printf("Counted %lu members\n\n", this->Members.size());
+	vector<string> output(this->Members.size());
+	vector<bool> done(this->Members.size(), false);
+	unsigned long long nextToPrint = 0;
+	mutex printLock;
+
+	pool.parallelFor(this->Members.size(), [&](unsigned long long index, unsigned int worker)
+	{
+		string text = readMemberSymbols(this->Members[index], mappings[worker]);
+
+		lock_guard<mutex> guard(printLock);
+		output[index] = move(text);
+		done[index] = true;
+		for (; nextToPrint < output.size() && done[nextToPrint] == true; nextToPrint++)
+		{
+			printf("Member [%llu]: %s\n", nextToPrint, this->Members[nextToPrint].name.c_str());
+			fwrite(output[nextToPrint].data(), 1, output[nextToPrint].size(), stdout);
+			fflush(stdout);
+			string().swap(output[nextToPrint]);
+		}
+	});
+
+	for (unsigned int i = 0; i < threads; i++)
+		delete mappings[i];
+}
+
+/*   Formats the symbols of one member, parsed in place in the archive.   */
+string ELFArchive::readMemberSymbols(ARCHIVE_MEMBER& member, ELFMapping* mapping)
+{
+	ELFImage image(mapping, member.dataOffset, member.size);
+	if (image.IsReady() == false)
+		return "  Not an ELF member, skipped.\n\n";
+
+	int index = image.GetIndexOfSection(".symtab");
+	vector<Elf64_Sym> symbols;
+	if (index < 0 || image.readSymbols(index, symbols) == false)
+		return "  No symbol table found!\n\n";
+
+	string text;
+	char line[512];
+
+	snprintf(line, sizeof(line), "Counted %lu symbols\n\n", symbols.size());
+	text += line;
+
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		string name = symbols[i].st_name == 0 ? "" : image.GetSymbolName(index, symbols[i]);
+		text += ELFFunction::FormatSymbol(i, symbols[i], name);
+	}
+
+	return text;
+}
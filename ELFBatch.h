@@ -0,0 +1,308 @@
+#include "stdafx.h"
+#include "ELFReader.h"
+#include "ELFEntropy.h"
+#include "ELFHardening.h"
+
+#ifndef ELFBatch_H
+#define ELFBatch_H
+class ELFBatch
+{
+public:
+	ELFBatch(string, vector<string>);
+	void setPhysicalOrder(bool);
+	void run();
+private:
+	/*   One queued input file with its on-disk location.   */
+	typedef struct BatchEntry {
+		string fileName;			// Path of the input file.
+		dev_t device;				// Device the file lives on.
+		ino_t inode;				// Inode, fallback ordering key.
+		unsigned long long physicalOffset;	// Physical offset of first extent.
+		bool hasExtent;				// FIEMAP returned an extent.
+	} BATCH_ENTRY;
+
+	/*   Byte range of a file the selected command will read.   */
+	typedef struct BatchRange {
+		unsigned long long offset;
+		unsigned long long length;
+	} BATCH_RANGE;
+
+	string command;
+	bool physicalOrder = false;
+	vector<BATCH_ENTRY> Entries;
+
+	// Number of files to read ahead of the one being dispatched.
+	static const int ADVISE_AHEAD = 16;
+
+	bool statEntry(BATCH_ENTRY&);
+	bool GetFirstExtent(int, unsigned long long&);
+	void orderByPhysicalLayout();
+	vector<BATCH_RANGE> GetNeededRanges(int);
+	void adviseEntry(BATCH_ENTRY&);
+	void dispatch(BATCH_ENTRY&);
+};
+#endif // !~ ELFBatch_H
+
+/*   Constructor with the command option and list of files.   */
+ELFBatch::ELFBatch(string command, vector<string> files)
+{
+	this->command = command;
+
+	for (unsigned long long i = 0; i < files.size(); i++)
+	{
+		BATCH_ENTRY entry;
+		entry.fileName = files[i];
+		entry.device = 0;
+		entry.inode = 0;
+		entry.physicalOffset = 0;
+		entry.hasExtent = false;
+		this->Entries.push_back(entry);
+	}
+}
+
+/*   Enables sorting the queue by device and physical extent.   */
+void ELFBatch::setPhysicalOrder(bool enabled)
+{
+	this->physicalOrder = enabled;
+}
+
+/*   Runs the command over every queued file.   */
+void ELFBatch::run()
+{
+	if (this->physicalOrder == true)
+		orderByPhysicalLayout();
+
+	// Keep a small window of read-ahead in front of the dispatcher, so the
+	//  kernel fetches the next files while the current one is printed.
+	unsigned long long advised = 0;
+	for (unsigned long long i = 0; i < this->Entries.size(); i++)
+	{
+		while (advised < this->Entries.size() && advised < i + ADVISE_AHEAD)
+		{
+			adviseEntry(this->Entries[advised]);
+			advised++;
+		}
+
+		printf("==> %s <==\n\n", this->Entries[i].fileName.c_str());
+		dispatch(this->Entries[i]);
+	}
+}
+
+/*   Gets device, inode and first physical extent of a file.   */
+bool ELFBatch::statEntry(BATCH_ENTRY& entry)
+{
+	int fd = open(entry.fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	entry.device = st.st_dev;
+	entry.inode = st.st_ino;
+	entry.hasExtent = GetFirstExtent(fd, entry.physicalOffset);
+
+	close(fd);
+	return true;
+}
+
+/*   Asks the filesystem for the physical location of the first extent.   */
+bool ELFBatch::GetFirstExtent(int fd, unsigned long long& physical)
+{
+	// Room for the request header plus a single extent.
+	char buffer[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+	memset(buffer, 0, sizeof(buffer));
+
+	struct fiemap* fm = (struct fiemap*)buffer;
+	fm->fm_start = 0;
+	fm->fm_length = FIEMAP_MAX_OFFSET;
+	fm->fm_flags = FIEMAP_FLAG_SYNC;
+	fm->fm_extent_count = 1;
+
+	// Not every filesystem supports FIEMAP (tmpfs, some network mounts).
+	if (ioctl(fd, FS_IOC_FIEMAP, fm) != 0 || fm->fm_mapped_extents == 0)
+		return false;
+
+	// Inline or delayed-allocation data has no usable physical address.
+	if (fm->fm_extents[0].fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE))
+		return false;
+
+	physical = fm->fm_extents[0].fe_physical;
+	return true;
+}
+
+/*   Sorts the queue by device, then by physical extent.   */
+void ELFBatch::orderByPhysicalLayout()
+{
+	for (unsigned long long i = 0; i < this->Entries.size(); i++)
+	{
+		if (statEntry(this->Entries[i]) == false)
+			printf("ELFBatch: Failed to stat %s! Error code: %d\n", this->Entries[i].fileName.c_str(), errno);
+	}
+
+	// Files without an extent fall back to inode order, which on most
+	//  filesystems follows allocation order closely enough.
+	stable_sort(this->Entries.begin(), this->Entries.end(),
+		[](const BATCH_ENTRY& a, const BATCH_ENTRY& b)
+		{
+			if (a.device != b.device)
+				return a.device < b.device;
+			if (a.hasExtent != b.hasExtent)
+				return a.hasExtent;
+			if (a.hasExtent == true)
+				return a.physicalOffset < b.physicalOffset;
+			return a.inode < b.inode;
+		});
+}
+
+/*   Gets the byte ranges the selected command will read from a file.   */
+vector<ELFBatch::BATCH_RANGE> ELFBatch::GetNeededRanges(int fd)
+{
+	vector<BATCH_RANGE> ranges;
+
+	// The identifier tells us which header layout follows.
+	unsigned char ident[EI_NIDENT];
+	if (pread(fd, ident, EI_NIDENT, 0) != EI_NIDENT || memcmp(ident, ELFMAG, SELFMAG) != 0)
+		return ranges;
+
+	bool wantPrograms = (this->command == "-a" || this->command == "--all" || this->command == "--hardening");
+	bool wantSymbols = (this->command == "-F" || this->command == "--functions" ||
+		this->command == "--symbols");
+	bool wantContents = (this->command == "--entropy");
+
+	unsigned long long phoff, shoff;
+	unsigned int phnum, phentsize, shnum, shentsize, shstrndx;
+
+	if (ident[EI_CLASS] == ELFCLASS32)
+	{
+		Elf32_Ehdr ehdr;
+		if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr))
+			return ranges;
+
+		phoff = ehdr.e_phoff; phnum = ehdr.e_phnum; phentsize = ehdr.e_phentsize;
+		shoff = ehdr.e_shoff; shnum = ehdr.e_shnum; shentsize = ehdr.e_shentsize;
+		shstrndx = ehdr.e_shstrndx;
+		ranges.push_back({ 0, sizeof(ehdr) });
+	}
+	else
+	{
+		Elf64_Ehdr ehdr;
+		if (pread(fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr))
+			return ranges;
+
+		phoff = ehdr.e_phoff; phnum = ehdr.e_phnum; phentsize = ehdr.e_phentsize;
+		shoff = ehdr.e_shoff; shnum = ehdr.e_shnum; shentsize = ehdr.e_shentsize;
+		shstrndx = ehdr.e_shstrndx;
+		ranges.push_back({ 0, sizeof(ehdr) });
+	}
+
+	if (wantPrograms == true)
+		ranges.push_back({ phoff, (unsigned long long)phnum * phentsize });
+
+	unsigned int expected = (ident[EI_CLASS] == ELFCLASS32) ? sizeof(Elf32_Shdr) : sizeof(Elf64_Shdr);
+	if (shnum == 0 || shentsize < expected)
+		return ranges;
+	ranges.push_back({ shoff, (unsigned long long)shnum * shentsize });
+
+	// Read the section table itself to locate the name and symbol tables.
+	vector<char> table((size_t)shnum * shentsize);
+	if (pread(fd, table.data(), table.size(), shoff) != (ssize_t)table.size())
+		return ranges;
+
+	// Normalize every entry to (type, link, offset, size).
+	vector<Elf64_Shdr> sections(shnum);
+	for (unsigned int i = 0; i < shnum; i++)
+	{
+		if (ident[EI_CLASS] == ELFCLASS32)
+		{
+			Elf32_Shdr* s = (Elf32_Shdr*)(table.data() + (size_t)i * shentsize);
+			sections[i].sh_type = s->sh_type;
+			sections[i].sh_link = s->sh_link;
+			sections[i].sh_offset = s->sh_offset;
+			sections[i].sh_size = s->sh_size;
+		}
+		else
+			sections[i] = *(Elf64_Shdr*)(table.data() + (size_t)i * shentsize);
+	}
+
+	if (shstrndx < shnum)
+		ranges.push_back({ sections[shstrndx].sh_offset, sections[shstrndx].sh_size });
+
+	if (wantContents == true)
+	{
+		for (unsigned int i = 0; i < shnum; i++)
+		{
+			if (sections[i].sh_type != SHT_NOBITS && sections[i].sh_type != SHT_NULL)
+				ranges.push_back({ sections[i].sh_offset, sections[i].sh_size });
+		}
+	}
+
+	if (wantSymbols == true)
+	{
+		for (unsigned int i = 0; i < shnum; i++)
+		{
+			if (sections[i].sh_type != SHT_SYMTAB)
+				continue;
+
+			ranges.push_back({ sections[i].sh_offset, sections[i].sh_size });
+			if (sections[i].sh_link < shnum)
+			{
+				Elf64_Shdr& strtab = sections[sections[i].sh_link];
+				ranges.push_back({ strtab.sh_offset, strtab.sh_size });
+			}
+		}
+	}
+
+	return ranges;
+}
+
+/*   Issues read-ahead for only the ranges the command needs.   */
+void ELFBatch::adviseEntry(BATCH_ENTRY& entry)
+{
+	int fd = open(entry.fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+
+	vector<BATCH_RANGE> ranges = GetNeededRanges(fd);
+	for (unsigned long long i = 0; i < ranges.size(); i++)
+	{
+		if (ranges[i].length != 0)
+			posix_fadvise(fd, ranges[i].offset, ranges[i].length, POSIX_FADV_WILLNEED);
+	}
+
+	close(fd);
+}
+
+/*   Runs the selected command on one file.   */
+void ELFBatch::dispatch(BATCH_ENTRY& entry)
+{
+	if (this->command == "--entropy")
+	{
+		printf("%s:\n", entry.fileName.c_str());
+		ELFEntropy entropy(entry.fileName);
+		entropy.readProfile();
+		return;
+	}
+
+	if (this->command == "--hardening")
+	{
+		ELFHardening hardening(entry.fileName);
+		hardening.readSummary();
+		return;
+	}
+
+	ELFReader reader(entry.fileName);
+
+	if (this->command == "-a" || this->command == "--all")
+		reader.readAllELF();
+	else if (this->command == "-S" || this->command == "--section-headers")
+		reader.readSectionHeader();
+	else if (this->command == "-F" || this->command == "--functions" || this->command == "--symbols")
+		reader.readAllSymbols();
+	else
+		printf("ELFBatch: Unsupported batch command: %s\n\n", this->command.c_str());
+}
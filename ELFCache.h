@@ -0,0 +1,217 @@
+#include "stdafx.h"
+
+#ifndef ELFCache_H
+#define ELFCache_H
+class ELFCache
+{
+public:
+	ELFCache(string, string);
+	~ELFCache();
+	bool IsReady();
+
+	string getPath();
+
+	/*   Payload of a cache entry matching the file, NULL when stale or missing   */
+	const char* load(unsigned long long&);
+	bool store(const void*, unsigned long long);
+private:
+	/*   Start of a cache file, followed by the source path padded to 8 bytes
+		and the payload. An entry is only valid for the exact file it was
+		built from.   */
+	typedef struct CacheHeader {
+		char magic[8];				// "ELFCACHE"
+		unsigned int version;
+		unsigned int pathLength;
+		unsigned long long fileSize;
+		unsigned long long modifiedSeconds;
+		unsigned long long modifiedNanoseconds;
+		unsigned long long inode;
+		unsigned long long payloadSize;
+	} CACHE_HEADER;
+
+	bool InvalidCache = false;
+	string sourcePath;
+	string cachePath;
+	CACHE_HEADER key;
+
+	char* mapped = NULL;
+	unsigned long long mappedSize = 0;
+
+	static const unsigned int VERSION = 1;
+
+	static string GetDirectory();
+	static bool CreateDirectories(string);
+	unsigned long long GetPayloadOffset();
+};
+#endif // !~ ELFCache_H
+
+/*   Constructor with the file the entry describes and the kind of data,
+	which names the entry next to the others of the same file.   */
+ELFCache::ELFCache(string FileName, string kind)
+{
+	memset(&this->key, 0, sizeof(this->key));
+
+	struct stat status;
+	char* resolved = realpath(FileName.c_str(), NULL);
+	if (resolved == NULL || stat(resolved, &status) != 0)
+	{
+		free(resolved);
+		this->InvalidCache = true;
+		return;
+	}
+	this->sourcePath = resolved;
+	free(resolved);
+
+	memcpy(this->key.magic, "ELFCACHE", 8);
+	this->key.version = VERSION;
+	this->key.pathLength = this->sourcePath.size();
+	this->key.fileSize = status.st_size;
+	this->key.modifiedSeconds = status.st_mtim.tv_sec;
+	this->key.modifiedNanoseconds = status.st_mtim.tv_nsec;
+	this->key.inode = status.st_ino;
+
+	string directory = GetDirectory();
+	if (directory.empty())
+	{
+		this->InvalidCache = true;
+		return;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "/%016llx.", XXHash64::Digest(this->sourcePath.data(), this->sourcePath.size()));
+	this->cachePath = directory + name + kind;
+}
+
+/*   Deconstructor of the class.   */
+ELFCache::~ELFCache()
+{
+	if (this->mapped != NULL)
+		munmap(this->mapped, this->mappedSize);
+}
+
+/*   Checks if the class is ready.   */
+bool ELFCache::IsReady()
+{
+	return this->InvalidCache == false;
+}
+
+/*   Path of the cache entry.   */
+string ELFCache::getPath()
+{
+	return this->cachePath;
+}
+
+/*   $XDG_CACHE_HOME/elfreader, or ~/.cache/elfreader.   */
+string ELFCache::GetDirectory()
+{
+	const char* base = getenv("XDG_CACHE_HOME");
+	if (base != NULL && base[0] == '/')
+		return string(base) + "/elfreader";
+
+	base = getenv("HOME");
+	if (base != NULL && base[0] != '\0')
+		return string(base) + "/.cache/elfreader";
+	return "";
+}
+
+/*   mkdir -p.   */
+bool ELFCache::CreateDirectories(string path)
+{
+	for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1))
+	{
+		string part = path.substr(0, slash);
+		if (mkdir(part.c_str(), 0755) != 0 && errno != EEXIST)
+			return false;
+		if (slash == string::npos)
+			return true;
+	}
+}
+
+/*   Header and path, rounded up so the payload stays 8 byte aligned.   */
+unsigned long long ELFCache::GetPayloadOffset()
+{
+	return (sizeof(CACHE_HEADER) + this->sourcePath.size() + 7) & ~7ULL;
+}
+
+/*   Maps the entry and checks it was built from this very file: same path,
+	size, modification time and inode.   */
+const char* ELFCache::load(unsigned long long& size)
+{
+	if (IsReady() == false)
+		return NULL;
+
+	int descriptor = open(this->cachePath.c_str(), O_RDONLY);
+	if (descriptor < 0)
+		return NULL;
+
+	struct stat status;
+	unsigned long long payload = GetPayloadOffset();
+	if (fstat(descriptor, &status) != 0 || (unsigned long long)status.st_size < payload)
+	{
+		close(descriptor);
+		return NULL;
+	}
+
+	this->mappedSize = status.st_size;
+	this->mapped = (char*)mmap(NULL, this->mappedSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (this->mapped == MAP_FAILED)
+	{
+		this->mapped = NULL;
+		return NULL;
+	}
+
+	CACHE_HEADER header;
+	memcpy(&header, this->mapped, sizeof(header));
+	unsigned long long payloadSize = header.payloadSize;
+	header.payloadSize = 0;
+	if (memcmp(&header, &this->key, sizeof(header)) != 0 || payloadSize != this->mappedSize - payload ||
+		memcmp(this->mapped + sizeof(header), this->sourcePath.data(), this->sourcePath.size()) != 0)
+	{
+		munmap(this->mapped, this->mappedSize);
+		this->mapped = NULL;
+		return NULL;
+	}
+
+	size = payloadSize;
+	return this->mapped + payload;
+}
+
+/*   Writes the entry beside its final name and renames it into place, so
+	a concurrent reader never sees half of it.   */
+bool ELFCache::store(const void* data, unsigned long long size)
+{
+	if (IsReady() == false)
+		return false;
+
+	size_t slash = this->cachePath.rfind('/');
+	if (CreateDirectories(this->cachePath.substr(0, slash)) == false)
+	{
+		printf("ELFCache: Failed to create %s! Error code: %d\n", this->cachePath.substr(0, slash).c_str(), errno);
+		return false;
+	}
+
+	string temporary = this->cachePath + "." + to_string(getpid());
+	FILE* output = fopen(temporary.c_str(), "wb");
+	if (output == NULL)
+	{
+		printf("ELFCache: Failed to create %s! Error code: %d\n", temporary.c_str(), errno);
+		return false;
+	}
+
+	CACHE_HEADER header = this->key;
+	header.payloadSize = size;
+	char padding[8] = { 0 };
+	unsigned long long paddingSize = GetPayloadOffset() - sizeof(header) - this->sourcePath.size();
+	bool written = fwrite(&header, sizeof(header), 1, output) == 1 &&
+		fwrite(this->sourcePath.data(), 1, this->sourcePath.size(), output) == this->sourcePath.size() &&
+		fwrite(padding, 1, paddingSize, output) == paddingSize &&
+		fwrite(data, 1, size, output) == size;
+	if (fclose(output) != 0 || written == false || rename(temporary.c_str(), this->cachePath.c_str()) != 0)
+	{
+		printf("ELFCache: Failed to write %s! Error code: %d\n", this->cachePath.c_str(), errno);
+		unlink(temporary.c_str());
+		return false;
+	}
+	return true;
+}
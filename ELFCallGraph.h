@@ -0,0 +1,519 @@
+#include "stdafx.h"
+
+#ifndef ELFCallGraph_H
+#define ELFCallGraph_H
+class ELFCallGraph
+{
+public:
+	explicit ELFCallGraph(string);
+	~ELFCallGraph();
+	bool IsReady();
+
+	/*   Options   */
+	void setTopCount(unsigned int);
+	void setOutputFile(string);
+
+	/*   Print the call graph summary and write the adjacency file   */
+	void readCallGraph();
+private:
+	/*   Function symbol, a node of the graph.   */
+	typedef ELFImage::FUNCTION_SYMBOL GRAPH_FUNCTION;
+
+	/*   Call site found by a worker.   */
+	typedef struct CallEdge {
+		unsigned int caller;
+		unsigned int callee;
+	} CALL_EDGE;
+
+	/*   Header of the adjacency file, followed by the arrays in this order:
+		unsigned long long addresses[nodes]	(0 for imports)
+		unsigned long long rows[nodes + 1]	(edge index of each caller)
+		unsigned int names[nodes]		(offset into the strings)
+		unsigned int callees[edges]
+		unsigned int callSites[edges]		(calls from the caller to the callee)
+		char strings[stringBytes]
+		Nodes below functions are functions of the binary, the rest imports.
+		Every array starts aligned to its element size, so the file can be
+		mapped and used in place.   */
+	typedef struct CallGraphHeader {
+		char magic[8];				// "ELFCSR01"
+		unsigned int nodes;
+		unsigned int functions;
+		unsigned long long edges;
+		unsigned long long stringBytes;
+	} CALL_GRAPH_HEADER;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int topCount = 10;
+	string outputFile;
+
+	unsigned long long gotAddress = 0;	// i386 PIC PLT slots are relative to it.
+
+	vector<GRAPH_FUNCTION> Functions;
+	vector<string> Imports;
+	vector<pair<unsigned long long, unsigned int> > Slots;	// GOT slot to import.
+	vector<pair<unsigned long long, unsigned int> > Stubs;	// PLT stub to import.
+	vector<const unsigned char*> SectionData;
+
+	void collectFunctions();
+	void collectImports();
+	void collectStubs();
+	bool GetSlot(const unsigned char*, const X86Decoder::X86_INSTRUCTION&, unsigned long long, unsigned long long&);
+	int FindImport(const vector<pair<unsigned long long, unsigned int> >&, unsigned long long);
+	int FindNode(unsigned long long);
+	void decodeFunction(unsigned int, vector<CALL_EDGE>&, unsigned long long&);
+	bool writeGraph(const vector<unsigned long long>&, const vector<unsigned int>&, const vector<unsigned int>&);
+};
+#endif // !~ ELFCallGraph_H
+
+/*   Constructor with string of filename.   */
+ELFCallGraph::ELFCallGraph(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFCallGraph: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short machine = this->image->getMachine();
+	if (machine != EM_X86_64 && machine != EM_386)
+	{
+		printf("ELFCallGraph: Only x86 and x86-64 code can be decoded!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short type = this->image->getType();
+	if (type != ET_EXEC && type != ET_DYN)
+	{
+		printf("ELFCallGraph: Only linked executables and shared objects have final addresses!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFCallGraph::~ELFCallGraph()
+{
+	for (unsigned long long i = 0; i < this->SectionData.size(); i++)
+		this->image->unpin((const char*)this->SectionData[i]);
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFCallGraph::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFCallGraph::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+void ELFCallGraph::setOutputFile(string FileName)
+{
+	this->outputFile = FileName;
+}
+
+/*   Collects the sized functions of the executable sections, sorted by
+	address so call targets are found by binary search.   */
+void ELFCallGraph::collectFunctions()
+{
+	this->SectionData.assign(this->image->SectionHeaders.size(), NULL);
+
+	// Sorted by address across sections.
+	this->image->readFunctionSymbols(this->Functions);
+	sort(this->Functions.begin(), this->Functions.end(), [](const GRAPH_FUNCTION& a, const GRAPH_FUNCTION& b)
+	{
+		return a.address < b.address;
+	});
+
+	// Sections are pinned here, collecting the imports and stubs maps
+	//  more of the file before the workers read them.
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		int section = this->Functions[i].section;
+		if (this->SectionData[section] == NULL)
+			this->SectionData[section] = (const unsigned char*)this->image->pinSection(section);
+	}
+}
+
+/*   Names the GOT slots the dynamic linker fills with imported functions,
+	from the JUMP_SLOT relocations of the PLT and the GLOB_DAT ones that
+	-fno-plt calls go through.   */
+void ELFCallGraph::collectImports()
+{
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+	unsigned int jumpSlot = is64 ? R_X86_64_JUMP_SLOT : R_386_JMP_SLOT;
+	unsigned int globalData = is64 ? R_X86_64_GLOB_DAT : R_386_GLOB_DAT;
+
+	unordered_map<string, unsigned int> indexes;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		string name = this->image->GetSectionName(i);
+		if (name == ".got.plt" || (name == ".got" && this->gotAddress == 0))
+			this->gotAddress = section.sh_addr;
+
+		if ((section.sh_flags & SHF_ALLOC) == 0 || (section.sh_type != SHT_REL && section.sh_type != SHT_RELA))
+			continue;
+
+		vector<Elf64_Rela> relocations;
+		vector<Elf64_Sym> symbols;
+		if (this->image->readRelocations(i, relocations) == false ||
+			section.sh_link >= this->image->SectionHeaders.size() ||
+			this->image->readSymbols(section.sh_link, symbols) == false)
+			continue;
+
+		for (unsigned long long j = 0; j < relocations.size(); j++)
+		{
+			Elf64_Rela& relocation = relocations[j];
+			unsigned long long type = ELF64_R_TYPE(relocation.r_info);
+			unsigned long long index = ELF64_R_SYM(relocation.r_info);
+			if ((type != jumpSlot && type != globalData) || index == 0 || index >= symbols.size())
+				continue;
+
+			// GLOB_DAT also covers data imports, which are never called.
+			unsigned char kind = ELF64_ST_TYPE(symbols[index].st_info);
+			if (type == globalData && kind != STT_FUNC && kind != STT_GNU_IFUNC && kind != STT_NOTYPE)
+				continue;
+
+			string symbol = this->image->GetSymbolName(section.sh_link, symbols[index]);
+			auto found = indexes.find(symbol);
+			if (found == indexes.end())
+			{
+				found = indexes.insert(make_pair(symbol, (unsigned int)this->Imports.size())).first;
+				this->Imports.push_back(symbol);
+			}
+			this->Slots.push_back(make_pair((unsigned long long)relocation.r_offset, found->second));
+		}
+	}
+	sort(this->Slots.begin(), this->Slots.end());
+}
+
+/*   Memory operand of an indirect jmp or call through a GOT slot: RIP
+	relative on x86-64, @GOT off %ebx or absolute on i386.   */
+bool ELFCallGraph::GetSlot(const unsigned char* code, const X86Decoder::X86_INSTRUCTION& instruction,
+	unsigned long long next, unsigned long long& slot)
+{
+	unsigned int reg = (instruction.modrm >> 3) & 7;
+	if (instruction.encoding != X86Decoder::LEGACY || instruction.map != 0 || instruction.opcode != 0xFF ||
+		(reg != 2 && reg != 4) || instruction.dispSize != 4)
+		return false;
+
+	int displacement;
+	memcpy(&displacement, code + instruction.dispOffset, 4);
+	if (instruction.ripRelative == true)
+		slot = next + displacement;
+	else if ((instruction.modrm >> 6) != 0)
+		slot = (unsigned int)(this->gotAddress + displacement);
+	else
+		slot = (unsigned int)displacement;
+	return true;
+}
+
+/*   Finds the stub of every PLT section (.plt, .plt.sec, .plt.got) by the
+	indirect jump through a named slot; the stub starts at the entry the
+	jump lies in.   */
+void ELFCallGraph::collectStubs()
+{
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		string name = this->image->GetSectionName(i);
+		if (name.compare(0, 4, ".plt") != 0 || section.sh_type == SHT_NOBITS || section.sh_size == 0)
+			continue;
+
+		const unsigned char* code = (const unsigned char*)this->image->mapSection(i);
+		if (code == NULL)
+			continue;
+
+		unsigned long long entrySize = (section.sh_entsize != 0) ? section.sh_entsize : 16;
+		unsigned long long offset = 0;
+		while (offset < section.sh_size)
+		{
+			X86Decoder::X86_INSTRUCTION instruction;
+			if (X86Decoder::Decode(code + offset, section.sh_size - offset, is64, instruction) == false)
+			{
+				offset++;
+				continue;
+			}
+
+			unsigned long long slot;
+			unsigned long long next = section.sh_addr + offset + instruction.length;
+			if (GetSlot(code + offset, instruction, next, slot) == true)
+			{
+				int import = FindImport(this->Slots, slot);
+				if (import >= 0)
+					this->Stubs.push_back(make_pair(section.sh_addr + offset - offset % entrySize, (unsigned int)import));
+			}
+			offset += instruction.length;
+		}
+	}
+	sort(this->Stubs.begin(), this->Stubs.end());
+}
+
+/*   Import of an address in a sorted slot or stub table, -1 if none.   */
+int ELFCallGraph::FindImport(const vector<pair<unsigned long long, unsigned int> >& table, unsigned long long address)
+{
+	auto found = lower_bound(table.begin(), table.end(), make_pair(address, 0U));
+	if (found == table.end() || found->first != address)
+		return -1;
+	return found->second;
+}
+
+/*   Node of a call target: a function starting there or the import of the
+	PLT stub, -1 otherwise.   */
+int ELFCallGraph::FindNode(unsigned long long address)
+{
+	auto found = lower_bound(this->Functions.begin(), this->Functions.end(), address,
+		[](const GRAPH_FUNCTION& function, unsigned long long value)
+	{
+		return function.address < value;
+	});
+	if (found != this->Functions.end() && found->address == address)
+		return found - this->Functions.begin();
+
+	int import = FindImport(this->Stubs, address);
+	return (import >= 0) ? this->Functions.size() + import : -1;
+}
+
+/*   Linear sweep of one function, appending its calls to the worker's own
+	buffer. Jumps leaving the function are tail calls; unresolved targets
+	(into the middle of a function, outside any) are only counted.   */
+void ELFCallGraph::decodeFunction(unsigned int index, vector<CALL_EDGE>& edges, unsigned long long& unresolved)
+{
+	GRAPH_FUNCTION& function = this->Functions[index];
+	const unsigned char* data = this->SectionData[function.section];
+	if (data == NULL)
+		return;
+
+	const unsigned char* code = data + function.offset;
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+
+	CALL_EDGE edge;
+	edge.caller = index;
+	unsigned long long offset = 0;
+	while (offset < function.size)
+	{
+		X86Decoder::X86_INSTRUCTION instruction;
+		if (X86Decoder::Decode(code + offset, function.size - offset, is64, instruction) == false)
+		{
+			offset++;
+			continue;
+		}
+
+		const unsigned char* bytes = code + offset;
+		unsigned long long next = function.address + offset + instruction.length;
+		offset += instruction.length;
+
+		int callee = -1;
+		unsigned long long slot;
+		if (instruction.relativeBranch == true)
+		{
+			unsigned long long target = next + X86Decoder::GetBranchDisplacement(bytes, instruction);
+			bool call = X86Decoder::IsCall(instruction);
+			if (call == false && target >= function.address && target < function.address + function.size)
+				continue;
+			// call next is the i386 way of reading EIP.
+			if (call == true && target == next)
+				continue;
+
+			callee = FindNode(target);
+		}
+		else if (GetSlot(bytes, instruction, next, slot) == true)
+		{
+			int import = FindImport(this->Slots, slot);
+			if (import < 0)
+				continue;
+			callee = this->Functions.size() + import;
+		}
+		else
+			continue;
+
+		if (callee < 0)
+		{
+			unresolved++;
+			continue;
+		}
+		edge.callee = callee;
+		edges.push_back(edge);
+	}
+}
+
+/*   Writes the header and arrays of the adjacency file.   */
+bool ELFCallGraph::writeGraph(const vector<unsigned long long>& rows, const vector<unsigned int>& callees,
+	const vector<unsigned int>& callSites)
+{
+	unsigned int nodes = this->Functions.size() + this->Imports.size();
+	vector<unsigned long long> addresses(nodes, 0);
+	vector<unsigned int> names(nodes);
+	string strings;
+	for (unsigned int i = 0; i < nodes; i++)
+	{
+		names[i] = strings.size();
+		if (i < this->Functions.size())
+		{
+			addresses[i] = this->Functions[i].address;
+			strings += this->Functions[i].name;
+		}
+		else
+			strings += this->Imports[i - this->Functions.size()];
+		strings += '\0';
+	}
+
+	CALL_GRAPH_HEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "ELFCSR01", 8);
+	header.nodes = nodes;
+	header.functions = this->Functions.size();
+	header.edges = callees.size();
+	header.stringBytes = strings.size();
+
+	FILE* output = fopen(this->outputFile.c_str(), "wb");
+	if (output == NULL)
+	{
+		printf("ELFCallGraph: Failed to create %s! Error code: %d\n", this->outputFile.c_str(), errno);
+		return false;
+	}
+
+	bool written = fwrite(&header, sizeof(header), 1, output) == 1 &&
+		fwrite(addresses.data(), sizeof(unsigned long long), nodes, output) == nodes &&
+		fwrite(rows.data(), sizeof(unsigned long long), nodes + 1, output) == nodes + 1 &&
+		fwrite(names.data(), sizeof(unsigned int), nodes, output) == nodes &&
+		fwrite(callees.data(), sizeof(unsigned int), callees.size(), output) == callees.size() &&
+		fwrite(callSites.data(), sizeof(unsigned int), callSites.size(), output) == callSites.size() &&
+		fwrite(strings.data(), 1, strings.size(), output) == strings.size();
+	if (fclose(output) != 0 || written == false)
+	{
+		printf("ELFCallGraph: Failed to write %s! Error code: %d\n", this->outputFile.c_str(), errno);
+		return false;
+	}
+	return true;
+}
+
+/*   Decodes every function on the pool, each worker appending to a buffer
+	of its own, then sorts the edges once and compacts repeated calls into
+	call site counts of a compressed sparse row graph.   */
+void ELFCallGraph::readCallGraph()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	collectFunctions();
+	if (this->Functions.empty())
+	{
+		printf("ELFCallGraph: No function symbols found!\n\n");
+		return;
+	}
+	collectImports();
+	collectStubs();
+
+	ThreadPool pool;
+	vector<vector<CALL_EDGE> > buffers(pool.getThreadCount());
+	vector<unsigned long long> unresolved(pool.getThreadCount(), 0);
+	pool.parallelFor(this->Functions.size(), [&](unsigned long long index, unsigned int worker)
+	{
+		decodeFunction(index, buffers[worker], unresolved[worker]);
+	});
+
+	unsigned long long total = 0, unresolvedTotal = 0;
+	for (unsigned long long i = 0; i < buffers.size(); i++)
+	{
+		total += buffers[i].size();
+		unresolvedTotal += unresolved[i];
+	}
+
+	vector<CALL_EDGE> edges;
+	edges.reserve(total);
+	for (unsigned long long i = 0; i < buffers.size(); i++)
+	{
+		edges.insert(edges.end(), buffers[i].begin(), buffers[i].end());
+		vector<CALL_EDGE>().swap(buffers[i]);
+	}
+	sort(edges.begin(), edges.end(), [](const CALL_EDGE& a, const CALL_EDGE& b)
+	{
+		return (a.caller != b.caller) ? a.caller < b.caller : a.callee < b.callee;
+	});
+
+	unsigned int nodes = this->Functions.size() + this->Imports.size();
+	vector<unsigned long long> rows(nodes + 1, 0);
+	vector<unsigned int> callees, callSites;
+	vector<unsigned int> callers(nodes, 0);
+	for (unsigned long long i = 0; i < edges.size(); i++)
+	{
+		if (i > 0 && edges[i].caller == edges[i - 1].caller && edges[i].callee == edges[i - 1].callee)
+		{
+			callSites.back()++;
+			continue;
+		}
+		callees.push_back(edges[i].callee);
+		callSites.push_back(1);
+		rows[edges[i].caller + 1]++;
+		callers[edges[i].callee]++;
+	}
+	for (unsigned int i = 0; i < nodes; i++)
+		rows[i + 1] += rows[i];
+
+	unsigned long long importCalls = 0;
+	for (unsigned long long i = 0; i < callees.size(); i++)
+	{
+		if (callees[i] >= this->Functions.size())
+			importCalls += callSites[i];
+	}
+
+	printf("Call graph:\n");
+	printf("  Nodes:\t\t%u (%zu functions, %zu imports)\n", nodes, this->Functions.size(), this->Imports.size());
+	printf("  Edges:\t\t%zu\n", callees.size());
+	printf("  Call sites:\t\t%zu (%llu to imports)\n", edges.size(), importCalls);
+	printf("  Unresolved targets:\t%llu\n", unresolvedTotal);
+	printf("  PLT stubs named:\t%zu\n\n", this->Stubs.size());
+
+	vector<unsigned int> order(nodes);
+	for (unsigned int i = 0; i < nodes; i++)
+		order[i] = i;
+
+	if (this->topCount > 0 && callees.empty() == false)
+	{
+		auto name = [&](unsigned int node) -> string
+		{
+			return (node < this->Functions.size()) ? this->Functions[node].name :
+				this->Imports[node - this->Functions.size()] + "@plt";
+		};
+
+		sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+		{
+			unsigned long long left = rows[a + 1] - rows[a], right = rows[b + 1] - rows[b];
+			return (left != right) ? left > right : a < b;
+		});
+		printf("Most callees:\n");
+		for (unsigned int i = 0; i < nodes && i < this->topCount && rows[order[i] + 1] > rows[order[i]]; i++)
+			printf("  %8llu\t%s\n", rows[order[i] + 1] - rows[order[i]], name(order[i]).c_str());
+
+		sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b)
+		{
+			return (callers[a] != callers[b]) ? callers[a] > callers[b] : a < b;
+		});
+		printf("\nMost callers:\n");
+		for (unsigned int i = 0; i < nodes && i < this->topCount && callers[order[i]] > 0; i++)
+			printf("  %8u\t%s\n", callers[order[i]], name(order[i]).c_str());
+		printf("\n");
+	}
+
+	if (this->outputFile.empty())
+		return;
+
+	if (writeGraph(rows, callees, callSites) == true)
+		printf("Adjacency written to %s (%u nodes, %zu edges)\n\n", this->outputFile.c_str(), nodes, callees.size());
+}
@@ -0,0 +1,470 @@
+#include "stdafx.h"
+
+#ifndef ELFCore_H
+#define ELFCore_H
+class ELFCore
+{
+public:
+	explicit ELFCore(string);
+	~ELFCore();
+	bool IsReady();
+
+	/*   Print core contents   */
+	void readCore();
+	void readMemory(unsigned long long, unsigned long long);
+
+	/*   Virtual address translation   */
+	bool translate(unsigned long long, unsigned long long&, unsigned long long&);
+	bool readMemory(unsigned long long, void*, unsigned long long);
+private:
+	/*   One PT_LOAD segment in the address index.   */
+	typedef struct CoreLoad {
+		unsigned long long virtualAddress;	// Start of segment in memory.
+		unsigned long long memorySize;		// Size of segment in memory.
+		unsigned long long offset;		// Offset of segment in file.
+		unsigned long long fileSize;		// Bytes present in the file.
+	} CORE_LOAD;
+
+	/*   One decoded note entry.   */
+	typedef struct CoreNote {
+		string name;				// Owner of the note ("CORE", "LINUX").
+		unsigned int type;			// NT_* type.
+		unsigned long long descOffset;		// File offset of descriptor.
+		unsigned long long descSize;		// Size of descriptor.
+	} CORE_NOTE;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	vector<CORE_LOAD> Loads;
+	vector<CORE_NOTE> Notes;
+
+	void buildLoadIndex();
+	void readNotes();
+
+	unsigned long long GetWord(const char*);
+	void printThread(const char*, unsigned long long);
+	void printProcessInfo(const char*, unsigned long long);
+	void printAuxVector(const char*, unsigned long long);
+	void printMappedFiles(const char*, unsigned long long);
+	void printSignalInfo(const char*, unsigned long long);
+};
+#endif // !~ ELFCore_H
+
+/*   Constructor with string of filename.   */
+ELFCore::ELFCore(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFCore: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	if (this->image->getType() != ET_CORE)
+	{
+		printf("ELFCore: Not a core file!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	buildLoadIndex();
+	readNotes();
+}
+
+/*   Deconstructor of the class.   */
+ELFCore::~ELFCore()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFCore::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Sorts the PT_LOAD segments by virtual address for binary search.   */
+void ELFCore::buildLoadIndex()
+{
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		if (segment.p_type != PT_LOAD || segment.p_memsz == 0)
+			continue;
+
+		CORE_LOAD load;
+		load.virtualAddress = segment.p_vaddr;
+		load.memorySize = segment.p_memsz;
+		load.offset = segment.p_offset;
+		load.fileSize = segment.p_filesz;
+		this->Loads.push_back(load);
+	}
+
+	sort(this->Loads.begin(), this->Loads.end(),
+		[](const CORE_LOAD& a, const CORE_LOAD& b) { return a.virtualAddress < b.virtualAddress; });
+}
+
+/*   Walks every PT_NOTE segment and records its entries.   */
+void ELFCore::readNotes()
+{
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		if (segment.p_type != PT_NOTE || segment.p_filesz == 0)
+			continue;
+
+		const char* notes = this->image->map(segment.p_offset, segment.p_filesz);
+		if (notes == NULL)
+		{
+			printf("ELFCore: Failed to map note segment [%llu]!\n", i);
+			continue;
+		}
+
+		// The note header has the same layout in 32 and 64 bit files, and
+		//  name and descriptor are padded to 4 bytes in core files.
+		unsigned long long position = 0;
+		while (position + sizeof(Elf64_Nhdr) <= segment.p_filesz)
+		{
+			Elf64_Nhdr header;
+			memcpy(&header, notes + position, sizeof(Elf64_Nhdr));
+			position += sizeof(Elf64_Nhdr);
+
+			unsigned long long nameSize = (header.n_namesz + 3ULL) & ~3ULL;
+			unsigned long long descSize = (header.n_descsz + 3ULL) & ~3ULL;
+			if (position + nameSize + descSize > segment.p_filesz)
+				break;
+
+			CORE_NOTE note;
+			note.name = string(notes + position, header.n_namesz > 0 ? strnlen(notes + position, header.n_namesz) : 0);
+			note.type = header.n_type;
+			note.descOffset = segment.p_offset + position + nameSize;
+			note.descSize = header.n_descsz;
+			this->Notes.push_back(note);
+
+			position += nameSize + descSize;
+		}
+	}
+}
+
+/*   Translates a virtual address to a file offset.
+	Returns the bytes available in the file from that offset, a
+	segment may be larger in memory than in the file.   */
+bool ELFCore::translate(unsigned long long address, unsigned long long& offset, unsigned long long& available)
+{
+	// Find the last segment starting at or before the address.
+	vector<CORE_LOAD>::iterator it = upper_bound(this->Loads.begin(), this->Loads.end(), address,
+		[](unsigned long long value, const CORE_LOAD& load) { return value < load.virtualAddress; });
+	if (it == this->Loads.begin())
+		return false;
+	it--;
+
+	unsigned long long delta = address - it->virtualAddress;
+	if (delta >= it->memorySize)
+		return false;
+
+	offset = it->offset + delta;
+	available = (delta < it->fileSize) ? it->fileSize - delta : 0;
+	return true;
+}
+
+/*   Reads process memory from the core, only the touched range is mapped.   */
+bool ELFCore::readMemory(unsigned long long address, void* buffer, unsigned long long size)
+{
+	char* out = (char*)buffer;
+	while (size > 0)
+	{
+		unsigned long long offset, available;
+		if (translate(address, offset, available) == false)
+			return false;
+
+		// Pages not dumped to the file read as zero.
+		if (available == 0)
+		{
+			vector<CORE_LOAD>::iterator it = upper_bound(this->Loads.begin(), this->Loads.end(), address,
+				[](unsigned long long value, const CORE_LOAD& load) { return value < load.virtualAddress; }) - 1;
+			unsigned long long zeros = it->virtualAddress + it->memorySize - address;
+			if (zeros > size)
+				zeros = size;
+
+			memset(out, 0, zeros);
+			out += zeros;
+			address += zeros;
+			size -= zeros;
+			continue;
+		}
+
+		unsigned long long chunk = (available < size) ? available : size;
+		if (this->image->read(offset, out, chunk) == false)
+			return false;
+
+		out += chunk;
+		address += chunk;
+		size -= chunk;
+	}
+
+	return true;
+}
+
+/*   Gets a word sized value in the bitsystem of the core.   */
+unsigned long long ELFCore::GetWord(const char* p)
+{
+	if (this->image->is64() == true)
+	{
+		unsigned long long value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/*   Prints all decoded notes of the core.   */
+void ELFCore::readCore()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	printf("╔╔╔═════════════════════════════════════╗╗╗\n");
+	printf("║║║┼──────────────Core File────────────┼║║║\n");
+	printf("╚╚╚═════════════════════════════════════╝╝╝\n\n");
+
+	printf("Loadable segments:\t\t%lu\n", this->Loads.size());
+	printf("Notes:\t\t\t\t%lu\n\n", this->Notes.size());
+
+	int threads = 0;
+	for (unsigned long long i = 0; i < this->Notes.size(); i++)
+	{
+		CORE_NOTE& note = this->Notes[i];
+		const char* desc = this->image->map(note.descOffset, note.descSize);
+		if (desc == NULL)
+			continue;
+
+		// Only the notes written by the kernel are decoded.
+		if (note.name != "CORE" && note.name != "LINUX")
+			continue;
+
+		switch (note.type)
+		{
+			case NT_PRSTATUS:
+				printf("Thread [%d]:\n", threads++);
+				printThread(desc, note.descSize);
+				break;
+			case NT_PRPSINFO:
+				printProcessInfo(desc, note.descSize);
+				break;
+			case NT_AUXV:
+				printAuxVector(desc, note.descSize);
+				break;
+			case NT_FILE:
+				printMappedFiles(desc, note.descSize);
+				break;
+			case NT_SIGINFO:
+				printSignalInfo(desc, note.descSize);
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+/*   Prints one NT_PRSTATUS thread entry.   */
+void ELFCore::printThread(const char* desc, unsigned long long size)
+{
+	// Offsets inside struct elf_prstatus for each bitsystem.
+	bool bit64 = this->image->is64();
+	unsigned long long pidOffset = bit64 ? 32 : 24;
+	unsigned long long registersOffset = bit64 ? 112 : 72;
+	if (size < registersOffset)
+		return;
+
+	short signal;
+	int pid, ppid;
+	memcpy(&signal, desc + 12, sizeof(signal));
+	memcpy(&pid, desc + pidOffset, sizeof(pid));
+	memcpy(&ppid, desc + pidOffset + 4, sizeof(ppid));
+
+	printf("  Thread id:\t\t\t%d\n", pid);
+	printf("  Parent id:\t\t\t%d\n", ppid);
+	printf("  Current signal:\t\t%d\n", signal);
+
+	// Program counter and stack pointer, from the x86 register sets.
+	unsigned int wordSize = bit64 ? 8 : 4;
+	int pcIndex = -1, spIndex = -1;
+	if (this->image->getMachine() == EM_X86_64)
+	{
+		pcIndex = 16;
+		spIndex = 19;
+	}
+	else if (this->image->getMachine() == EM_386)
+	{
+		pcIndex = 12;
+		spIndex = 15;
+	}
+
+	if (pcIndex >= 0 && registersOffset + (spIndex + 1) * wordSize <= size)
+	{
+		printf("  Program counter:\t\t0x%llx\n", GetWord(desc + registersOffset + pcIndex * wordSize));
+		printf("  Stack pointer:\t\t0x%llx\n", GetWord(desc + registersOffset + spIndex * wordSize));
+	}
+	printf("\n");
+}
+
+/*   Prints the NT_PRPSINFO process entry.   */
+void ELFCore::printProcessInfo(const char* desc, unsigned long long size)
+{
+	// Offsets inside struct elf_prpsinfo for each bitsystem.
+	bool bit64 = this->image->is64();
+	unsigned long long pidOffset = bit64 ? 24 : 12;
+	unsigned long long nameOffset = bit64 ? 40 : 28;
+	if (size < nameOffset + 16 + 80)
+		return;
+
+	int pid;
+	memcpy(&pid, desc + pidOffset, sizeof(pid));
+
+	printf("Process:\n");
+	printf("  State:\t\t\t%c\n", desc[1] != 0 ? desc[1] : '?');
+	printf("  Process id:\t\t\t%d\n", pid);
+	printf("  Name:\t\t\t\t%s\n", string(desc + nameOffset, strnlen(desc + nameOffset, 16)).c_str());
+	printf("  Arguments:\t\t\t%s\n\n", string(desc + nameOffset + 16, strnlen(desc + nameOffset + 16, 80)).c_str());
+}
+
+/*   Prints the NT_AUXV auxiliary vector.   */
+void ELFCore::printAuxVector(const char* desc, unsigned long long size)
+{
+	unsigned int wordSize = this->image->is64() ? 8 : 4;
+
+	printf("Auxiliary vector:\n");
+	for (unsigned long long i = 0; i + 2 * wordSize <= size; i += 2 * wordSize)
+	{
+		unsigned long long type = GetWord(desc + i);
+		unsigned long long value = GetWord(desc + i + wordSize);
+		if (type == AT_NULL)
+			break;
+
+		switch (type)
+		{
+			case AT_PHDR:
+				printf("  AT_PHDR:\t\t\t0x%llx\n", value);
+				break;
+			case AT_PHNUM:
+				printf("  AT_PHNUM:\t\t\t%llu\n", value);
+				break;
+			case AT_PAGESZ:
+				printf("  AT_PAGESZ:\t\t\t%llu\n", value);
+				break;
+			case AT_BASE:
+				printf("  AT_BASE:\t\t\t0x%llx\n", value);
+				break;
+			case AT_ENTRY:
+				printf("  AT_ENTRY:\t\t\t0x%llx\n", value);
+				break;
+			case AT_UID:
+				printf("  AT_UID:\t\t\t%llu\n", value);
+				break;
+			case AT_EXECFN:
+				printf("  AT_EXECFN:\t\t\t0x%llx\n", value);
+				break;
+			case AT_SYSINFO_EHDR:
+				printf("  AT_SYSINFO_EHDR:\t\t0x%llx\n", value);
+				break;
+			default:
+				printf("  Type %llu:\t\t\t0x%llx\n", type, value);
+				break;
+		}
+	}
+	printf("\n");
+}
+
+/*   Prints the NT_FILE table of mapped files.   */
+void ELFCore::printMappedFiles(const char* desc, unsigned long long size)
+{
+	unsigned int wordSize = this->image->is64() ? 8 : 4;
+	if (size < 2 * wordSize)
+		return;
+
+	unsigned long long count = GetWord(desc);
+	unsigned long long pageSize = GetWord(desc + wordSize);
+
+	// Count entries of (start, end, page offset), followed by the names.
+	unsigned long long entries = 2 * wordSize;
+	unsigned long long names = entries + count * 3 * wordSize;
+	if (count > size / (3 * wordSize) || names > size)
+		return;
+
+	printf("Mapped files:\t\t\t%llu\n", count);
+	for (unsigned long long i = 0; i < count && names < size; i++)
+	{
+		const char* entry = desc + entries + i * 3 * wordSize;
+		unsigned long long start = GetWord(entry);
+		unsigned long long end = GetWord(entry + wordSize);
+		unsigned long long fileOffset = GetWord(entry + 2 * wordSize) * pageSize;
+
+		size_t length = strnlen(desc + names, size - names);
+		printf("  0x%llx-0x%llx\t0x%llx\t%s\n", start, end, fileOffset,
+			string(desc + names, length).c_str());
+		names += length + 1;
+	}
+	printf("\n");
+}
+
+/*   Prints the NT_SIGINFO entry of the crashing thread.   */
+void ELFCore::printSignalInfo(const char* desc, unsigned long long size)
+{
+	if (size < 16)
+		return;
+
+	int signal, error, code;
+	memcpy(&signal, desc, sizeof(signal));
+	memcpy(&error, desc + 4, sizeof(error));
+	memcpy(&code, desc + 8, sizeof(code));
+
+	printf("Signal:\n");
+	printf("  Number:\t\t\t%d\n", signal);
+	printf("  Code:\t\t\t\t%d\n", code);
+	printf("  Error:\t\t\t%d\n", error);
+
+	// Faulting address for memory and arithmetic signals.
+	unsigned long long addressOffset = this->image->is64() ? 16 : 12;
+	if ((signal == SIGSEGV || signal == SIGBUS || signal == SIGILL || signal == SIGFPE) &&
+		addressOffset + (this->image->is64() ? 8 : 4) <= size)
+		printf("  Fault address:\t\t0x%llx\n", GetWord(desc + addressOffset));
+	printf("\n");
+}
+
+/*   Prints a range of process memory as hex.   */
+void ELFCore::readMemory(unsigned long long address, unsigned long long size)
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	vector<unsigned char> buffer(size);
+	if (readMemory(address, buffer.data(), size) == false)
+	{
+		printf("ELFCore: Address range 0x%llx-0x%llx is not in the core!\n\n", address, address + size);
+		return;
+	}
+
+	for (unsigned long long i = 0; i < size; i += 16)
+	{
+		printf("0x%016llx ", address + i);
+		for (unsigned long long j = i; j < i + 16 && j < size; j++)
+			printf(" %02x", buffer[j]);
+		printf("\n");
+	}
+	printf("\n");
+}
@@ -0,0 +1,458 @@
+#include "stdafx.h"
+
+#ifndef ELFDiff_H
+#define ELFDiff_H
+class ELFDiff
+{
+public:
+	ELFDiff(string, string);
+	~ELFDiff();
+	bool IsReady();
+
+	/*   Options   */
+	void setContentMatching(bool);
+
+	/*   Print the differences   */
+	void readDiff();
+private:
+	/*   One named, sized entry of either build.   */
+	typedef struct DiffEntry {
+		string name;
+		unsigned long long size;
+		unsigned long long hash;		// Content hash, 0 when not computed.
+		int index;				// Section or symbol index.
+	} DIFF_ENTRY;
+
+	ELFMapping* mappings[2] = { NULL, NULL };
+	ELFImage* images[2] = { NULL, NULL };
+	bool InvalidELFFormat = false;
+	bool contentMatching = false;
+
+	unsigned long long added = 0, removed = 0, resized = 0, changed = 0, renamed = 0;
+
+	vector<DIFF_ENTRY> GetSections(ELFImage*);
+	vector<DIFF_ENTRY> GetDynamic(ELFImage*);
+	vector<DIFF_ENTRY> GetSymbols(ELFImage*);
+	unsigned long long GetSymbolHash(ELFImage*, const Elf64_Sym&);
+	static bool CompareEntries(const DIFF_ENTRY&, const DIFF_ENTRY&);
+	void diffEntries(vector<DIFF_ENTRY>&, vector<DIFF_ENTRY>&, bool, bool);
+	void diffHeader();
+	void diffSegments();
+};
+#endif // !~ ELFDiff_H
+
+/*   Constructor with the filenames of the old and new build.   */
+ELFDiff::ELFDiff(string OldFileName, string NewFileName)
+{
+	string names[2] = { OldFileName, NewFileName };
+	for (int i = 0; i < 2; i++)
+	{
+		this->mappings[i] = new ELFMapping(names[i]);
+		this->images[i] = new ELFImage(this->mappings[i]);
+		if (this->images[i]->IsReady() == false)
+		{
+			printf("ELFDiff: Failed to read ELF headers of %s!\n", names[i].c_str());
+			this->InvalidELFFormat = true;
+		}
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFDiff::~ELFDiff()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		delete this->images[i];
+		delete this->mappings[i];
+	}
+}
+
+/*   Checks if the class is ready.   */
+bool ELFDiff::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFDiff::setContentMatching(bool enabled)
+{
+	this->contentMatching = enabled;
+}
+
+/*   Orders entries on name, then size, so duplicates pair up in order.   */
+bool ELFDiff::CompareEntries(const DIFF_ENTRY& a, const DIFF_ENTRY& b)
+{
+	int order = a.name.compare(b.name);
+	return (order != 0) ? order < 0 : a.size < b.size;
+}
+
+/*   Sections keyed by name, with the hash of their contents.   */
+vector<ELFDiff::DIFF_ENTRY> ELFDiff::GetSections(ELFImage* image)
+{
+	vector<DIFF_ENTRY> entries;
+	for (unsigned long long i = 1; i < image->SectionHeaders.size(); i++)
+	{
+		DIFF_ENTRY entry;
+		entry.name = image->GetSectionName(i);
+		entry.size = image->SectionHeaders[i].sh_size;
+		entry.index = i;
+		entry.hash = 0;
+
+		const char* data = image->mapSection(i);
+		if (data != NULL)
+			entry.hash = XXHash64::Digest(data, entry.size);
+
+		entries.push_back(entry);
+	}
+
+	sort(entries.begin(), entries.end(), CompareEntries);
+	return entries;
+}
+
+/*   Dynamic entries that survive a rebuild: libraries, names, paths and
+	flags. Address valued tags differ on every link and are left out.   */
+vector<ELFDiff::DIFF_ENTRY> ELFDiff::GetDynamic(ELFImage* image)
+{
+	vector<DIFF_ENTRY> entries;
+
+	int index = -1;
+	for (unsigned long long i = 0; i < image->SectionHeaders.size(); i++)
+	{
+		if (image->SectionHeaders[i].sh_type == SHT_DYNAMIC)
+			index = i;
+	}
+
+	if (index < 0 || image->SectionHeaders[index].sh_type == SHT_NOBITS)
+		return entries;
+
+	// Entries are copied one at a time, reading the strings they name
+	//  maps other parts of the file.
+	Elf64_Shdr& section = image->SectionHeaders[index];
+	unsigned long long entrySize = image->is64() ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+	unsigned int link = section.sh_link;
+
+	for (unsigned long long offset = 0; offset + entrySize <= section.sh_size; offset += entrySize)
+	{
+		long long tag;
+		unsigned long long value;
+		if (image->is64() == true)
+		{
+			Elf64_Dyn dynamic;
+			if (image->read(section.sh_offset + offset, &dynamic, sizeof(dynamic)) == false)
+				break;
+			tag = dynamic.d_tag;
+			value = dynamic.d_un.d_val;
+		}
+		else
+		{
+			Elf32_Dyn dynamic;
+			if (image->read(section.sh_offset + offset, &dynamic, sizeof(dynamic)) == false)
+				break;
+			tag = dynamic.d_tag;
+			value = dynamic.d_un.d_val;
+		}
+
+		if (tag == DT_NULL)
+			break;
+
+		string text;
+		bool isString = false;
+		switch (tag)
+		{
+			case DT_NEEDED:
+				text = "NEEDED";
+				isString = true;
+				break;
+			case DT_SONAME:
+				text = "SONAME";
+				isString = true;
+				break;
+			case DT_RPATH:
+				text = "RPATH";
+				isString = true;
+				break;
+			case DT_RUNPATH:
+				text = "RUNPATH";
+				isString = true;
+				break;
+			case DT_FLAGS:
+				text = "FLAGS";
+				break;
+			case DT_FLAGS_1:
+				text = "FLAGS_1";
+				break;
+			case DT_BIND_NOW:
+				text = "BIND_NOW";
+				break;
+			case DT_TEXTREL:
+				text = "TEXTREL";
+				break;
+			default:
+				continue;
+		}
+
+		if (isString == true && link < image->SectionHeaders.size())
+		{
+			Elf64_Shdr& strings = image->SectionHeaders[link];
+			if (value < strings.sh_size)
+				text += " " + image->readString(strings.sh_offset + value, strings.sh_size - value);
+		}
+		else if (tag == DT_FLAGS || tag == DT_FLAGS_1)
+		{
+			char flags[32];
+			snprintf(flags, sizeof(flags), " 0x%llx", value);
+			text += flags;
+		}
+
+		DIFF_ENTRY entry;
+		entry.name = text;
+		entry.size = 0;
+		entry.hash = 0;
+		entry.index = -1;
+		entries.push_back(entry);
+	}
+
+	sort(entries.begin(), entries.end(), CompareEntries);
+	return entries;
+}
+
+/*   Hash of the bytes of a defined symbol, 0 when it has no file data.   */
+unsigned long long ELFDiff::GetSymbolHash(ELFImage* image, const Elf64_Sym& symbol)
+{
+	if (symbol.st_shndx >= image->SectionHeaders.size())
+		return 0;
+
+	Elf64_Shdr& section = image->SectionHeaders[symbol.st_shndx];
+	if (section.sh_type == SHT_NOBITS)
+		return 0;
+
+	unsigned long long offset = symbol.st_value;
+	if (image->getType() != ET_REL)
+		offset -= section.sh_addr;
+	if (offset > section.sh_size || symbol.st_size > section.sh_size - offset)
+		return 0;
+
+	const char* data = image->map(section.sh_offset + offset, symbol.st_size);
+	return (data == NULL) ? 0 : XXHash64::Digest(data, symbol.st_size);
+}
+
+/*   Defined functions and objects of .symtab, or .dynsym when stripped.   */
+vector<ELFDiff::DIFF_ENTRY> ELFDiff::GetSymbols(ELFImage* image)
+{
+	vector<DIFF_ENTRY> entries;
+
+	// .symtab when present, the dynamic table otherwise.
+	int table = image->GetSymbolTable();
+
+	vector<Elf64_Sym> symbols;
+	if (table < 0 || image->readSymbols(table, symbols) == false)
+		return entries;
+
+	// Pinned, hashing symbol contents maps other parts of the file.
+	unsigned int link = image->SectionHeaders[table].sh_link;
+	const char* strings = image->pinSection(link);
+	if (strings == NULL)
+		return entries;
+	unsigned long long stringsSize = image->SectionHeaders[link].sh_size;
+
+	entries.reserve(symbols.size());
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		Elf64_Sym& symbol = symbols[i];
+		unsigned char type = ELF64_ST_TYPE(symbol.st_info);
+		if (symbol.st_shndx == SHN_UNDEF || symbol.st_name == 0 || symbol.st_name >= stringsSize ||
+			(type != STT_FUNC && type != STT_OBJECT))
+			continue;
+
+		DIFF_ENTRY entry;
+		entry.name.assign(strings + symbol.st_name, strnlen(strings + symbol.st_name, stringsSize - symbol.st_name));
+		entry.size = symbol.st_size;
+		entry.index = i;
+		entry.hash = (this->contentMatching == true && type == STT_FUNC) ? GetSymbolHash(image, symbol) : 0;
+		entries.push_back(entry);
+	}
+	image->unpin(strings);
+
+	sort(entries.begin(), entries.end(), CompareEntries);
+	return entries;
+}
+
+/*   Walks two name sorted lists side by side and prints added, removed
+	and resized entries. Unmatched entries with equal content hashes are
+	reported as renamed instead.   */
+void ELFDiff::diffEntries(vector<DIFF_ENTRY>& before, vector<DIFF_ENTRY>& after, bool showContent, bool matchHashes)
+{
+	vector<DIFF_ENTRY*> gone, fresh;
+	unsigned long long a = 0, b = 0;
+
+	while (a < before.size() || b < after.size())
+	{
+		int order;
+		if (a >= before.size())
+			order = 1;
+		else if (b >= after.size())
+			order = -1;
+		else
+			order = before[a].name.compare(after[b].name);
+
+		if (order < 0)
+		{
+			gone.push_back(&before[a++]);
+			continue;
+		}
+		if (order > 0)
+		{
+			fresh.push_back(&after[b++]);
+			continue;
+		}
+
+		DIFF_ENTRY& old = before[a++];
+		DIFF_ENTRY& now = after[b++];
+		if (old.size != now.size)
+		{
+			long long delta = (long long)(now.size - old.size);
+			printf("  ~ %-40s\t%llu -> %llu\t(%+lld)\n", old.name.c_str(), old.size, now.size, delta);
+			this->resized++;
+		}
+		else if (showContent == true && old.hash != now.hash)
+		{
+			printf("  * %-40s\tcontents changed\n", old.name.c_str());
+			this->changed++;
+		}
+	}
+
+	// Pair removed and added entries of equal size and contents.
+	if (matchHashes == true)
+	{
+		vector<DIFF_ENTRY*> byHash;
+		for (unsigned long long i = 0; i < fresh.size(); i++)
+		{
+			if (fresh[i]->hash != 0)
+				byHash.push_back(fresh[i]);
+		}
+		auto HashOrder = [](const DIFF_ENTRY* x, const DIFF_ENTRY* y)
+		{
+			return (x->hash != y->hash) ? x->hash < y->hash : x->size < y->size;
+		};
+		sort(byHash.begin(), byHash.end(), HashOrder);
+
+		vector<DIFF_ENTRY*> stillGone;
+		for (unsigned long long i = 0; i < gone.size(); i++)
+		{
+			vector<DIFF_ENTRY*>::iterator it = lower_bound(byHash.begin(), byHash.end(), gone[i], HashOrder);
+			if (gone[i]->hash == 0 || it == byHash.end() || (*it)->hash != gone[i]->hash || (*it)->size != gone[i]->size)
+			{
+				stillGone.push_back(gone[i]);
+				continue;
+			}
+
+			printf("  > %-40s\t-> %s\t(renamed, %llu bytes)\n", gone[i]->name.c_str(), (*it)->name.c_str(), (*it)->size);
+			this->renamed++;
+			(*it)->hash = 0;
+			(*it)->index = -2;
+			byHash.erase(it);
+		}
+		gone.swap(stillGone);
+	}
+
+	for (unsigned long long i = 0; i < gone.size(); i++)
+	{
+		// Dynamic entries carry no size.
+		if (gone[i]->index == -1)
+			printf("  - %s\n", gone[i]->name.c_str());
+		else
+			printf("  - %-40s\t%llu\n", gone[i]->name.c_str(), gone[i]->size);
+		this->removed++;
+	}
+	for (unsigned long long i = 0; i < fresh.size(); i++)
+	{
+		if (fresh[i]->index == -2)
+			continue;
+		if (fresh[i]->index == -1)
+			printf("  + %s\n", fresh[i]->name.c_str());
+		else
+			printf("  + %-40s\t%llu\n", fresh[i]->name.c_str(), fresh[i]->size);
+		this->added++;
+	}
+}
+
+/*   Header fields that matter between builds.   */
+void ELFDiff::diffHeader()
+{
+	Elf64_Ehdr& old = this->images[0]->Header;
+	Elf64_Ehdr& now = this->images[1]->Header;
+
+	printf("Header:\n");
+	if (this->images[0]->is64() != this->images[1]->is64())
+		printf("  ~ Class\t\t%s -> %s\n", this->images[0]->is64() ? "ELF64" : "ELF32", this->images[1]->is64() ? "ELF64" : "ELF32");
+	if (old.e_type != now.e_type)
+		printf("  ~ Type\t\t%u -> %u\n", old.e_type, now.e_type);
+	if (old.e_machine != now.e_machine)
+		printf("  ~ Machine\t\t%u -> %u\n", old.e_machine, now.e_machine);
+	if (old.e_entry != now.e_entry)
+		printf("  ~ Entry point\t\t0x%llx -> 0x%llx\n", (unsigned long long)old.e_entry, (unsigned long long)now.e_entry);
+	printf("\n");
+}
+
+/*   Program headers, compared in order.   */
+void ELFDiff::diffSegments()
+{
+	vector<Elf64_Phdr>& old = this->images[0]->ProgramHeaders;
+	vector<Elf64_Phdr>& now = this->images[1]->ProgramHeaders;
+
+	printf("Segments:\n");
+	if (old.size() != now.size())
+		printf("  ~ Count\t\t%zu -> %zu\n", old.size(), now.size());
+
+	for (unsigned long long i = 0; i < old.size() && i < now.size(); i++)
+	{
+		if (old[i].p_type != now[i].p_type)
+		{
+			printf("  ~ [%llu] type\t\t0x%x -> 0x%x\n", i, old[i].p_type, now[i].p_type);
+			continue;
+		}
+		if (old[i].p_flags != now[i].p_flags)
+			printf("  ~ [%llu] flags\t\t0x%x -> 0x%x\n", i, old[i].p_flags, now[i].p_flags);
+		if (old[i].p_vaddr != now[i].p_vaddr)
+			printf("  ~ [%llu] address\t0x%llx -> 0x%llx\n", i, (unsigned long long)old[i].p_vaddr, (unsigned long long)now[i].p_vaddr);
+		if (old[i].p_filesz != now[i].p_filesz || old[i].p_memsz != now[i].p_memsz)
+			printf("  ~ [%llu] size\t\t%llu/%llu -> %llu/%llu\t(%+lld)\n", i, (unsigned long long)old[i].p_filesz,
+				(unsigned long long)old[i].p_memsz, (unsigned long long)now[i].p_filesz, (unsigned long long)now[i].p_memsz,
+				(long long)(now[i].p_memsz - old[i].p_memsz));
+	}
+	printf("\n");
+}
+
+/*   Prints every difference between the old and the new build.   */
+void ELFDiff::readDiff()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	diffHeader();
+	diffSegments();
+
+	printf("Sections:\n");
+	vector<DIFF_ENTRY> oldSections = GetSections(this->images[0]);
+	vector<DIFF_ENTRY> newSections = GetSections(this->images[1]);
+	diffEntries(oldSections, newSections, true, false);
+	printf("\n");
+
+	printf("Dynamic:\n");
+	vector<DIFF_ENTRY> oldDynamic = GetDynamic(this->images[0]);
+	vector<DIFF_ENTRY> newDynamic = GetDynamic(this->images[1]);
+	diffEntries(oldDynamic, newDynamic, false, false);
+	printf("\n");
+
+	printf("Symbols:\n");
+	vector<DIFF_ENTRY> oldSymbols = GetSymbols(this->images[0]);
+	vector<DIFF_ENTRY> newSymbols = GetSymbols(this->images[1]);
+	diffEntries(oldSymbols, newSymbols, false, this->contentMatching);
+	printf("\n");
+
+	printf("%llu added, %llu removed, %llu resized, %llu changed, %llu renamed\n\n", this->added, this->removed,
+		this->resized, this->changed, this->renamed);
+}
@@ -0,0 +1,223 @@
+#include "stdafx.h"
+
+#ifndef ELFEntropy_H
+#define ELFEntropy_H
+class ELFEntropy
+{
+public:
+	explicit ELFEntropy(string);
+	~ELFEntropy();
+	bool IsReady();
+
+	/*   Options   */
+	void setWindowSize(unsigned int);
+
+	/*   Print the entropy profile of every section   */
+	void readProfile();
+
+	/*   Byte histograms   */
+	static void CountBytes(const unsigned char*, unsigned long long, unsigned long long*);
+	static double GetEntropy(const unsigned long long*, unsigned long long);
+private:
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int windowSize = 4096;
+
+	// Columns of the profile string, windows are merged to fit.
+	static const unsigned int PROFILE_WIDTH = 64;
+	// Windows at or above this are likely compressed or encrypted.
+	static constexpr double HIGH_ENTROPY = 7.2;
+
+	void profileSection(int, unsigned long long*);
+};
+
+/*   Constructor with string of filename.   */
+ELFEntropy::ELFEntropy(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFEntropy: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFEntropy::~ELFEntropy()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFEntropy::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFEntropy::setWindowSize(unsigned int size)
+{
+	// Windows slide by half their size, keep it even.
+	this->windowSize = (size < 64) ? 64 : size & ~1U;
+}
+
+/*   Adds the bytes of a buffer to a 256 entry histogram.
+	Four tables are counted in turn, so increments of equal neighbouring
+	bytes do not wait on each other, and merged at the end.   */
+void ELFEntropy::CountBytes(const unsigned char* data, unsigned long long size, unsigned long long* histogram)
+{
+	unsigned int tables[4][256];
+	memset(tables, 0, sizeof(tables));
+
+	unsigned long long i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, data + i, sizeof(word));
+
+		tables[0][word & 0xFF]++;
+		tables[1][(word >> 8) & 0xFF]++;
+		tables[2][(word >> 16) & 0xFF]++;
+		tables[3][(word >> 24) & 0xFF]++;
+		tables[0][(word >> 32) & 0xFF]++;
+		tables[1][(word >> 40) & 0xFF]++;
+		tables[2][(word >> 48) & 0xFF]++;
+		tables[3][word >> 56]++;
+	}
+	for (; i < size; i++)
+		tables[0][data[i]]++;
+
+	for (int b = 0; b < 256; b++)
+		histogram[b] += tables[0][b] + tables[1][b] + tables[2][b] + tables[3][b];
+}
+
+/*   Shannon entropy in bits per byte, 0 to 8.   */
+double ELFEntropy::GetEntropy(const unsigned long long* histogram, unsigned long long total)
+{
+	if (total == 0)
+		return 0.0;
+
+	double entropy = 0.0;
+	for (int b = 0; b < 256; b++)
+	{
+		if (histogram[b] == 0)
+			continue;
+
+		double p = (double)histogram[b] / total;
+		entropy -= p * log2(p);
+	}
+	return entropy;
+}
+
+/*   Prints one section line. Windows slide by half a window, each half
+	is counted once and a window is the sum of two halves.   */
+void ELFEntropy::profileSection(int index, unsigned long long* fileHistogram)
+{
+	Elf64_Shdr& section = this->image->SectionHeaders[index];
+	string name = this->image->GetSectionName(index);
+
+	const unsigned char* data = (const unsigned char*)this->image->mapSection(index);
+	if (data == NULL)
+		return;
+
+	unsigned long long size = section.sh_size;
+	unsigned long long histogram[256] = { 0 };
+
+	unsigned long long half = this->windowSize / 2;
+	unsigned long long halves = size / half;
+	unsigned long long windows = (halves >= 2) ? halves - 1 : 0;
+
+	string profile;
+	double maximum = 0.0;
+
+	if (windows == 0)
+		CountBytes(data, size, histogram);
+	else
+	{
+		unsigned long long columns = min<unsigned long long>(windows, PROFILE_WIDTH);
+		vector<double> columnMax(columns, 0.0);
+
+		unsigned long long previous[256] = { 0 };
+		CountBytes(data, half, previous);
+
+		for (unsigned long long w = 0; w < windows; w++)
+		{
+			unsigned long long current[256] = { 0 };
+			CountBytes(data + (w + 1) * half, half, current);
+
+			unsigned long long window[256];
+			for (int b = 0; b < 256; b++)
+			{
+				window[b] = previous[b] + current[b];
+				histogram[b] += previous[b];
+			}
+
+			double entropy = GetEntropy(window, half * 2);
+			if (entropy > maximum)
+				maximum = entropy;
+
+			unsigned long long column = w * columns / windows;
+			if (entropy > columnMax[column])
+				columnMax[column] = entropy;
+
+			memcpy(previous, current, sizeof(previous));
+		}
+
+		// Last counted half and the bytes after the last whole half.
+		for (int b = 0; b < 256; b++)
+			histogram[b] += previous[b];
+		CountBytes(data + halves * half, size - halves * half, histogram);
+
+		for (unsigned long long c = 0; c < columns; c++)
+			profile += (char)('0' + min(8, (int)columnMax[c]));
+	}
+
+	for (int b = 0; b < 256; b++)
+		fileHistogram[b] += histogram[b];
+
+	double entropy = GetEntropy(histogram, size);
+	if (windows == 0)
+		maximum = entropy;
+
+	printf("  [%d]\t%-16s\t0x%08llx\t%.3f\t%.3f\t%s%s\n", index, name.c_str(), size, entropy, maximum,
+		maximum >= HIGH_ENTROPY ? "! " : "", profile.c_str());
+
+	this->mapping->release(this->image->getBase() + section.sh_offset, size);
+}
+
+/*   Prints the entropy of every section with contents and a profile of
+	the window entropies (one digit per column, the integer part of the
+	highest window in it).   */
+void ELFEntropy::readProfile()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	printf("Entropy profile (window %u bytes):\n", this->windowSize);
+	printf("  [Nr]\tName\t\t\tSize\t\tEntropy\tMax\tProfile\n");
+
+	unsigned long long fileHistogram[256] = { 0 };
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if (section.sh_type == SHT_NULL || section.sh_type == SHT_NOBITS || section.sh_size == 0)
+			continue;
+
+		profileSection(i, fileHistogram);
+	}
+
+	unsigned long long total = 0;
+	for (int b = 0; b < 256; b++)
+		total += fileHistogram[b];
+
+	printf("  All sections: %.3f bits per byte over %llu bytes\n\n", GetEntropy(fileHistogram, total), total);
+}
+
+#endif // !~ ELFEntropy_H
@@ -0,0 +1,484 @@
+#include "stdafx.h"
+
+#ifndef ELFFingerprint_H
+#define ELFFingerprint_H
+class ELFFingerprint
+{
+public:
+	/*   Fingerprint of one function.   */
+	typedef struct FunctionPrint {
+		string name;
+		unsigned long long address;		// st_value.
+		unsigned long long size;		// st_size.
+		unsigned long long position;		// Unique position, see GetPosition.
+		int section;				// Index in SectionHeaders.
+		unsigned long long fingerprint;		// Hash with addresses masked.
+		unsigned long long check;		// Second hash of the same bytes, other seed.
+		unsigned long long targets;		// Hash of what the masked fields point at.
+	} FUNCTION_PRINT;
+
+	explicit ELFFingerprint(string);
+	~ELFFingerprint();
+	bool IsReady();
+
+	/*   Computes the fingerprints of every function   */
+	bool computeFingerprints();
+	vector<FUNCTION_PRINT>& getFunctions();
+	const unsigned char* getCode(const FUNCTION_PRINT&);
+
+	/*   Print fingerprints, or the functions that changed between builds   */
+	void readFingerprints();
+	static void CompareBuilds(ELFFingerprint&, ELFFingerprint&);
+
+	static unsigned int GetRelocationWidth(unsigned short, unsigned int);
+private:
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+	bool computed = false;
+
+	/*   One relocated field.   */
+	typedef struct RelocatedField {
+		unsigned long long position;		// See GetPosition.
+		unsigned int width;
+		bool implicit;				// SHT_REL, the addend is in the field.
+		unsigned long long target;		// Hash of symbol, addend and type.
+	} RELOCATED_FIELD;
+
+	vector<FUNCTION_PRINT> Functions;
+	static const unsigned long long CHECK_SEED = 0x9E3779B97F4A7C15ULL;
+	// Seeds targets only meaningful inside this file: local symbols and
+	//  positions resolved from the code.
+	unsigned long long localSeed = 0;
+	// Pinned contents of each code section, NULL when not needed.
+	vector<const unsigned char*> SectionData;
+	// Every relocated field, sorted on position.
+	vector<RELOCATED_FIELD> Relocations;
+
+	unsigned long long GetPosition(int, unsigned long long);
+	void readRelocations();
+	void maskCode(const FUNCTION_PRINT&, vector<unsigned char>&, vector<unsigned long long>&);
+};
+#endif // !~ ELFFingerprint_H
+
+/*   Constructor with string of filename.   */
+ELFFingerprint::ELFFingerprint(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	this->localSeed = XXHash64::Digest(FileName.data(), FileName.size(), CHECK_SEED);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFFingerprint: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFFingerprint::~ELFFingerprint()
+{
+	for (unsigned long long i = 0; i < this->SectionData.size(); i++)
+		this->image->unpin((const char*)this->SectionData[i]);
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFFingerprint::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Functions found by computeFingerprints, sorted on position.   */
+vector<ELFFingerprint::FUNCTION_PRINT>& ELFFingerprint::getFunctions()
+{
+	return this->Functions;
+}
+
+/*   Code bytes of a function, valid while the class lives.   */
+const unsigned char* ELFFingerprint::getCode(const FUNCTION_PRINT& function)
+{
+	const unsigned char* data = this->SectionData[function.section];
+	if (data == NULL)
+		return NULL;
+
+	return data + (function.position - GetPosition(function.section, this->image->SectionHeaders[function.section].sh_addr));
+}
+
+/*   Bytes a relocation patches, by machine and type. Anything not listed
+	patches 4 bytes, which covers instruction relocations of most RISC
+	machines and the common x86 ones.   */
+unsigned int ELFFingerprint::GetRelocationWidth(unsigned short machine, unsigned int type)
+{
+	if (machine == EM_X86_64)
+	{
+		switch (type)
+		{
+			case R_X86_64_64: case R_X86_64_GLOB_DAT: case R_X86_64_JUMP_SLOT: case R_X86_64_RELATIVE:
+			case R_X86_64_DTPMOD64: case R_X86_64_DTPOFF64: case R_X86_64_TPOFF64: case R_X86_64_PC64:
+			case R_X86_64_GOTOFF64: case R_X86_64_SIZE64: case R_X86_64_IRELATIVE:
+				return 8;
+			case R_X86_64_16: case R_X86_64_PC16:
+				return 2;
+			case R_X86_64_8: case R_X86_64_PC8:
+				return 1;
+		}
+		return 4;
+	}
+	if (machine == EM_386)
+	{
+		switch (type)
+		{
+			case R_386_16: case R_386_PC16:
+				return 2;
+			case R_386_8: case R_386_PC8:
+				return 1;
+		}
+		return 4;
+	}
+	if (machine == EM_AARCH64 && (type == R_AARCH64_ABS64 || type == R_AARCH64_PREL64 ||
+		type == R_AARCH64_RELATIVE || type == R_AARCH64_GLOB_DAT || type == R_AARCH64_JUMP_SLOT))
+		return 8;
+
+	return 4;
+}
+
+/*   Address of a section byte made unique over the whole file. Linked
+	files use the virtual address, relocatable objects have section
+	relative values and use the file offset instead.   */
+unsigned long long ELFFingerprint::GetPosition(int section, unsigned long long value)
+{
+	Elf64_Shdr& header = this->image->SectionHeaders[section];
+	if (this->image->getType() == ET_REL)
+		return header.sh_offset + value;
+
+	return value;
+}
+
+/*   Collects every relocated field and what it points at, from the
+	relocation sections of an object or the dynamic and --emit-relocs
+	sections of a linked file. Global symbols are keyed by name, local ones
+	and symbol-less relocations only hold inside this file.   */
+void ELFFingerprint::readRelocations()
+{
+	unsigned short machine = this->image->getMachine();
+	bool relocatable = (this->image->getType() == ET_REL);
+	unordered_map<unsigned int, vector<Elf64_Sym> > tables;
+
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if (section.sh_type != SHT_REL && section.sh_type != SHT_RELA)
+			continue;
+
+		// Objects relocate the section named by sh_info.
+		unsigned int target = section.sh_info;
+		if (relocatable == true && (target == 0 || target >= this->image->SectionHeaders.size()))
+			continue;
+
+		vector<Elf64_Rela> relocations;
+		if (this->image->readRelocations(i, relocations) == false)
+			continue;
+
+		if (tables.count(section.sh_link) == 0 && section.sh_link < this->image->SectionHeaders.size())
+			this->image->readSymbols(section.sh_link, tables[section.sh_link]);
+		vector<Elf64_Sym>& symbols = tables[section.sh_link];
+
+		for (unsigned long long j = 0; j < relocations.size(); j++)
+		{
+			Elf64_Rela& relocation = relocations[j];
+			unsigned long long index = ELF64_R_SYM(relocation.r_info);
+
+			RELOCATED_FIELD field;
+			field.position = relocatable ? GetPosition(target, relocation.r_offset) : relocation.r_offset;
+			field.width = GetRelocationWidth(machine, ELF64_R_TYPE(relocation.r_info));
+			field.implicit = (section.sh_type == SHT_REL);
+
+			// Section symbols have no name, their section stands in.
+			string name;
+			bool local = true;
+			if (index != 0 && index < symbols.size())
+			{
+				Elf64_Sym& symbol = symbols[index];
+				name = (ELF64_ST_TYPE(symbol.st_info) == STT_SECTION) ? this->image->GetSectionName(symbol.st_shndx) :
+					this->image->GetSymbolName(section.sh_link, symbol);
+				local = (ELF64_ST_BIND(symbol.st_info) == STB_LOCAL);
+			}
+
+			unsigned long long key[2] = { (unsigned long long)relocation.r_addend, ELF64_R_TYPE(relocation.r_info) };
+			field.target = XXHash64::Digest(key, sizeof(key),
+				XXHash64::Digest(name.data(), name.size(), local ? this->localSeed : 0));
+			this->Relocations.push_back(field);
+		}
+	}
+
+	sort(this->Relocations.begin(), this->Relocations.end(), [](const RELOCATED_FIELD& a, const RELOCATED_FIELD& b)
+	{
+		return a.position < b.position;
+	});
+}
+
+/*   Copies the code of a function with every relocated field, RIP
+	relative displacement and branch leaving the function set to zero, and
+	lists what each of those fields points at. Two functions only fold when
+	both the masked code and the targets are equal.   */
+void ELFFingerprint::maskCode(const FUNCTION_PRINT& function, vector<unsigned char>& buffer,
+	vector<unsigned long long>& targets)
+{
+	const unsigned char* code = getCode(function);
+	buffer.assign(code, code + function.size);
+	targets.clear();
+
+	auto FieldOrder = [](const RELOCATED_FIELD& field, unsigned long long position)
+	{
+		return field.position < position;
+	};
+
+	// Relocations that overlap the function.
+	vector<RELOCATED_FIELD>::iterator it = lower_bound(this->Relocations.begin(), this->Relocations.end(),
+		function.position >= 8 ? function.position - 8 : 0, FieldOrder);
+	for (; it != this->Relocations.end() && it->position < function.position + function.size; it++)
+	{
+		unsigned long long value = 0;
+		for (unsigned int k = 0; k < it->width; k++)
+		{
+			unsigned long long position = it->position + k;
+			if (position < function.position || position >= function.position + function.size)
+				continue;
+
+			// SHT_REL keeps the addend in the field, it is part of the target.
+			value = (value << 8) | buffer[position - function.position];
+			buffer[position - function.position] = 0;
+		}
+		targets.push_back(it->target);
+		if (it->implicit == true)
+			targets.push_back(value);
+	}
+
+	unsigned short machine = this->image->getMachine();
+	if (machine != EM_X86_64 && machine != EM_386)
+		return;
+
+	// Fields a relocation already covers were keyed above, their bytes
+	//  are placeholders in objects.
+	auto Relocated = [&](unsigned long long position)
+	{
+		vector<RELOCATED_FIELD>::iterator field = lower_bound(this->Relocations.begin(), this->Relocations.end(),
+			position, FieldOrder);
+		return field != this->Relocations.end() && field->position == position;
+	};
+
+	bool is64 = (machine == EM_X86_64);
+	unsigned long long offset = 0;
+	while (offset < function.size)
+	{
+		X86Decoder::X86_INSTRUCTION instruction;
+		if (X86Decoder::Decode(code + offset, function.size - offset, is64, instruction) == false)
+			break;
+
+		unsigned long long next = function.position + offset + instruction.length;
+		if (instruction.ripRelative == true)
+		{
+			memset(buffer.data() + offset + instruction.dispOffset, 0, instruction.dispSize);
+
+			int displacement;
+			memcpy(&displacement, code + offset + instruction.dispOffset, 4);
+			unsigned long long destination = next + displacement;
+			if (Relocated(function.position + offset + instruction.dispOffset) == false)
+				targets.push_back(XXHash64::Digest(&destination, sizeof(destination), this->localSeed));
+		}
+
+		if (instruction.relativeBranch == true)
+		{
+			long long displacement = X86Decoder::GetBranchDisplacement(code + offset, instruction);
+			long long target = (long long)(offset + instruction.length) + displacement;
+			if (target < 0 || target >= (long long)function.size)
+			{
+				memset(buffer.data() + offset + instruction.immOffset, 0, instruction.immSize);
+
+				unsigned long long destination = next + displacement;
+				if (Relocated(function.position + offset + instruction.immOffset) == false)
+					targets.push_back(XXHash64::Digest(&destination, sizeof(destination), this->localSeed));
+			}
+		}
+
+		offset += instruction.length;
+	}
+}
+
+/*   Reads the defined functions and fingerprints them on the pool.
+	Code sections are mapped up front, the workers only read them.   */
+bool ELFFingerprint::computeFingerprints()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return false;
+	}
+	if (this->computed == true)
+		return true;
+	this->computed = true;
+
+	vector<ELFImage::FUNCTION_SYMBOL> symbols;
+	if (this->image->readFunctionSymbols(symbols) == false)
+	{
+		printf("ELFFingerprint: No symbol table found!\n");
+		return false;
+	}
+
+	this->SectionData.assign(this->image->SectionHeaders.size(), NULL);
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		ELFImage::FUNCTION_SYMBOL& symbol = symbols[i];
+		if (this->SectionData[symbol.section] == NULL)
+		{
+			this->SectionData[symbol.section] = (const unsigned char*)this->image->pinSection(symbol.section);
+			if (this->SectionData[symbol.section] == NULL)
+				continue;
+		}
+
+		FUNCTION_PRINT function;
+		function.name = symbol.name;
+		function.address = symbol.address;
+		function.size = symbol.size;
+		function.section = symbol.section;
+		function.position = GetPosition(symbol.section, symbol.address);
+		function.fingerprint = 0;
+		function.check = 0;
+		function.targets = 0;
+		this->Functions.push_back(function);
+	}
+
+	// getFunctions is sorted on position, section order need not follow it.
+	sort(this->Functions.begin(), this->Functions.end(), [](const FUNCTION_PRINT& a, const FUNCTION_PRINT& b)
+	{
+		return a.position < b.position;
+	});
+
+	readRelocations();
+
+	ThreadPool pool;
+	vector<vector<unsigned char> > buffers(pool.getThreadCount());
+	vector<vector<unsigned long long> > targets(pool.getThreadCount());
+	pool.parallelFor(this->Functions.size(), [&](unsigned long long index, unsigned int worker)
+	{
+		vector<unsigned char>& buffer = buffers[worker];
+		maskCode(this->Functions[index], buffer, targets[worker]);
+		this->Functions[index].fingerprint = XXHash64::Digest(buffer.data(), buffer.size());
+		this->Functions[index].check = XXHash64::Digest(buffer.data(), buffer.size(), CHECK_SEED);
+		this->Functions[index].targets = XXHash64::Digest(targets[worker].data(),
+			targets[worker].size() * sizeof(unsigned long long));
+	});
+
+	return true;
+}
+
+/*   Prints the fingerprint of every function.   */
+void ELFFingerprint::readFingerprints()
+{
+	if (computeFingerprints() == false)
+		return;
+
+	printf("Function fingerprints:\n");
+	printf("  Address\t\tSize\t\tFingerprint\t\tName\n");
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		FUNCTION_PRINT& function = this->Functions[i];
+		printf("  0x%016llx\t%8llu\t%016llx\t%s\n", function.address, function.size, function.fingerprint,
+			function.name.c_str());
+	}
+	printf("  %zu functions\n\n", this->Functions.size());
+}
+
+/*   Matches the functions of two builds by name, then the unmatched ones
+	by fingerprint, and prints the functions whose code changed.   */
+void ELFFingerprint::CompareBuilds(ELFFingerprint& before, ELFFingerprint& after)
+{
+	if (before.computeFingerprints() == false || after.computeFingerprints() == false)
+		return;
+
+	vector<FUNCTION_PRINT*> old, now;
+	for (unsigned long long i = 0; i < before.Functions.size(); i++)
+		old.push_back(&before.Functions[i]);
+	for (unsigned long long i = 0; i < after.Functions.size(); i++)
+		now.push_back(&after.Functions[i]);
+
+	auto NameOrder = [](const FUNCTION_PRINT* a, const FUNCTION_PRINT* b)
+	{
+		return (a->name != b->name) ? a->name < b->name : a->position < b->position;
+	};
+	sort(old.begin(), old.end(), NameOrder);
+	sort(now.begin(), now.end(), NameOrder);
+
+	unsigned long long same = 0, changed = 0;
+	vector<FUNCTION_PRINT*> gone, fresh;
+
+	printf("Changed functions:\n");
+	unsigned long long a = 0, b = 0;
+	while (a < old.size() || b < now.size())
+	{
+		int order = (a >= old.size()) ? 1 : (b >= now.size()) ? -1 : old[a]->name.compare(now[b]->name);
+		if (order < 0)
+		{
+			gone.push_back(old[a++]);
+			continue;
+		}
+		if (order > 0)
+		{
+			fresh.push_back(now[b++]);
+			continue;
+		}
+
+		FUNCTION_PRINT* x = old[a++];
+		FUNCTION_PRINT* y = now[b++];
+		if (x->fingerprint == y->fingerprint && x->size == y->size)
+		{
+			same++;
+			continue;
+		}
+
+		printf("  ~ %-40s\t%llu -> %llu\t(%+lld)\n", x->name.c_str(), x->size, y->size, (long long)(y->size - x->size));
+		changed++;
+	}
+
+	// Renamed functions keep their fingerprint.
+	auto PrintOrder = [](const FUNCTION_PRINT* p, const FUNCTION_PRINT* q)
+	{
+		return (p->fingerprint != q->fingerprint) ? p->fingerprint < q->fingerprint : p->size < q->size;
+	};
+	sort(fresh.begin(), fresh.end(), PrintOrder);
+
+	unsigned long long renamed = 0, removed = 0;
+	vector<bool> used(fresh.size(), false);
+	printf("\nRemoved or renamed functions:\n");
+	for (unsigned long long i = 0; i < gone.size(); i++)
+	{
+		vector<FUNCTION_PRINT*>::iterator it = lower_bound(fresh.begin(), fresh.end(), gone[i], PrintOrder);
+		while (it != fresh.end() && used[it - fresh.begin()] == true && (*it)->fingerprint == gone[i]->fingerprint)
+			it++;
+
+		if (it != fresh.end() && (*it)->fingerprint == gone[i]->fingerprint && (*it)->size == gone[i]->size)
+		{
+			printf("  > %-40s\t-> %s\n", gone[i]->name.c_str(), (*it)->name.c_str());
+			used[it - fresh.begin()] = true;
+			renamed++;
+			continue;
+		}
+
+		printf("  - %-40s\t%llu\n", gone[i]->name.c_str(), gone[i]->size);
+		removed++;
+	}
+
+	unsigned long long added = 0;
+	printf("\nAdded functions:\n");
+	for (unsigned long long i = 0; i < fresh.size(); i++)
+	{
+		if (used[i] == true)
+			continue;
+		printf("  + %-40s\t%llu\n", fresh[i]->name.c_str(), fresh[i]->size);
+		added++;
+	}
+
+	printf("\n%llu unchanged, %llu changed, %llu renamed, %llu removed, %llu added\n\n", same, changed, renamed,
+		removed, added);
+}
@@ -0,0 +1,183 @@
+#include "stdafx.h"
+
+#ifndef ELFFolding_H
+#define ELFFolding_H
+class ELFFolding
+{
+public:
+	explicit ELFFolding(vector<string>);
+
+	/*   Options   */
+	void setTopCount(unsigned int);
+
+	/*   Print groups of identical functions   */
+	void readCandidates();
+private:
+	/*   One function reduced to what grouping needs.   */
+	typedef struct FoldFunction {
+		unsigned long long fingerprint;
+		unsigned long long check;
+		unsigned long long targets;		// What the masked fields point at.
+		unsigned long long size;
+		string name;
+		unsigned int file;			// Index in Files.
+	} FOLD_FUNCTION;
+
+	/*   Functions with identical code and targets.   */
+	typedef struct FoldGroup {
+		vector<FOLD_FUNCTION*> members;
+		unsigned long long distinct;		// Distinct names in the group.
+		unsigned long long reclaimable;		// Bytes folding would save.
+	} FOLD_GROUP;
+
+	vector<string> Files;
+	unsigned int topCount = 20;
+
+	// Functions spread over partitions by the top bits of their fingerprint.
+	static const unsigned int PARTITION_BITS = 8;
+	vector<vector<FOLD_FUNCTION> > Partitions;
+
+	void collect(unsigned int);
+	void groupPartition(vector<FOLD_FUNCTION>&, vector<FOLD_GROUP>&);
+};
+#endif // !~ ELFFolding_H
+
+/*   Constructor with the binaries or object files to search.   */
+ELFFolding::ELFFolding(vector<string> files)
+{
+	this->Files = files;
+	this->Partitions.resize(1U << PARTITION_BITS);
+}
+
+/*   Options.   */
+void ELFFolding::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+
+/*   Fingerprints the functions of one file and files them into the
+	partitions. The file is closed again before the next one is read.   */
+void ELFFolding::collect(unsigned int file)
+{
+	ELFFingerprint prints(this->Files[file]);
+	if (prints.IsReady() == false || prints.computeFingerprints() == false)
+	{
+		printf("ELFFolding: Skipping %s!\n", this->Files[file].c_str());
+		return;
+	}
+
+	vector<ELFFingerprint::FUNCTION_PRINT>& functions = prints.getFunctions();
+	for (unsigned long long i = 0; i < functions.size(); i++)
+	{
+		FOLD_FUNCTION function;
+		function.fingerprint = functions[i].fingerprint;
+		function.check = functions[i].check;
+		function.targets = functions[i].targets;
+		function.size = functions[i].size;
+		function.name = functions[i].name;
+		function.file = file;
+
+		this->Partitions[function.fingerprint >> (64 - PARTITION_BITS)].push_back(function);
+	}
+}
+
+/*   Sorts one partition on its hashes and collects the runs of equal code
+	with more than one distinct name. The masked code only makes functions
+	candidates, they fold when their calls, jumps and relocated fields
+	also point at the same places. Equal names are the same inline
+	function emitted in several objects, which the linker already merges.   */
+void ELFFolding::groupPartition(vector<FOLD_FUNCTION>& partition, vector<FOLD_GROUP>& groups)
+{
+	sort(partition.begin(), partition.end(), [](const FOLD_FUNCTION& a, const FOLD_FUNCTION& b)
+	{
+		if (a.fingerprint != b.fingerprint)
+			return a.fingerprint < b.fingerprint;
+		if (a.check != b.check)
+			return a.check < b.check;
+		if (a.targets != b.targets)
+			return a.targets < b.targets;
+		if (a.size != b.size)
+			return a.size < b.size;
+		return a.name < b.name;
+	});
+
+	for (unsigned long long start = 0; start < partition.size();)
+	{
+		unsigned long long end = start + 1;
+		while (end < partition.size() && partition[end].fingerprint == partition[start].fingerprint &&
+			partition[end].check == partition[start].check && partition[end].targets == partition[start].targets &&
+			partition[end].size == partition[start].size)
+			end++;
+
+		if (end - start > 1)
+		{
+			FOLD_GROUP group;
+			group.distinct = 0;
+			for (unsigned long long i = start; i < end; i++)
+			{
+				group.members.push_back(&partition[i]);
+				if (i == start || partition[i].name != partition[i - 1].name)
+					group.distinct++;
+			}
+			group.reclaimable = (group.distinct - 1) * partition[start].size;
+
+			if (group.distinct > 1 && group.reclaimable > 0)
+				groups.push_back(group);
+		}
+		start = end;
+	}
+}
+
+/*   Prints the groups of identical functions, largest saving first.   */
+void ELFFolding::readCandidates()
+{
+	for (unsigned int i = 0; i < this->Files.size(); i++)
+		collect(i);
+
+	ThreadPool pool;
+	vector<vector<FOLD_GROUP> > found(this->Partitions.size());
+	pool.parallelFor(this->Partitions.size(), [&](unsigned long long index, unsigned int)
+	{
+		groupPartition(this->Partitions[index], found[index]);
+	});
+
+	vector<FOLD_GROUP*> groups;
+	unsigned long long functions = 0, total = 0;
+	for (unsigned long long i = 0; i < found.size(); i++)
+	{
+		functions += this->Partitions[i].size();
+		for (unsigned long long j = 0; j < found[i].size(); j++)
+		{
+			groups.push_back(&found[i][j]);
+			total += found[i][j].reclaimable;
+		}
+	}
+
+	sort(groups.begin(), groups.end(), [](const FOLD_GROUP* a, const FOLD_GROUP* b)
+	{
+		return a->reclaimable > b->reclaimable;
+	});
+
+	printf("Identical code folding candidates:\n");
+	printf("  Reclaimable\tSize\t\tCount\tFunctions\n");
+	for (unsigned long long i = 0; i < groups.size() && i < this->topCount; i++)
+	{
+		FOLD_GROUP* group = groups[i];
+		printf("  %9llu\t%8llu\t%llu\n", group->reclaimable, group->members[0]->size, group->distinct);
+
+		// Long groups of template instances are cut short.
+		const unsigned int shown = 8;
+		for (unsigned long long j = 0; j < group->members.size() && j < shown; j++)
+		{
+			FOLD_FUNCTION* member = group->members[j];
+			if (this->Files.size() > 1)
+				printf("\t\t\t\t\t%s (%s)\n", member->name.c_str(), this->Files[member->file].c_str());
+			else
+				printf("\t\t\t\t\t%s\n", member->name.c_str());
+		}
+		if (group->members.size() > shown)
+			printf("\t\t\t\t\t... and %zu more\n", group->members.size() - shown);
+	}
+
+	printf("\n  %zu groups, %llu bytes reclaimable over %llu functions\n\n", groups.size(), total, functions);
+}
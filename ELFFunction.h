@@ -10,8 +10,12 @@ public:
 	ELFFunction(FILE*);
 	~ELFFunction();
 	bool IsReady();
+
+	/*   Formats one symbol the way readSymbols prints it   */
+	static string FormatSymbol(unsigned long long, const Elf64_Sym&, string);
 private:
 	FILE* readFile = NULL;
+	ELFMapping* mapping = NULL;
 	bool InvalidELFFormat = false;
 
 private:
@@ -55,13 +59,20 @@ private:
                 unsigned long entrySize;
         } ELF_SECTIONHEADER64;
 
+	// Cached index of the symbol string table.
+	int stringTableIndex = -1;
+
+	// Symbols walked before windows behind the cursor are released.
+	static const unsigned long long SYMBOL_RELEASE_STRIDE = 4096;
+
 	ELF_HEADER* ReadELF_Identifier();
 	int GetIndexOfSection(string);
+	string GetSymbolName(unsigned int);
 protected:
 	// ELF header structures.
 	ELF_HEADER* identifier;
-	Elf32_Ehdr* elfHeader32;
-	Elf64_Ehdr* elfHeader64;
+	Elf32_Ehdr* elfHeader32 = NULL;
+	Elf64_Ehdr* elfHeader64 = NULL;
 
 	// Section header array.
 	vector<ELF_SECTIONHEADER32> SectionHeaders32;
@@ -101,6 +112,7 @@ ELFFunction::ELFFunction(string FileName)
 		this->InvalidELFFormat = true;
 		return;
 	}
+	this->mapping = new ELFMapping(fileno(this->readFile));
 
 	// Check the bitsystem and if is ELF format.
 	this->identifier = ReadELF_Identifier();
@@ -109,6 +121,8 @@ ELFFunction::ELFFunction(string FileName)
 /*   Deconstructor of the class.   */
 ELFFunction::~ELFFunction()
 {
+	if (this->mapping != NULL)
+		delete this->mapping;
 	if (this->readFile != NULL)
 		fclose(this->readFile);
 }
@@ -159,32 +173,29 @@ ELFFunction::ELF_HEADER* ELFFunction::ReadELF_Identifier()
 		return 0;
 	}
 
-	fseek(readFile, 0, SEEK_SET);
+	fseeko(readFile, 0, SEEK_SET);
 	return elfHeader;
 }
 
 /*   Gets the index number from the section table.   */
 int ELFFunction::GetIndexOfSection(string sectionName)
 {
-	// Get size of file.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
-
+	// Names are read from the section header string table, window by window.
 	if (this->identifier->bitSystem == 0x01)
 	{
-		// Read file again, in memory.
-		char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-			this->readFile->_fileno, 0); // File int and offset.
-		Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
-
-		// Get the names from string table.
-		Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
-		const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+		if (this->elfHeader32->e_shstrndx >= this->SectionHeaders32.size())
+			return -1;
+		ELF_SECTIONHEADER32 names = this->SectionHeaders32.at(this->elfHeader32->e_shstrndx);
 
 		// Keep looping until we got the right index.
-		for (int i = 0; i < this->elfHeader32->e_shnum; i++)
+		for (unsigned long long i = 0; i < this->SectionHeaders32.size(); i++)
 		{
-			string name = sh_strtab_p + shdr[i].sh_name;
+			unsigned int nameOffset = this->SectionHeaders32[i].sectionAddrName;
+			if (nameOffset >= names.sectionSizeFile)
+				continue;
+
+			string name = this->mapping->readString((unsigned long long)names.offset + nameOffset,
+				names.sectionSizeFile - nameOffset);
 			if (name == sectionName)
 				return i;
 		}
@@ -193,19 +204,19 @@ int ELFFunction::GetIndexOfSection(string sectionName)
 	}
 	else
 	{
-		// Read file again, in memory.
-		char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-		this->readFile->_fileno, 0); // File int and offset.
-		Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
-
-		// Get the names from string table.
-		Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
-		const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+		if (this->elfHeader64->e_shstrndx >= this->SectionHeaders64.size())
+			return -1;
+		ELF_SECTIONHEADER64 names = this->SectionHeaders64.at(this->elfHeader64->e_shstrndx);
 
 		// Keep looping until we got the right index.
-		for (int i = 0; i < this->elfHeader64->e_shnum; i++)
+		for (unsigned long long i = 0; i < this->SectionHeaders64.size(); i++)
 		{
-			string name = sh_strtab_p + shdr[i].sh_name;
+			unsigned int nameOffset = this->SectionHeaders64[i].sectionAddrName;
+			if (nameOffset >= names.sectionSizeFile)
+				continue;
+
+			string name = this->mapping->readString(names.offset + nameOffset,
+				names.sectionSizeFile - nameOffset);
 			if (name == sectionName)
 				return i;
 		}
@@ -214,6 +225,33 @@ int ELFFunction::GetIndexOfSection(string sectionName)
 	}
 }
 
+/*   Gets the name of a symbol from the string table.   */
+string ELFFunction::GetSymbolName(unsigned int nameOffset)
+{
+	// Only look up the string table once.
+	if (this->stringTableIndex < 0)
+		this->stringTableIndex = GetIndexOfSection(".strtab");
+	if (this->stringTableIndex < 0)
+		return "";
+
+	unsigned long long offset, size;
+	if (this->identifier->bitSystem == 0x01)
+	{
+		offset = this->SectionHeaders32.at(this->stringTableIndex).offset;
+		size = this->SectionHeaders32.at(this->stringTableIndex).sectionSizeFile;
+	}
+	else
+	{
+		offset = this->SectionHeaders64.at(this->stringTableIndex).offset;
+		size = this->SectionHeaders64.at(this->stringTableIndex).sectionSizeFile;
+	}
+
+	if (nameOffset >= size)
+		return "";
+
+	return this->mapping->readString(offset + nameOffset, size - nameOffset);
+}
+
 /*   Read all symbols.   */
 void ELFFunction::readSymbols()
 {
@@ -238,227 +276,168 @@ void ELFFunction::readSymbols32()
 {
 	// Get the symbol table from section header.
 	int index = GetIndexOfSection(".symtab");
+	if (index < 0)
+	{
+		printf("ELFFunction: No symbol table found!\n\n");
+		return;
+	}
 
 	// Read offset of section table with index of symbol table.
-	int symTableOffset = this->SectionHeaders32.at(index).offset;
-	fseek(this->readFile, symTableOffset, SEEK_SET);
+	unsigned long long symTableOffset = this->SectionHeaders32.at(index).offset;
 
 	// Size of section .symtab / size of entry (ELF_SECTIONHEADER32::entrySize) = count.
-	int countOfSymbols = this->SectionHeaders32.at(index).sectionSizeFile /
+	unsigned long long countOfSymbols = this->SectionHeaders32.at(index).sectionSizeFile /
 		this->SectionHeaders32.at(index).entrySize;
-	printf("Counted %d symbols\n\n", countOfSymbols);
+	printf("Counted %llu symbols\n\n", countOfSymbols);
 
 	// Loop trough every symbol.
-	for (int i = 0; i < countOfSymbols; i++)
+	for (unsigned long long i = 0; i < countOfSymbols; i++)
 	{
-		Elf32_Sym symbol;
-		if (fread(&symbol, sizeof(Elf32_Sym), 1, this->readFile) == 0)
+		// Only the window holding this entry is mapped, drop the ones behind us.
+		unsigned long long symbolOffset = symTableOffset + i * sizeof(Elf32_Sym);
+		if (i % SYMBOL_RELEASE_STRIDE == 0)
+			this->mapping->release(symTableOffset, symbolOffset - symTableOffset);
+
+		const Elf32_Sym* mapped = (const Elf32_Sym*)this->mapping->map(symbolOffset, sizeof(Elf32_Sym));
+		if (mapped == NULL)
 		{
-			printf("ELFFunction: Failed to read symbol [%d]\n\n", i);
+			printf("ELFFunction: Failed to read symbol [%llu]\n\n", i);
 			this->InvalidELFFormat = true;
 			return;
 		}
-
-		// Symbol name address.
-		printf("Symbol [%d]:\n", i);
-		printf("  Offset:\t\t%d bytes in string table (0x%x)\n",
-			symbol.st_name, symbol.st_name);
-
-		// I guess the same thing with the section table,
-		//  get the actual name from the string table.
-		if (symbol.st_name == 0)
-		{
-			printf("  Name:\t\t\n");
-		}
-		else
-		{
-			int stringTableIndex = GetIndexOfSection(".strtab");
-
-			struct stat st;
-			fstat(this->readFile->_fileno, &st);
-
-			char *p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-				this->readFile->_fileno, 0);
-
-			Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
-
-			Elf32_Shdr* sh_strtab = &shdr[stringTableIndex];
-			const char * const sh_strtab_p = p + sh_strtab->sh_offset;
-
-			printf("  Name:\t\t\t%s\n", sh_strtab_p + symbol.st_name);
-		}
-
-		// Symbol binding.
-		printf("  Binding:\t\t");
-		switch (ELF32_ST_BIND(symbol.st_info))
-		{
-			case 0x00:
-				printf("INVISIBLE");
-				break;
-			case 0x01:
-				printf("GLOBAL");
-				break;
-			case 0x02:
-				printf("WEAK");
-				break;
-			case 0x010:
-				printf("ENVIRON");
-				break;
-			default:
-				printf("DEFAULT");
-				break;
-		}
-		printf("\n");
-
-		// Symbol type.
-		printf("  Type:\t\t\t");
-		switch (ELF32_ST_TYPE(symbol.st_info))
-		{
-			case 0x0:
-				printf("NO TYPE\n");
-				break;
-			case 0x01:
-				printf("OBJECT\n");
-				break;
-			case 0x02:
-				printf("FUNCTION\n");
-				break;
-			case 0x03:
-				printf("SECTION\n");
-				break;
-			case 0x04:
-				printf("FILE\n");
-				break;
-			case 0x13:
-				printf("LOW PROCESSOR\n");
-				break;
-			case 0x14:
-				printf("HIGH PROCCESSOR\n");
-				break;
-			default:
-				printf("UNKNOWN\n");
-				break;
-		}
-
-		// Symbol size.
-		printf("  Size:\t\t\t%d bytes (%p)\n", symbol.st_size, reinterpret_cast<void*>(symbol.st_size));
-
-		// Symbol value.
-		printf("  Function address:\t0x%x\n\n", symbol.st_value);
+		Elf32_Sym symbol = *mapped;
+
+		// Widen to the 64 bit layout the formatter takes.
+		Elf64_Sym wide;
+		wide.st_name = symbol.st_name;
+		wide.st_info = symbol.st_info;
+		wide.st_other = symbol.st_other;
+		wide.st_shndx = symbol.st_shndx;
+		wide.st_value = symbol.st_value;
+		wide.st_size = symbol.st_size;
+
+		string NAME = symbol.st_name == 0 ? "" : GetSymbolName(symbol.st_name);
+		string text = FormatSymbol(i, wide, NAME);
+		fwrite(text.data(), 1, text.size(), stdout);
 	}
 }
 void ELFFunction::readSymbols64()
 {
 	// Get the symbol table from section header.
 	int index = GetIndexOfSection(".symtab");
+	if (index < 0)
+	{
+		printf("ELFFunction: No symbol table found!\n\n");
+		return;
+	}
 
 	// Read offset of section table with index of symbol table.
-	int symTableOffset = this->SectionHeaders64.at(index).offset;
-	fseek(this->readFile, symTableOffset, SEEK_SET);
+	unsigned long long symTableOffset = this->SectionHeaders64.at(index).offset;
 
 	// Size of section .symtab / size of entry (ELF_SECTIONHEADER32::entrySize) = count.
-	int countOfSymbols = this->SectionHeaders64.at(index).sectionSizeFile /
+	unsigned long long countOfSymbols = this->SectionHeaders64.at(index).sectionSizeFile /
 		this->SectionHeaders64.at(index).entrySize;
-	printf("Counted %d symbols\n\n", countOfSymbols);
+	printf("Counted %llu symbols\n\n", countOfSymbols);
 
 	// Loop trough every symbol.
-	for (int i = 0; i < countOfSymbols; i++)
+	for (unsigned long long i = 0; i < countOfSymbols; i++)
 	{
-		Elf64_Sym symbol;
-		if (fread(&symbol, sizeof(Elf64_Sym), 1, this->readFile) == 0)
+		// Only the window holding this entry is mapped, drop the ones behind us.
+		unsigned long long symbolOffset = symTableOffset + i * sizeof(Elf64_Sym);
+		if (i % SYMBOL_RELEASE_STRIDE == 0)
+			this->mapping->release(symTableOffset, symbolOffset - symTableOffset);
+
+		const Elf64_Sym* mapped = (const Elf64_Sym*)this->mapping->map(symbolOffset, sizeof(Elf64_Sym));
+		if (mapped == NULL)
 		{
-			printf("ELFFunction: Failed to read symbol [%d]\n\n", i);
+			printf("ELFFunction: Failed to read symbol [%llu]\n\n", i);
 			this->InvalidELFFormat = true;
 			return;
 		}
+		Elf64_Sym symbol = *mapped;
 
-		// Symbol name address.
-		printf("Symbol [%d]:\n", i);
-		printf("  Offset:\t\t%d bytes in string table (0x%x)\n",
-			symbol.st_name, symbol.st_name);
-
-		// I guess the same thing with the section table,
-		//  get the actual name from the string table.
-		if (symbol.st_name == 0)
-		{
-			printf("  Name:\t\t\n");
-		}
-		else
-		{
-			int stringTableIndex = GetIndexOfSection(".strtab");
-
-			struct stat st;
-			fstat(this->readFile->_fileno, &st);
-
-			char *p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-				this->readFile->_fileno, 0);
+		string NAME = symbol.st_name == 0 ? "" : GetSymbolName(symbol.st_name);
+		string text = FormatSymbol(i, symbol, NAME);
+		fwrite(text.data(), 1, text.size(), stdout);
+	}
+}
 
-			Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
+/*   Formats one symbol the way readSymbols prints it, so listings of
+	other containers (archive members) read the same.   */
+string ELFFunction::FormatSymbol(unsigned long long index, const Elf64_Sym& symbol, string name)
+{
+	string text;
+	char line[512];
 
-			Elf64_Shdr* sh_strtab = &shdr[stringTableIndex];
-			const char * const sh_strtab_p = p + sh_strtab->sh_offset;
+	// Symbol name address.
+	snprintf(line, sizeof(line), "Symbol [%llu]:\n  Offset:\t\t%d bytes in string table (0x%x)\n",
+		index, symbol.st_name, symbol.st_name);
+	text += line;
 
-			printf("  Name:\t\t\t%s\n", sh_strtab_p + symbol.st_name);
-		}
+	if (symbol.st_name == 0)
+		text += "  Name:\t\t\n";
+	else
+		text += "  Name:\t\t\t" + name + "\n";
 
-		// Symbol binding.
-		printf("  Binding:\t\t");
-		switch (ELF64_ST_BIND(symbol.st_info))
-		{
-			case 0x00:
-				printf("INVISIBLE");
-				break;
-			case 0x01:
-				printf("GLOBAL");
-				break;
-			case 0x02:
-				printf("WEAK");
-				break;
-			case 0x010:
-				printf("ENVIRON");
-				break;
-			default:
-				printf("DEFAULT");
-				break;
-		}
-		printf("\n");
+	// Symbol binding.
+	text += "  Binding:\t\t";
+	switch (ELF64_ST_BIND(symbol.st_info))
+	{
+		case 0x00:
+			text += "INVISIBLE";
+			break;
+		case 0x01:
+			text += "GLOBAL";
+			break;
+		case 0x02:
+			text += "WEAK";
+			break;
+		case 0x010:
+			text += "ENVIRON";
+			break;
+		default:
+			text += "DEFAULT";
+			break;
+	}
+	text += "\n";
 
-		// Symbol type.
-		printf("  Type:\t\t\t");
-		switch (ELF64_ST_TYPE(symbol.st_info))
-		{
-			case 0x0:
-				printf("NO TYPE\n");
-				break;
-			case 0x01:
-				printf("OBJECT\n");
-				break;
-			case 0x02:
-				printf("FUNCTION\n");
-				break;
-			case 0x03:
-				printf("SECTION\n");
-				break;
-			case 0x04:
-				printf("FILE\n");
-				break;
-			case 0x13:
-				printf("LOW PROCESSOR\n");
-				break;
-			case 0x14:
-				printf("HIGH PROCCESSOR\n");
-				break;
-			default:
-				printf("UNKNOWN\n");
-				break;
-		}
+	// Symbol type.
+	text += "  Type:\t\t\t";
+	switch (ELF64_ST_TYPE(symbol.st_info))
+	{
+		case 0x0:
+			text += "NO TYPE\n";
+			break;
+		case 0x01:
+			text += "OBJECT\n";
+			break;
+		case 0x02:
+			text += "FUNCTION\n";
+			break;
+		case 0x03:
+			text += "SECTION\n";
+			break;
+		case 0x04:
+			text += "FILE\n";
+			break;
+		case 0x13:
+			text += "LOW PROCESSOR\n";
+			break;
+		case 0x14:
+			text += "HIGH PROCCESSOR\n";
+			break;
+		default:
+			text += "UNKNOWN\n";
+			break;
+	}
 
-		// Symbol size.
-		printf("  Size:\t\t\t%ld bytes (%p)\n", symbol.st_size, reinterpret_cast<void*>(symbol.st_size));
+	// Symbol size and value.
+	snprintf(line, sizeof(line), "  Size:\t\t\t%llu bytes (%p)\n  Function address:\t0x%llx\n\n",
+		(unsigned long long)symbol.st_size, reinterpret_cast<void*>(symbol.st_size),
+		(unsigned long long)symbol.st_value);
+	text += line;
 
-		// Symbol value.
-		printf("  Function address:\t0x%lx\n\n", symbol.st_value);
-	}
+	return text;
 }
 
 /*   Reads one section symbol from list. (name specific)   */
@@ -473,14 +452,20 @@ void ELFFunction::readSymbol(string symbolName)
 	// Get the symbol table from section header.
 	int index = GetIndexOfSection(".symtab");
 
-	int symTableOffset, countOfSymbols;
+	if (index < 0)
+	{
+		printf("ELFFunction: No symbol table found!\n\n");
+		return;
+	}
+
+	unsigned long long symTableOffset, countOfSymbols;
 
 	// Get the symbol table offset and the count of symbols.
 	if (this->identifier->bitSystem == 0x01)
 	{
 		// Read offset of section table with index of symbol table.
 		symTableOffset = this->SectionHeaders32.at(index).offset;
-		fseek(this->readFile, symTableOffset, SEEK_SET);
+		fseeko(this->readFile, symTableOffset, SEEK_SET);
 
 		// Size of section .symtab / size of entry (ELF_SECTIONHEADER32::entrySize) = count.
 		countOfSymbols = this->SectionHeaders32.at(index).sectionSizeFile /
@@ -490,7 +475,7 @@ void ELFFunction::readSymbol(string symbolName)
 	{
 		// Read offset of section table with index of symbol table.
 		symTableOffset = this->SectionHeaders64.at(index).offset;
-		fseek(this->readFile, symTableOffset, SEEK_SET);
+		fseeko(this->readFile, symTableOffset, SEEK_SET);
 
 		// Size of section .symtab / size of entry (ELF_SECTIONHEADER32::entrySize) = count.
 		countOfSymbols = this->SectionHeaders64.at(index).sectionSizeFile /
@@ -498,14 +483,14 @@ void ELFFunction::readSymbol(string symbolName)
 	}
 
 	// Get specific symbol table.
-	for (int i = 0; i < countOfSymbols; i++)
+	for (unsigned long long i = 0; i < countOfSymbols; i++)
 	{
 		if (this->identifier->bitSystem == 0x01)
 		{
 			Elf32_Sym symbol;
 			if (fread(&symbol, sizeof(Elf32_Sym), 1, this->readFile) == 0)
 			{
-				printf("ELFFunction: Failed to read symbol [%d]\n\n", i);
+				printf("ELFFunction: Failed to read symbol [%llu]\n\n", i);
 				this->InvalidELFFormat = true;
 				return;
 			}
@@ -515,20 +500,7 @@ void ELFFunction::readSymbol(string symbolName)
 				continue;
 			else
 			{
-				int stringTableIndex = GetIndexOfSection(".strtab");
-
-				struct stat st;
-				fstat(this->readFile->_fileno, &st);
-
-				char *p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-					this->readFile->_fileno, 0);
-
-				Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
-
-				Elf32_Shdr* sh_strtab = &shdr[stringTableIndex];
-				const char * const sh_strtab_p = p + sh_strtab->sh_offset;
-
-				string NAME = sh_strtab_p + symbol.st_name;
+				string NAME = GetSymbolName(symbol.st_name);
 				if (NAME == symbolName)
 				{
 					printSymbol(symbol);
@@ -541,7 +513,7 @@ void ELFFunction::readSymbol(string symbolName)
 			Elf64_Sym symbol;
 			if (fread(&symbol, sizeof(Elf64_Sym), 1, this->readFile) == 0)
 			{
-				printf("ELFFunction: Failed to read symbol [%d]\n\n", i);
+				printf("ELFFunction: Failed to read symbol [%llu]\n\n", i);
 				this->InvalidELFFormat = true;
 				return;
 			}
@@ -551,20 +523,7 @@ void ELFFunction::readSymbol(string symbolName)
 				continue;
 			else
 			{
-				int stringTableIndex = GetIndexOfSection(".strtab");
-
-				struct stat st;
-				fstat(this->readFile->_fileno, &st);
-
-				char *p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-					this->readFile->_fileno, 0);
-
-				Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
-
-				Elf64_Shdr* sh_strtab = &shdr[stringTableIndex];
-				const char * const sh_strtab_p = p + sh_strtab->sh_offset;
-
-				string NAME = sh_strtab_p + symbol.st_name;
+				string NAME = GetSymbolName(symbol.st_name);
 				if (NAME == symbolName)
 				{
 					printSymbol(symbol);
@@ -600,20 +559,7 @@ void ELFFunction::printSymbol(Elf32_Sym symbol)
 		}
 		else
 		{
-			int stringTableIndex = GetIndexOfSection(".strtab");
-
-			struct stat st;
-			fstat(this->readFile->_fileno, &st);
-
-			char *p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-				this->readFile->_fileno, 0);
-
-			Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
-
-			Elf32_Shdr* sh_strtab = &shdr[stringTableIndex];
-			const char * const sh_strtab_p = p + sh_strtab->sh_offset;
-
-			printf("Name:\t\t\t%s\n", sh_strtab_p + symbol.st_name);
+			printf("Name:\t\t\t%s\n", GetSymbolName(symbol.st_name).c_str());
 		}
 
 		// Symbol name address.
@@ -688,20 +634,7 @@ void ELFFunction::printSymbol(Elf64_Sym symbol)
 		}
 		else
 		{
-			int stringTableIndex = GetIndexOfSection(".strtab");
-
-			struct stat st;
-			fstat(this->readFile->_fileno, &st);
-
-			char *p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-				this->readFile->_fileno, 0);
-
-			Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
-
-			Elf64_Shdr* sh_strtab = &shdr[stringTableIndex];
-			const char * const sh_strtab_p = p + sh_strtab->sh_offset;
-
-			printf("Name:\t\t\t%s\n", sh_strtab_p + symbol.st_name);
+			printf("Name:\t\t\t%s\n", GetSymbolName(symbol.st_name).c_str());
 		}
 
 		// Symbol name address.
@@ -777,24 +710,28 @@ bool ELFFunction::silentReadELFHeader()
 	}
 
 	// Change pointer to beginning of file.
-	fseek(this->readFile, 0, SEEK_SET);
-
-	// Get size of file.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
+	fseeko(this->readFile, 0, SEEK_SET);
 
-	// Read file.
-	char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-		this->readFile->_fileno, 0);
-
-	// Based on bit system.
+	// Copy the header, only the bytes of the header are read.
+	bool status;
 	if (this->identifier->bitSystem == 0x01)
 	{
-		this->elfHeader32 = (Elf32_Ehdr*)p;
+		if (this->elfHeader32 == NULL)
+			this->elfHeader32 = new Elf32_Ehdr();
+		status = this->mapping->read(0, this->elfHeader32, sizeof(Elf32_Ehdr));
 	}
 	else
 	{
-		this->elfHeader64 = (Elf64_Ehdr*)p;
+		if (this->elfHeader64 == NULL)
+			this->elfHeader64 = new Elf64_Ehdr();
+		status = this->mapping->read(0, this->elfHeader64, sizeof(Elf64_Ehdr));
+	}
+
+	if (status == false)
+	{
+		printf("Silent ELFHeader: Failed to read bytes for ELF header!\n");
+		this->InvalidELFFormat = true;
+		return false;
 	}
 
 	return true;
@@ -809,7 +746,8 @@ bool ELFFunction::silentReadSectionHeaders()
 
 	if (this->identifier->bitSystem == 0x01)
 	{
-		fseek(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+		this->SectionHeaders32.clear();
 
 		for (int i = 0; i < this->elfHeader32->e_shnum; i++)
 		{
@@ -828,7 +766,8 @@ bool ELFFunction::silentReadSectionHeaders()
 	}
 	else
 	{
-		fseek(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+		this->SectionHeaders64.clear();
 
 		for (int i = 0; i < this->elfHeader64->e_shnum; i++)
 		{
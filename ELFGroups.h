@@ -0,0 +1,232 @@
+#include "stdafx.h"
+
+#ifndef ELFGroups_H
+#define ELFGroups_H
+class ELFGroups
+{
+public:
+	explicit ELFGroups(vector<string>);
+
+	/*   Options   */
+	void setTopCount(unsigned int);
+	void setDemangle(bool);
+
+	/*   Print duplicated COMDAT groups   */
+	void readGroups();
+
+	static void CollectObjects(string, vector<string>&);
+private:
+	/*   Totals of one group signature.   */
+	typedef struct GroupTotal {
+		unsigned long long copies;		// Objects the group appears in.
+		unsigned long long bytes;		// Member section bytes over all copies.
+		unsigned long long largest;		// Largest single copy.
+	} GROUP_TOTAL;
+
+	vector<string> Files;
+	unsigned int topCount = 20;
+	bool demangle = false;
+
+	atomic<unsigned long long> objectCount;
+
+	void readObject(string, unordered_map<string, GROUP_TOTAL>&);
+};
+#endif // !~ ELFGroups_H
+
+/*   Constructor with object files and directories, directories are
+	searched for .o files.   */
+ELFGroups::ELFGroups(vector<string> paths) : objectCount(0)
+{
+	for (unsigned long long i = 0; i < paths.size(); i++)
+		CollectObjects(paths[i], this->Files);
+}
+
+/*   Options.   */
+void ELFGroups::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+void ELFGroups::setDemangle(bool enabled)
+{
+	this->demangle = enabled;
+}
+
+/*   Adds a file, or every .o file below a directory.   */
+void ELFGroups::CollectObjects(string path, vector<string>& files)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+	{
+		printf("ELFGroups: Cannot access %s! Error code: %d\n", path.c_str(), errno);
+		return;
+	}
+
+	if (S_ISDIR(info.st_mode) == false)
+	{
+		files.push_back(path);
+		return;
+	}
+
+	DIR* directory = opendir(path.c_str());
+	if (directory == NULL)
+		return;
+
+	struct dirent* entry;
+	while ((entry = readdir(directory)) != NULL)
+	{
+		string name = entry->d_name;
+		if (name == "." || name == "..")
+			continue;
+
+		string child = path + "/" + name;
+		if (entry->d_type == DT_DIR)
+			CollectObjects(child, files);
+		else if (name.size() > 2 && name.compare(name.size() - 2, 2, ".o") == 0)
+			files.push_back(child);
+		else if (entry->d_type == DT_UNKNOWN)
+		{
+			if (stat(child.c_str(), &info) == 0 && S_ISDIR(info.st_mode))
+				CollectObjects(child, files);
+		}
+	}
+	closedir(directory);
+}
+
+/*   Adds the section groups of one object to a worker's totals.   */
+void ELFGroups::readObject(string fileName, unordered_map<string, GROUP_TOTAL>& totals)
+{
+	ELFMapping mapping(fileName);
+	ELFImage image(&mapping);
+	if (image.IsReady() == false || image.getType() != ET_REL)
+		return;
+
+	for (unsigned long long i = 0; i < image.SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = image.SectionHeaders[i];
+		if (section.sh_type != SHT_GROUP || section.sh_size < 4)
+			continue;
+
+		const char* data = image.mapSection(i);
+		if (data == NULL)
+			continue;
+
+		// The first word holds the flags, the rest are member section indexes.
+		unsigned int flags;
+		memcpy(&flags, data, 4);
+		if ((flags & GRP_COMDAT) == 0)
+			continue;
+
+		unsigned long long bytes = 0;
+		for (unsigned long long offset = 4; offset + 4 <= section.sh_size; offset += 4)
+		{
+			unsigned int member;
+			memcpy(&member, data + offset, 4);
+			if (member < image.SectionHeaders.size() && image.SectionHeaders[member].sh_type != SHT_NOBITS)
+				bytes += image.SectionHeaders[member].sh_size;
+		}
+
+		// The signature is the symbol sh_info points at in the sh_link table.
+		string signature;
+		unsigned int table = section.sh_link;
+		if (table < image.SectionHeaders.size())
+		{
+			Elf64_Shdr& symbols = image.SectionHeaders[table];
+			unsigned long long entrySize = image.is64() ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+			unsigned long long offset = symbols.sh_offset + (unsigned long long)section.sh_info * entrySize;
+
+			Elf64_Sym symbol;
+			bool found;
+			if (image.is64() == true)
+				found = image.read(offset, &symbol, sizeof(symbol));
+			else
+			{
+				Elf32_Sym symbol32;
+				found = image.read(offset, &symbol32, sizeof(symbol32));
+				symbol.st_name = symbol32.st_name;
+			}
+
+			if (found == true && (unsigned long long)section.sh_info * entrySize < symbols.sh_size)
+				signature = image.GetSymbolName(table, symbol);
+		}
+		if (signature.empty())
+			signature = image.GetSectionName(i);
+
+		GROUP_TOTAL& total = totals[signature];
+		total.copies++;
+		total.bytes += bytes;
+		if (bytes > total.largest)
+			total.largest = bytes;
+	}
+
+	this->objectCount++;
+}
+
+/*   Reads every object on the pool and prints the group signatures that
+	cost the most bytes over all copies.   */
+void ELFGroups::readGroups()
+{
+	if (this->Files.empty())
+	{
+		printf("ELFGroups: No object files found!\n\n");
+		return;
+	}
+
+	ThreadPool pool;
+	vector<unordered_map<string, GROUP_TOTAL> > totals(pool.getThreadCount());
+	pool.parallelFor(this->Files.size(), [&](unsigned long long index, unsigned int worker)
+	{
+		readObject(this->Files[index], totals[worker]);
+	});
+
+	// Merge the worker tables into the first.
+	unordered_map<string, GROUP_TOTAL>& merged = totals[0];
+	for (unsigned long long i = 1; i < totals.size(); i++)
+	{
+		for (unordered_map<string, GROUP_TOTAL>::iterator it = totals[i].begin(); it != totals[i].end(); it++)
+		{
+			GROUP_TOTAL& total = merged[it->first];
+			total.copies += it->second.copies;
+			total.bytes += it->second.bytes;
+			if (it->second.largest > total.largest)
+				total.largest = it->second.largest;
+		}
+		totals[i].clear();
+	}
+
+	vector<pair<string, GROUP_TOTAL> > groups(merged.begin(), merged.end());
+	sort(groups.begin(), groups.end(), [](const pair<string, GROUP_TOTAL>& a, const pair<string, GROUP_TOTAL>& b)
+	{
+		return (a.second.bytes != b.second.bytes) ? a.second.bytes > b.second.bytes : a.first < b.first;
+	});
+
+	unsigned long long copies = 0, bytes = 0, duplicated = 0;
+	for (unsigned long long i = 0; i < groups.size(); i++)
+	{
+		copies += groups[i].second.copies;
+		bytes += groups[i].second.bytes;
+		duplicated += groups[i].second.bytes - groups[i].second.largest;
+	}
+
+	printf("COMDAT groups:\n");
+	printf("  Total bytes\tCopies\tBytes/copy\tSignature\n");
+	for (unsigned long long i = 0; i < groups.size() && i < this->topCount; i++)
+	{
+		string name = groups[i].first;
+		if (this->demangle == true)
+		{
+			int status;
+			char* demangled = abi::__cxa_demangle(name.c_str(), NULL, NULL, &status);
+			if (demangled != NULL)
+			{
+				name = demangled;
+				free(demangled);
+			}
+		}
+
+		GROUP_TOTAL& total = groups[i].second;
+		printf("  %11llu\t%6llu\t%10llu\t%s\n", total.bytes, total.copies, total.bytes / total.copies, name.c_str());
+	}
+
+	printf("\n  %llu objects, %llu groups, %zu signatures, %llu bytes in groups, %llu removed by deduplication\n\n",
+		(unsigned long long)this->objectCount, copies, groups.size(), bytes, duplicated);
+}
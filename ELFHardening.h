@@ -0,0 +1,434 @@
+#include "stdafx.h"
+
+#ifndef ELFHardening_H
+#define ELFHardening_H
+class ELFHardening
+{
+public:
+	explicit ELFHardening(string);
+	~ELFHardening();
+	bool IsReady();
+
+	/*   Print the hardening properties, or one line of them   */
+	void readHardening();
+	void readSummary();
+private:
+	/*   Properties found in the headers, dynamic section and notes.   */
+	typedef struct HardeningInfo {
+		bool relro;				// PT_GNU_RELRO present.
+		bool bindNow;				// DT_BIND_NOW, DF_BIND_NOW or DF_1_NOW.
+		bool stackSeen;				// PT_GNU_STACK present.
+		bool executableStack;
+		bool dynamic;
+		bool interpreter;			// PT_INTERP present.
+		bool pieFlag;				// DF_1_PIE.
+		bool textRelocations;
+		bool runPath;				// DT_RPATH or DT_RUNPATH.
+		bool canary;				// Imports a stack protector symbol.
+		bool propertiesSeen;			// .note.gnu.property found.
+		unsigned int x86Features;		// GNU_PROPERTY_X86_FEATURE_1_AND.
+		unsigned int x86IsaNeeded;		// GNU_PROPERTY_X86_ISA_1_NEEDED.
+		unsigned int aarch64Features;		// GNU_PROPERTY_AARCH64_FEATURE_1_AND.
+		unsigned long long importCount;
+		vector<string> fortified;		// __*_chk imports.
+	} HARDENING_INFO;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	HARDENING_INFO info;
+	bool scanned = false;
+
+	bool scan();
+	void readDynamic(const Elf64_Phdr&);
+	void readImports(unsigned long long, unsigned long long, unsigned long long, unsigned long long,
+		unsigned long long, unsigned long long);
+	void readProperties(const Elf64_Phdr&);
+	string GetRelro();
+	string GetPie();
+	string GetIsaLevel();
+};
+
+/*   Constructor with string of filename.   */
+ELFHardening::ELFHardening(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFHardening: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFHardening::~ELFHardening()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFHardening::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Reads the imports from the dynamic symbol table. With .gnu.hash the
+	linker puts every unhashed symbol, the undefined ones among them, in
+	front of symoffset, so only that prefix is read. With .hash alone
+	the whole table has to be read, its nchain is the symbol count.   */
+void ELFHardening::readImports(unsigned long long gnuHash, unsigned long long sysvHash, unsigned long long symbols,
+	unsigned long long symbolSize, unsigned long long strings, unsigned long long stringSize)
+{
+	unsigned long long count = 0;
+	if (gnuHash != 0)
+	{
+		unsigned int header[4];
+		if (this->image->read(gnuHash, header, sizeof(header)) == false)
+			return;
+		count = header[1];
+	}
+	else if (sysvHash != 0)
+	{
+		unsigned int header[2];
+		if (this->image->read(sysvHash, header, sizeof(header)) == false)
+			return;
+		count = header[1];
+	}
+	// Entries are copied whole, and a bogus count must not size the copy.
+	unsigned long long entrySize = this->image->is64() ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	if (count <= 1 || symbolSize < entrySize || count > this->image->getSize() / symbolSize)
+		return;
+
+	// Copied out, the name lookups below map the string table over it.
+	vector<char> table(count * symbolSize);
+	if (this->image->read(symbols, table.data(), table.size()) == false)
+		return;
+
+	for (unsigned long long i = 1; i < count; i++)
+	{
+		unsigned int name;
+		unsigned short section;
+		if (this->image->is64() == true)
+		{
+			Elf64_Sym symbol;
+			memcpy(&symbol, table.data() + i * symbolSize, sizeof(symbol));
+			name = symbol.st_name;
+			section = symbol.st_shndx;
+		}
+		else
+		{
+			Elf32_Sym symbol;
+			memcpy(&symbol, table.data() + i * symbolSize, sizeof(symbol));
+			name = symbol.st_name;
+			section = symbol.st_shndx;
+		}
+
+		if (section != SHN_UNDEF || name == 0 || name >= stringSize)
+			continue;
+		this->info.importCount++;
+
+		string text = this->image->readString(strings + name, stringSize - name);
+		if (text == "__stack_chk_fail" || text == "__stack_chk_guard" || text == "__stack_chk_fail_local")
+			this->info.canary = true;
+		else if (text.size() > 6 && text.compare(0, 2, "__") == 0 && text.compare(text.size() - 4, 4, "_chk") == 0)
+			this->info.fortified.push_back(text);
+	}
+
+	sort(this->info.fortified.begin(), this->info.fortified.end());
+	this->info.fortified.erase(unique(this->info.fortified.begin(), this->info.fortified.end()),
+		this->info.fortified.end());
+}
+
+/*   Reads the flags of PT_DYNAMIC and the tables the imports need.   */
+void ELFHardening::readDynamic(const Elf64_Phdr& segment)
+{
+	this->info.dynamic = true;
+
+	const char* data = this->image->map(segment.p_offset, segment.p_filesz);
+	if (data == NULL)
+		return;
+
+	unsigned long long gnuHash = 0, sysvHash = 0, symbols = 0, strings = 0, stringSize = 0;
+	unsigned long long symbolSize = this->image->is64() ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	unsigned long long entrySize = this->image->is64() ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+
+	for (unsigned long long offset = 0; offset + entrySize <= segment.p_filesz; offset += entrySize)
+	{
+		long long tag;
+		unsigned long long value;
+		if (this->image->is64() == true)
+		{
+			Elf64_Dyn dynamic;
+			memcpy(&dynamic, data + offset, sizeof(dynamic));
+			tag = dynamic.d_tag;
+			value = dynamic.d_un.d_val;
+		}
+		else
+		{
+			Elf32_Dyn dynamic;
+			memcpy(&dynamic, data + offset, sizeof(dynamic));
+			tag = dynamic.d_tag;
+			value = dynamic.d_un.d_val;
+		}
+
+		if (tag == DT_NULL)
+			break;
+
+		switch (tag)
+		{
+			case DT_BIND_NOW:
+				this->info.bindNow = true;
+				break;
+			case DT_FLAGS:
+				if (value & DF_BIND_NOW)
+					this->info.bindNow = true;
+				if (value & DF_TEXTREL)
+					this->info.textRelocations = true;
+				break;
+			case DT_FLAGS_1:
+				if (value & DF_1_NOW)
+					this->info.bindNow = true;
+				if (value & DF_1_PIE)
+					this->info.pieFlag = true;
+				break;
+			case DT_TEXTREL:
+				this->info.textRelocations = true;
+				break;
+			case DT_RPATH:
+			case DT_RUNPATH:
+				this->info.runPath = true;
+				break;
+			case DT_GNU_HASH:
+				this->image->GetFileOffset(value, gnuHash);
+				break;
+			case DT_HASH:
+				this->image->GetFileOffset(value, sysvHash);
+				break;
+			case DT_SYMTAB:
+				this->image->GetFileOffset(value, symbols);
+				break;
+			case DT_SYMENT:
+				symbolSize = value;
+				break;
+			case DT_STRTAB:
+				this->image->GetFileOffset(value, strings);
+				break;
+			case DT_STRSZ:
+				stringSize = value;
+				break;
+		}
+	}
+
+	if (symbols != 0 && strings != 0)
+		readImports(gnuHash, sysvHash, symbols, symbolSize, strings, stringSize);
+}
+
+/*   Reads the GNU property notes of a PT_GNU_PROPERTY or PT_NOTE segment.   */
+void ELFHardening::readProperties(const Elf64_Phdr& segment)
+{
+	const char* data = this->image->map(segment.p_offset, segment.p_filesz);
+	if (data == NULL)
+		return;
+
+	// Property notes are aligned to 8 bytes in 64 bit files, 4 otherwise.
+	unsigned long long align = this->image->is64() ? 8 : 4;
+	unsigned long long offset = 0;
+	while (offset + sizeof(Elf64_Nhdr) <= segment.p_filesz)
+	{
+		Elf64_Nhdr note;
+		memcpy(&note, data + offset, sizeof(note));
+		unsigned long long name = offset + sizeof(note);
+		unsigned long long descriptor = name + ((note.n_namesz + 3) & ~3ULL);
+		unsigned long long next = descriptor + ((note.n_descsz + align - 1) & ~(align - 1));
+		if (descriptor + note.n_descsz > segment.p_filesz)
+			break;
+
+		if (note.n_type == NT_GNU_PROPERTY_TYPE_0 && note.n_namesz == 4 && memcmp(data + name, "GNU", 4) == 0)
+		{
+			this->info.propertiesSeen = true;
+
+			unsigned long long property = descriptor;
+			while (property + 8 <= descriptor + note.n_descsz)
+			{
+				unsigned int type, size, value = 0;
+				memcpy(&type, data + property, 4);
+				memcpy(&size, data + property + 4, 4);
+				if (property + 8 + size > descriptor + note.n_descsz)
+					break;
+				if (size >= 4)
+					memcpy(&value, data + property + 8, 4);
+
+				if (type == GNU_PROPERTY_X86_FEATURE_1_AND)
+					this->info.x86Features = value;
+				else if (type == GNU_PROPERTY_X86_ISA_1_NEEDED)
+					this->info.x86IsaNeeded = value;
+				else if (type == GNU_PROPERTY_AARCH64_FEATURE_1_AND)
+					this->info.aarch64Features = value;
+
+				property += 8 + ((size + align - 1) & ~(align - 1));
+			}
+		}
+
+		if (next <= offset)
+			break;
+		offset = next;
+	}
+}
+
+/*   Collects the properties from the program headers and what they point
+	at, the section headers and symbol tables are never walked.   */
+bool ELFHardening::scan()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return false;
+	}
+	if (this->scanned == true)
+		return true;
+	this->scanned = true;
+
+	this->info.relro = false;
+	this->info.bindNow = false;
+	this->info.stackSeen = false;
+	this->info.executableStack = false;
+	this->info.dynamic = false;
+	this->info.interpreter = false;
+	this->info.pieFlag = false;
+	this->info.textRelocations = false;
+	this->info.runPath = false;
+	this->info.canary = false;
+	this->info.propertiesSeen = false;
+	this->info.x86Features = 0;
+	this->info.x86IsaNeeded = 0;
+	this->info.aarch64Features = 0;
+	this->info.importCount = 0;
+
+	bool propertySegment = false;
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		if (this->image->ProgramHeaders[i].p_type == PT_GNU_PROPERTY)
+			propertySegment = true;
+	}
+
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		switch (segment.p_type)
+		{
+			case PT_GNU_RELRO:
+				this->info.relro = true;
+				break;
+			case PT_GNU_STACK:
+				this->info.stackSeen = true;
+				this->info.executableStack = (segment.p_flags & PF_X) != 0;
+				break;
+			case PT_INTERP:
+				this->info.interpreter = true;
+				break;
+			case PT_DYNAMIC:
+				readDynamic(segment);
+				break;
+			case PT_GNU_PROPERTY:
+				readProperties(segment);
+				break;
+			case PT_NOTE:
+				// Older linkers only emit the note inside PT_NOTE.
+				if (propertySegment == false)
+					readProperties(segment);
+				break;
+		}
+	}
+
+	return true;
+}
+
+/*   RELRO level as checksec names it.   */
+string ELFHardening::GetRelro()
+{
+	if (this->info.relro == false)
+		return "None";
+	return this->info.bindNow ? "Full" : "Partial";
+}
+
+/*   PIE state from the type, the interpreter and DF_1_PIE.   */
+string ELFHardening::GetPie()
+{
+	unsigned short type = this->image->getType();
+	if (type == ET_EXEC)
+		return "No";
+	if (type != ET_DYN)
+		return "N/A";
+	if (this->info.pieFlag == true || this->info.interpreter == true)
+		return "Yes";
+	return "DSO";
+}
+
+/*   Highest x86-64 ISA level the binary says it needs.   */
+string ELFHardening::GetIsaLevel()
+{
+	if (this->info.x86IsaNeeded & GNU_PROPERTY_X86_ISA_1_V4)
+		return "v4";
+	if (this->info.x86IsaNeeded & GNU_PROPERTY_X86_ISA_1_V3)
+		return "v3";
+	if (this->info.x86IsaNeeded & GNU_PROPERTY_X86_ISA_1_V2)
+		return "v2";
+	if (this->info.x86IsaNeeded & GNU_PROPERTY_X86_ISA_1_BASELINE)
+		return "baseline";
+	return "unmarked";
+}
+
+/*   Prints every property with a short explanation.   */
+void ELFHardening::readHardening()
+{
+	if (scan() == false)
+		return;
+
+	unsigned short machine = this->image->getMachine();
+	printf("Hardening:\n");
+	printf("  RELRO:\t\t%s\n", GetRelro().c_str());
+	printf("  Stack canary:\t\t%s\n", this->info.canary ? "Yes" : "No");
+	printf("  NX stack:\t\t%s\n", (this->info.stackSeen && this->info.executableStack == false) ? "Yes" :
+		(this->info.stackSeen ? "No (executable PT_GNU_STACK)" : "No (PT_GNU_STACK missing)"));
+	printf("  PIE:\t\t\t%s\n", GetPie().c_str());
+	printf("  Fortify:\t\t%zu fortified imports\n", this->info.fortified.size());
+	for (unsigned long long i = 0; i < this->info.fortified.size(); i++)
+		printf("\t\t\t  %s\n", this->info.fortified[i].c_str());
+	printf("  RPATH/RUNPATH:\t%s\n", this->info.runPath ? "Yes" : "No");
+	printf("  TEXTREL:\t\t%s\n", this->info.textRelocations ? "Yes" : "No");
+
+	if (machine == EM_X86_64 || machine == EM_386)
+	{
+		printf("  CET IBT:\t\t%s\n", (this->info.x86Features & GNU_PROPERTY_X86_FEATURE_1_IBT) ? "Yes" : "No");
+		printf("  CET SHSTK:\t\t%s\n", (this->info.x86Features & GNU_PROPERTY_X86_FEATURE_1_SHSTK) ? "Yes" : "No");
+		printf("  x86 ISA needed:\t%s\n", GetIsaLevel().c_str());
+	}
+	else if (machine == EM_AARCH64)
+	{
+		printf("  BTI:\t\t\t%s\n", (this->info.aarch64Features & GNU_PROPERTY_AARCH64_FEATURE_1_BTI) ? "Yes" : "No");
+		printf("  PAC:\t\t\t%s\n", (this->info.aarch64Features & GNU_PROPERTY_AARCH64_FEATURE_1_PAC) ? "Yes" : "No");
+	}
+
+	if (this->info.dynamic == false)
+		printf("\n  Statically linked, canary and fortify cannot be seen from imports\n");
+	printf("\n");
+}
+
+/*   Prints the properties on one line, for batch runs over many files.   */
+void ELFHardening::readSummary()
+{
+	if (scan() == false)
+		return;
+
+	printf("relro=%s canary=%s nx=%s pie=%s fortify=%zu rpath=%s textrel=%s ibt=%s shstk=%s isa=%s\n\n",
+		GetRelro().c_str(), this->info.canary ? "yes" : "no",
+		(this->info.stackSeen && this->info.executableStack == false) ? "yes" : "no", GetPie().c_str(),
+		this->info.fortified.size(), this->info.runPath ? "yes" : "no", this->info.textRelocations ? "yes" : "no",
+		(this->info.x86Features & GNU_PROPERTY_X86_FEATURE_1_IBT) ? "yes" : "no",
+		(this->info.x86Features & GNU_PROPERTY_X86_FEATURE_1_SHSTK) ? "yes" : "no", GetIsaLevel().c_str());
+}
+
+#endif // !~ ELFHardening_H
@@ -0,0 +1,212 @@
+#include "stdafx.h"
+
+#ifndef ELFHash_H
+#define ELFHash_H
+class ELFHash
+{
+public:
+	explicit ELFHash(string);
+	~ELFHash();
+	bool IsReady();
+
+	/*   Options   */
+	void setSHA256(bool);
+
+	/*   Print hashes of every section and segment   */
+	void readHashes();
+private:
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	ThreadPool* pool = NULL;
+	bool InvalidELFFormat = false;
+	bool sha256 = false;
+
+	// Chunks are hashed in parallel, batches keep the mapped bytes inside
+	//  the --max-map budget.
+	static constexpr unsigned long long CHUNK_SIZE = 4ULL << 20;
+
+	bool hashRange(unsigned long long, unsigned long long, unsigned long long&, string&);
+};
+#endif // !~ ELFHash_H
+
+/*   Constructor with string of filename.   */
+ELFHash::ELFHash(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFHash: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	this->pool = new ThreadPool();
+}
+
+/*   Deconstructor of the class.   */
+ELFHash::~ELFHash()
+{
+	if (this->pool != NULL)
+		delete this->pool;
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFHash::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFHash::setSHA256(bool enabled)
+{
+	this->sha256 = enabled;
+}
+
+/*   Hashes a range of the file. The range is split in chunks that are
+	hashed on the pool, the chunk digests are combined in order.   */
+bool ELFHash::hashRange(unsigned long long offset, unsigned long long size,
+	unsigned long long& digest, string& sha)
+{
+	unsigned long long chunkCount = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	if (chunkCount == 0)
+		chunkCount = 1;
+
+	// A batch takes at most half the budget, the rest stays for the
+	//  headers and names mapped around it.
+	unsigned long long batchLimit = ELFMapping::getMaxMap() / 2 / CHUNK_SIZE;
+	if (batchLimit == 0)
+		batchLimit = 1;
+
+	vector<unsigned long long> digests(chunkCount, 0);
+	SHA256 context;
+
+	for (unsigned long long first = 0; first < chunkCount; first += batchLimit)
+	{
+		unsigned long long batchOffset = first * CHUNK_SIZE;
+		unsigned long long batchSize = min(size - batchOffset, batchLimit * CHUNK_SIZE);
+		unsigned long long batchChunks = min(chunkCount - first, batchLimit);
+
+		// Mapped on this thread, the workers only read the memory.
+		const char* data = "";
+		if (batchSize > 0)
+		{
+			data = this->image->map(offset + batchOffset, batchSize);
+			if (data == NULL)
+				return false;
+		}
+
+		this->pool->parallelFor(batchChunks, [&](unsigned long long index, unsigned int)
+		{
+			unsigned long long start = index * CHUNK_SIZE;
+			unsigned long long length = min(batchSize - start, CHUNK_SIZE);
+			digests[first + index] = XXHash64::Digest(data + start, length);
+		});
+
+		if (this->sha256 == true)
+			context.update(data, batchSize);
+
+		if (batchSize > 0)
+			this->mapping->release(this->image->getBase() + offset + batchOffset, batchSize);
+	}
+
+	digest = XXHash64::Combine(digests, size);
+	if (this->sha256 == true)
+		sha = context.final();
+	return true;
+}
+
+/*   Prints the hashes of every section and segment.   */
+void ELFHash::readHashes()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	printf("Section hashes:\n");
+	printf("  [Nr]\tName\t\t\tSize\t\tXXH64%s\n", this->sha256 ? "\t\t\tSHA-256" : "");
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		string name = this->image->GetSectionName(i);
+
+		// No file contents to hash.
+		if (section.sh_type == SHT_NULL || section.sh_type == SHT_NOBITS)
+		{
+			printf("  [%llu]\t%-16s\t0x%08llx\t(no data)\n", i, name.c_str(), (unsigned long long)section.sh_size);
+			continue;
+		}
+
+		unsigned long long digest;
+		string sha;
+		if (hashRange(section.sh_offset, section.sh_size, digest, sha) == false)
+		{
+			printf("  [%llu]\t%-16s\t0x%08llx\t(outside of file)\n", i, name.c_str(), (unsigned long long)section.sh_size);
+			continue;
+		}
+
+		printf("  [%llu]\t%-16s\t0x%08llx\t%016llx%s%s\n", i, name.c_str(), (unsigned long long)section.sh_size,
+			digest, this->sha256 ? "\t" : "", sha.c_str());
+	}
+
+	if (this->image->ProgramHeaders.empty())
+		return;
+
+	printf("\nSegment hashes:\n");
+	printf("  [Nr]\tType\t\t\tSize\t\tXXH64%s\n", this->sha256 ? "\t\t\tSHA-256" : "");
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+
+		const char* type;
+		switch (segment.p_type)
+		{
+			case PT_LOAD:
+				type = "LOAD";
+				break;
+			case PT_DYNAMIC:
+				type = "DYNAMIC";
+				break;
+			case PT_INTERP:
+				type = "INTERP";
+				break;
+			case PT_NOTE:
+				type = "NOTE";
+				break;
+			case PT_PHDR:
+				type = "PHDR";
+				break;
+			case PT_TLS:
+				type = "TLS";
+				break;
+			case PT_GNU_EH_FRAME:
+				type = "GNU_EH_FRAME";
+				break;
+			case PT_GNU_STACK:
+				type = "GNU_STACK";
+				break;
+			case PT_GNU_RELRO:
+				type = "GNU_RELRO";
+				break;
+			default:
+				type = "OTHER";
+				break;
+		}
+
+		unsigned long long digest;
+		string sha;
+		if (hashRange(segment.p_offset, segment.p_filesz, digest, sha) == false)
+		{
+			printf("  [%llu]\t%-16s\t0x%08llx\t(outside of file)\n", i, type, (unsigned long long)segment.p_filesz);
+			continue;
+		}
+
+		printf("  [%llu]\t%-16s\t0x%08llx\t%016llx%s%s\n", i, type, (unsigned long long)segment.p_filesz,
+			digest, this->sha256 ? "\t" : "", sha.c_str());
+	}
+	printf("\n");
+}
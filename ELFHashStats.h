@@ -0,0 +1,458 @@
+#include "stdafx.h"
+
+#ifndef ELFHashStats_H
+#define ELFHashStats_H
+class ELFHashStats
+{
+public:
+	explicit ELFHashStats(string);
+	~ELFHashStats();
+	bool IsReady();
+
+	/*   Lookups to simulate, the imports of another binary   */
+	bool addImporter(string);
+
+	/*   Print the quality of .gnu.hash and .hash   */
+	void readStats();
+private:
+	/*   Decoded .gnu.hash section.   */
+	typedef struct GnuHashTable {
+		unsigned int bucketCount;
+		unsigned int symbolOffset;		// First dynsym index in the table.
+		unsigned int bloomShift;
+		unsigned int bloomBits;			// Bits per bloom word.
+		vector<unsigned long long> bloom;
+		vector<unsigned int> buckets;
+		vector<unsigned int> chains;		// Hashes from symbolOffset on.
+	} GNU_HASH_TABLE;
+
+	/*   Decoded System V .hash section.   */
+	typedef struct SysvHashTable {
+		vector<unsigned int> buckets;
+		vector<unsigned int> chains;
+	} SYSV_HASH_TABLE;
+
+	/*   Work of a batch of lookups.   */
+	typedef struct LookupCost {
+		unsigned long long lookups;
+		unsigned long long bloomRejects;	// Stopped by the bloom filter.
+		unsigned long long emptyBuckets;	// Stopped by an empty bucket.
+		unsigned long long hashCompares;	// Chain entries visited.
+		unsigned long long stringCompares;	// Names compared.
+		unsigned long long found;
+	} LOOKUP_COST;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	int dynamicSymbols = -1;
+	vector<Elf64_Sym> Symbols;
+	vector<string> Names;			// Names of Symbols.
+	vector<string> Imports;
+	bool importers = false;
+
+	bool readGnuTable(int, GNU_HASH_TABLE&);
+	bool readSysvTable(int, SYSV_HASH_TABLE&);
+	void lookupGnu(const GNU_HASH_TABLE&, const string&, LOOKUP_COST&);
+	void lookupSysv(const SYSV_HASH_TABLE&, const string&, LOOKUP_COST&);
+	void readGnuHash(int);
+	void readSysvHash(int);
+	static void PrintChains(vector<unsigned int>&, unsigned long long);
+	static void PrintCost(const char*, const LOOKUP_COST&, bool);
+	static void CollectImports(ELFImage*, vector<string>&);
+};
+#endif // !~ ELFHashStats_H
+
+/*   Constructor with string of filename.   */
+ELFHashStats::ELFHashStats(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFHashStats: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		if (this->image->SectionHeaders[i].sh_type == SHT_DYNSYM)
+			this->dynamicSymbols = i;
+	}
+	if (this->dynamicSymbols < 0 || this->image->readSymbols(this->dynamicSymbols, this->Symbols) == false)
+	{
+		printf("ELFHashStats: No dynamic symbol table found!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	this->Names.resize(this->Symbols.size());
+	for (unsigned long long i = 0; i < this->Symbols.size(); i++)
+		this->Names[i] = this->image->GetSymbolName(this->dynamicSymbols, this->Symbols[i]);
+}
+
+/*   Deconstructor of the class.   */
+ELFHashStats::~ELFHashStats()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFHashStats::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Undefined dynamic symbols of a binary, the names it imports.   */
+void ELFHashStats::CollectImports(ELFImage* image, vector<string>& imports)
+{
+	for (unsigned long long i = 0; i < image->SectionHeaders.size(); i++)
+	{
+		if (image->SectionHeaders[i].sh_type != SHT_DYNSYM)
+			continue;
+
+		vector<Elf64_Sym> symbols;
+		image->readSymbols(i, symbols);
+		for (unsigned long long j = 1; j < symbols.size(); j++)
+		{
+			if (symbols[j].st_shndx == SHN_UNDEF && symbols[j].st_name != 0)
+				imports.push_back(image->GetSymbolName(i, symbols[j]));
+		}
+	}
+}
+
+/*   Adds the imports of another binary to the simulated lookups.   */
+bool ELFHashStats::addImporter(string fileName)
+{
+	ELFMapping mapping(fileName);
+	ELFImage image(&mapping);
+	if (image.IsReady() == false)
+	{
+		printf("ELFHashStats: Failed to read %s!\n", fileName.c_str());
+		return false;
+	}
+
+	CollectImports(&image, this->Imports);
+	this->importers = true;
+	return true;
+}
+
+/*   Decodes .gnu.hash: a header of four words, the bloom filter in words
+	of the ELF class, the buckets, then one hash per symbol whose low bit
+	marks the end of a chain.   */
+bool ELFHashStats::readGnuTable(int index, GNU_HASH_TABLE& table)
+{
+	Elf64_Shdr& section = this->image->SectionHeaders[index];
+	const char* data = this->image->mapSection(index);
+	if (data == NULL || section.sh_size < 16)
+		return false;
+
+	unsigned int header[4];
+	memcpy(header, data, 16);
+	table.bucketCount = header[0];
+	table.symbolOffset = header[1];
+	table.bloomShift = header[3];
+
+	unsigned long long wordSize = this->image->is64() ? 8 : 4;
+	table.bloomBits = wordSize * 8;
+	unsigned long long bloomOffset = 16;
+	unsigned long long bucketOffset = bloomOffset + (unsigned long long)header[2] * wordSize;
+	unsigned long long chainOffset = bucketOffset + (unsigned long long)table.bucketCount * 4;
+	if (header[2] == 0 || table.bucketCount == 0 || chainOffset > section.sh_size ||
+		table.symbolOffset > this->Symbols.size())
+		return false;
+
+	table.bloom.resize(header[2]);
+	for (unsigned int i = 0; i < header[2]; i++)
+	{
+		table.bloom[i] = 0;
+		memcpy(&table.bloom[i], data + bloomOffset + i * wordSize, wordSize);
+	}
+
+	table.buckets.resize(table.bucketCount);
+	memcpy(table.buckets.data(), data + bucketOffset, (unsigned long long)table.bucketCount * 4);
+
+	unsigned long long chainCount = this->Symbols.size() - table.symbolOffset;
+	if (chainOffset + chainCount * 4 > section.sh_size)
+		chainCount = (section.sh_size - chainOffset) / 4;
+	table.chains.resize(chainCount);
+	memcpy(table.chains.data(), data + chainOffset, chainCount * 4);
+	return true;
+}
+
+/*   Decodes .hash: nbucket, nchain, the buckets and the chains.   */
+bool ELFHashStats::readSysvTable(int index, SYSV_HASH_TABLE& table)
+{
+	Elf64_Shdr& section = this->image->SectionHeaders[index];
+	const char* data = this->image->mapSection(index);
+	if (data == NULL || section.sh_size < 8)
+		return false;
+
+	// Entries are 8 bytes wide on some 64 bit targets (s390x, alpha).
+	if (section.sh_entsize != 0 && section.sh_entsize != 4)
+		return false;
+
+	unsigned int header[2];
+	memcpy(header, data, 8);
+	if (header[0] == 0 || 8 + ((unsigned long long)header[0] + header[1]) * 4 > section.sh_size)
+		return false;
+
+	table.buckets.resize(header[0]);
+	memcpy(table.buckets.data(), data + 8, (unsigned long long)header[0] * 4);
+	table.chains.resize(header[1]);
+	memcpy(table.chains.data(), data + 8 + (unsigned long long)header[0] * 4, (unsigned long long)header[1] * 4);
+	return true;
+}
+
+/*   Looks a name up the way ld.so does in .gnu.hash and adds the work.   */
+void ELFHashStats::lookupGnu(const GNU_HASH_TABLE& table, const string& name, LOOKUP_COST& cost)
+{
+	cost.lookups++;
+	unsigned int hash = SymbolHash::GNU(name.c_str());
+
+	unsigned long long word = table.bloom[(hash / table.bloomBits) % table.bloom.size()];
+	unsigned long long mask = (1ULL << (hash % table.bloomBits)) | (1ULL << ((hash >> table.bloomShift) % table.bloomBits));
+	if ((word & mask) != mask)
+	{
+		cost.bloomRejects++;
+		return;
+	}
+
+	unsigned int symbol = table.buckets[hash % table.bucketCount];
+	if (symbol < table.symbolOffset)
+	{
+		cost.emptyBuckets++;
+		return;
+	}
+
+	for (unsigned long long i = symbol - table.symbolOffset; i < table.chains.size(); i++)
+	{
+		cost.hashCompares++;
+		if ((table.chains[i] | 1) == (hash | 1))
+		{
+			cost.stringCompares++;
+			if (this->Names[i + table.symbolOffset] == name)
+			{
+				cost.found++;
+				return;
+			}
+		}
+		if (table.chains[i] & 1)
+			return;
+	}
+}
+
+/*   Looks a name up in .hash, where every defined chain entry costs a name
+	compare. Undefined entries are skipped without one, as ld.so does, so an
+	import never finds its own slot.   */
+void ELFHashStats::lookupSysv(const SYSV_HASH_TABLE& table, const string& name, LOOKUP_COST& cost)
+{
+	cost.lookups++;
+	unsigned int symbol = table.buckets[SymbolHash::SysV(name.c_str()) % table.buckets.size()];
+	if (symbol == 0)
+	{
+		cost.emptyBuckets++;
+		return;
+	}
+
+	// Bounded by the chain count against looping tables.
+	for (unsigned long long steps = 0; symbol != 0 && symbol < table.chains.size() && steps < table.chains.size(); steps++)
+	{
+		cost.hashCompares++;
+		if (symbol < this->Symbols.size() && this->Symbols[symbol].st_shndx != SHN_UNDEF)
+		{
+			cost.stringCompares++;
+			if (this->Names[symbol] == name)
+			{
+				cost.found++;
+				return;
+			}
+		}
+		symbol = table.chains[symbol];
+	}
+}
+
+/*   Prints the bucket occupancy histogram and chain length percentiles.   */
+void ELFHashStats::PrintChains(vector<unsigned int>& lengths, unsigned long long symbols)
+{
+	const unsigned int largest = 8;
+	unsigned long long histogram[largest + 1] = { 0 };
+	for (unsigned long long i = 0; i < lengths.size(); i++)
+		histogram[min(lengths[i], largest)]++;
+
+	printf("  Bucket occupancy:\n");
+	printf("    Length\tBuckets\t\tShare\n");
+	for (unsigned int i = 0; i <= largest; i++)
+	{
+		printf("    %u%s\t\t%llu\t\t%5.1f%%\n", i, (i == largest) ? "+" : "", histogram[i],
+			100.0 * histogram[i] / lengths.size());
+	}
+
+	// Percentiles over the buckets that hold symbols.
+	vector<unsigned int> used;
+	for (unsigned long long i = 0; i < lengths.size(); i++)
+	{
+		if (lengths[i] > 0)
+			used.push_back(lengths[i]);
+	}
+	if (used.empty())
+		return;
+	sort(used.begin(), used.end());
+
+	printf("  Chain length: p50 %u, p90 %u, p99 %u, max %u, %.2f symbols per used bucket\n",
+		used[(used.size() - 1) * 50 / 100], used[(used.size() - 1) * 90 / 100], used[(used.size() - 1) * 99 / 100],
+		used.back(), (double)symbols / used.size());
+}
+
+/*   Prints the average work of a batch of lookups, bloom rejects only for
+	tables that have a filter.   */
+void ELFHashStats::PrintCost(const char* label, const LOOKUP_COST& cost, bool bloom)
+{
+	if (cost.lookups == 0)
+		return;
+
+	double lookups = (double)cost.lookups;
+	printf("  %s: %llu lookups, %llu found\n", label, cost.lookups, cost.found);
+	if (bloom == true)
+		printf("    %.1f%% stopped by bloom, %.1f%% by an empty bucket\n", 100.0 * cost.bloomRejects / lookups,
+			100.0 * cost.emptyBuckets / lookups);
+	else
+		printf("    %.1f%% stopped by an empty bucket\n", 100.0 * cost.emptyBuckets / lookups);
+	printf("    %.2f hash compares, %.2f string compares per lookup\n", cost.hashCompares / lookups,
+		cost.stringCompares / lookups);
+}
+
+/*   Bloom density, chain shape and simulated lookups of .gnu.hash.   */
+void ELFHashStats::readGnuHash(int index)
+{
+	GNU_HASH_TABLE table;
+	if (readGnuTable(index, table) == false)
+	{
+		printf("ELFHashStats: Malformed %s section!\n\n", this->image->GetSectionName(index).c_str());
+		return;
+	}
+
+	unsigned long long bitsSet = 0;
+	for (unsigned long long i = 0; i < table.bloom.size(); i++)
+		bitsSet += __builtin_popcountll(table.bloom[i]);
+	double fill = (double)bitsSet / (table.bloom.size() * table.bloomBits);
+
+	// Chains are runs of hashes ending in a set low bit, bucket b starts one.
+	vector<unsigned int> lengths(table.bucketCount, 0);
+	for (unsigned int b = 0; b < table.bucketCount; b++)
+	{
+		unsigned int symbol = table.buckets[b];
+		if (symbol < table.symbolOffset)
+			continue;
+		for (unsigned long long i = symbol - table.symbolOffset; i < table.chains.size(); i++)
+		{
+			lengths[b]++;
+			if (table.chains[i] & 1)
+				break;
+		}
+	}
+
+	printf("%s:\n", this->image->GetSectionName(index).c_str());
+	printf("  %u buckets, %zu symbols from index %u, %zu bloom words of %u bits, shift %u\n", table.bucketCount,
+		table.chains.size(), table.symbolOffset, table.bloom.size(), table.bloomBits, table.bloomShift);
+	// Two bits per symbol, a missing name passes when both are set.
+	printf("  Bloom fill %.1f%%, false positive rate about %.1f%%\n", 100.0 * fill, 100.0 * fill * fill);
+	PrintChains(lengths, table.chains.size());
+
+	LOOKUP_COST exports;
+	memset(&exports, 0, sizeof(exports));
+	for (unsigned long long i = 0; i < table.chains.size(); i++)
+	{
+		if (this->Symbols[i + table.symbolOffset].st_shndx != SHN_UNDEF)
+			lookupGnu(table, this->Names[i + table.symbolOffset], exports);
+	}
+
+	LOOKUP_COST imports;
+	memset(&imports, 0, sizeof(imports));
+	for (unsigned long long i = 0; i < this->Imports.size(); i++)
+		lookupGnu(table, this->Imports[i], imports);
+
+	PrintCost("Own exports", exports, true);
+	PrintCost(this->importers ? "Imports of the importers" : "Own imports", imports, true);
+	printf("\n");
+}
+
+/*   Chain shape and simulated lookups of the System V .hash.   */
+void ELFHashStats::readSysvHash(int index)
+{
+	SYSV_HASH_TABLE table;
+	if (readSysvTable(index, table) == false)
+	{
+		printf("ELFHashStats: Malformed or unsupported %s section!\n\n", this->image->GetSectionName(index).c_str());
+		return;
+	}
+
+	vector<unsigned int> lengths(table.buckets.size(), 0);
+	unsigned long long symbols = 0;
+	for (unsigned long long b = 0; b < table.buckets.size(); b++)
+	{
+		unsigned int symbol = table.buckets[b];
+		while (symbol != 0 && symbol < table.chains.size() && lengths[b] < table.chains.size())
+		{
+			lengths[b]++;
+			symbol = table.chains[symbol];
+		}
+		symbols += lengths[b];
+	}
+
+	printf("%s:\n", this->image->GetSectionName(index).c_str());
+	printf("  %zu buckets, %zu chain entries\n", table.buckets.size(), table.chains.size());
+	PrintChains(lengths, symbols);
+
+	LOOKUP_COST exports;
+	memset(&exports, 0, sizeof(exports));
+	for (unsigned long long i = 1; i < this->Symbols.size() && i < table.chains.size(); i++)
+	{
+		if (this->Symbols[i].st_shndx != SHN_UNDEF)
+			lookupSysv(table, this->Names[i], exports);
+	}
+
+	LOOKUP_COST imports;
+	memset(&imports, 0, sizeof(imports));
+	for (unsigned long long i = 0; i < this->Imports.size(); i++)
+		lookupSysv(table, this->Imports[i], imports);
+
+	PrintCost("Own exports", exports, false);
+	PrintCost(this->importers ? "Imports of the importers" : "Own imports", imports, false);
+	printf("\n");
+}
+
+/*   Prints every symbol hash table of the binary. Lookups are simulated
+	for its own exports, which hit, and for imports, which ld.so also
+	tries here whenever this object is searched before the one defining
+	them.   */
+void ELFHashStats::readStats()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	if (this->importers == false)
+		CollectImports(this->image, this->Imports);
+
+	bool found = false;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		unsigned int type = this->image->SectionHeaders[i].sh_type;
+		if (type == SHT_GNU_HASH)
+			readGnuHash(i);
+		else if (type == SHT_HASH)
+			readSysvHash(i);
+		else
+			continue;
+		found = true;
+	}
+
+	if (found == false)
+		printf("ELFHashStats: No .gnu.hash or .hash section found!\n\n");
+}
@@ -11,6 +11,7 @@ public:
 	bool IsReady();
 private:
 	FILE* readFile = NULL;
+	ELFMapping* mapping = NULL;
 	bool InvalidELFFormat = false;
 
 private:
@@ -84,8 +85,8 @@ private:
 protected:
 	// ELF header structures.
 	ELFHeaderStruct* identifier;
-	Elf32_Ehdr* elfHeader32;
-	Elf64_Ehdr* elfHeader64;
+	Elf32_Ehdr* elfHeader32 = NULL;
+	Elf64_Ehdr* elfHeader64 = NULL;
 
 	// Section header arrays.
 	vector<ELF_SECTIONHEADER32> SectionHeaders32;
@@ -127,6 +128,7 @@ ELFHeader::ELFHeader(string FileName)
 		this->InvalidELFFormat = true;
 		return;
 	}
+	this->mapping = new ELFMapping(fileno(this->readFile));
 
 	// Check the bitsystem and if is ELF format.
 	this->identifier = ReadELF_Identifier();
@@ -135,6 +137,8 @@ ELFHeader::ELFHeader(string FileName)
 /*   Deconstructor of the class.   */
 ELFHeader::~ELFHeader()
 {
+	if (this->mapping != NULL)
+		delete this->mapping;
 	if (this->readFile != NULL)
 		fclose(this->readFile);
 }
@@ -185,7 +189,7 @@ ELFHeader::ELFHeaderStruct* ELFHeader::ReadELF_Identifier()
 		return 0;
 	}
 
-	fseek(readFile, 0, SEEK_SET);
+	fseeko(readFile, 0, SEEK_SET);
 	return elfHeader;
 }
 
@@ -220,13 +224,15 @@ void ELFHeader::readELFHeader()
 /*   Reading the ELF header bytes of ELF file. x32   */
 void ELFHeader::readELFHeader32()
 {
-	// Get size of file.
-	struct stat st;
-	fstat(readFile->_fileno, &st);
-
-	// Read ELF header structure from file.
-	char* FileContent = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, readFile->_fileno, 0);
-	Elf32_Ehdr* ehdr = (Elf32_Ehdr*)FileContent;
+	// Read ELF header structure from file, the copy outlives any mapped window.
+	Elf32_Ehdr* ehdr = new Elf32_Ehdr();
+	if (this->mapping->read(0, ehdr, sizeof(Elf32_Ehdr)) == false)
+	{
+		printf("ELFHeader: Failed to read ELF header!\n");
+		this->InvalidELFFormat = true;
+		delete ehdr;
+		return;
+	}
 
 	// Bit system and endian type.
 	printf("Bitsystem:\t\t\tx32\n");
@@ -432,13 +438,15 @@ void ELFHeader::readELFHeader32()
 /*   Reading the ELF header bytes of ELF file. x64   */
 void ELFHeader::readELFHeader64()
 {
-	// Get size of file.
-	struct stat st;
-	fstat(readFile->_fileno, &st);
-
-	// Read ELF header structure from file.
-	char* FileContent = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, readFile->_fileno, 0);
-	Elf64_Ehdr* ehdr = (Elf64_Ehdr*)FileContent;
+	// Read ELF header structure from file, the copy outlives any mapped window.
+	Elf64_Ehdr* ehdr = new Elf64_Ehdr();
+	if (this->mapping->read(0, ehdr, sizeof(Elf64_Ehdr)) == false)
+	{
+		printf("ELFHeader: Failed to read ELF header!\n");
+		this->InvalidELFFormat = true;
+		delete ehdr;
+		return;
+	}
 
 	// Bit system and endian type.
 	printf("Bitsystem:\t\t\tx64\n");
@@ -668,7 +676,7 @@ void ELFHeader::readProgramHeader()
 void ELFHeader::readProgramHeader32()
 {
 	// First change position to given offset.
-	fseek(readFile, this->elfHeader32->e_phoff, SEEK_SET);
+	fseeko(readFile, this->elfHeader32->e_phoff, SEEK_SET);
 
 	// For every entry we can read the program header.
 	for (int i = 0; i < this->elfHeader32->e_phnum; i++)
@@ -738,7 +746,7 @@ void ELFHeader::readProgramHeader32()
 void ELFHeader::readProgramHeader64()
 {
 	// First change position to given offset.
-	fseek(readFile, this->elfHeader64->e_phoff, SEEK_SET);
+	fseeko(readFile, this->elfHeader64->e_phoff, SEEK_SET);
 
 	// For every entry we can read the program header.
 	for (int i = 0; i < this->elfHeader64->e_phnum; i++)
@@ -832,24 +840,29 @@ void ELFHeader::readSectionHeader()
 }
 void ELFHeader::readSectionHeader32()
 {
-	// Get file size.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
-
 	// First change position to given offset.
-	fseek(this->readFile, 0, SEEK_SET);
+	fseeko(this->readFile, 0, SEEK_SET);
 
-	// Read file again, in memory.
-	char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-		this->readFile->_fileno, 0); // File int and offset.
-	Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
+	// Map only the section table and the section name table.
+	const Elf32_Shdr* shdr = (const Elf32_Shdr*)this->mapping->map(this->elfHeader32->e_shoff,
+		(unsigned long long)this->elfHeader32->e_shnum * sizeof(Elf32_Shdr));
+	if (shdr == NULL || this->elfHeader32->e_shstrndx >= this->elfHeader32->e_shnum)
+	{
+		printf("SectionHeader: Failed to map section table!\n");
+		return;
+	}
 
 	// Get the names from string table.
-	Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
-	const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+	const Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
+	const char* const sh_strtab_p = this->mapping->map(sh_strtab->sh_offset, sh_strtab->sh_size);
+	if (sh_strtab_p == NULL)
+	{
+		printf("SectionHeader: Failed to map section names!\n");
+		return;
+	}
 
 	// Set file pointer to the section offset again.
-	fseek(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+	fseeko(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
 
 	// Loop trough file and print section info.
 	for (int i = 0; i < this->elfHeader32->e_shnum; i++)
@@ -1005,24 +1018,29 @@ void ELFHeader::readSectionHeader32()
 }
 void ELFHeader::readSectionHeader64()
 {
-	// Get file size.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
-
 	// First change position to given offset.
-	fseek(this->readFile, 0, SEEK_SET);
+	fseeko(this->readFile, 0, SEEK_SET);
 
-	// Read file again, in memory.
-	char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-		this->readFile->_fileno, 0); // File int and offset.
-	Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
+	// Map only the section table and the section name table.
+	const Elf64_Shdr* shdr = (const Elf64_Shdr*)this->mapping->map(this->elfHeader64->e_shoff,
+		(unsigned long long)this->elfHeader64->e_shnum * sizeof(Elf64_Shdr));
+	if (shdr == NULL || this->elfHeader64->e_shstrndx >= this->elfHeader64->e_shnum)
+	{
+		printf("SectionHeader: Failed to map section table!\n");
+		return;
+	}
 
 	// Get the names from string table.
-	Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
-	const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+	const Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
+	const char* const sh_strtab_p = this->mapping->map(sh_strtab->sh_offset, sh_strtab->sh_size);
+	if (sh_strtab_p == NULL)
+	{
+		printf("SectionHeader: Failed to map section names!\n");
+		return;
+	}
 
 	// Set file pointer to the section offset again.
-	fseek(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+	fseeko(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
 
 	// Loop trough file and print section info.
 	for (int i = 0; i < this->elfHeader64->e_shnum; i++)
@@ -1186,25 +1204,30 @@ void ELFHeader::readSectionHeader(string sectionName)
 		return;
 	}
 
-	// Get file size.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
-
 	// First change position to given offset.
-	fseek(this->readFile, 0, SEEK_SET);
+	fseeko(this->readFile, 0, SEEK_SET);
 
 	if (this->identifier->bitSystem == 0x01)
 	{
-		// We need to get the names from string table.
-		char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-			this->readFile->_fileno, 0); // File int and offset.
-		Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
+		// Map only the section table and the section name table.
+		const Elf32_Shdr* shdr = (const Elf32_Shdr*)this->mapping->map(this->elfHeader32->e_shoff,
+			(unsigned long long)this->elfHeader32->e_shnum * sizeof(Elf32_Shdr));
+		if (shdr == NULL || this->elfHeader32->e_shstrndx >= this->elfHeader32->e_shnum)
+		{
+			printf("SectionHeader: Failed to map section table!\n");
+			return;
+		}
 
 		// Get the names from string table.
-		Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
-		const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+		const Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
+		const char* const sh_strtab_p = this->mapping->map(sh_strtab->sh_offset, sh_strtab->sh_size);
+		if (sh_strtab_p == NULL)
+		{
+			printf("SectionHeader: Failed to map section names!\n");
+			return;
+		}
 
-		fseek(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
 
 		for (int i = 0; i < this->elfHeader32->e_shnum; i++)
 		{
@@ -1235,16 +1258,25 @@ void ELFHeader::readSectionHeader(string sectionName)
 	}
 	else
 	{
-		// We need to get the names from string table.
-		char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-			this->readFile->_fileno, 0); // File int and offset.
-		Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
+		// Map only the section table and the section name table.
+		const Elf64_Shdr* shdr = (const Elf64_Shdr*)this->mapping->map(this->elfHeader64->e_shoff,
+			(unsigned long long)this->elfHeader64->e_shnum * sizeof(Elf64_Shdr));
+		if (shdr == NULL || this->elfHeader64->e_shstrndx >= this->elfHeader64->e_shnum)
+		{
+			printf("SectionHeader: Failed to map section table!\n");
+			return;
+		}
 
 		// Get the names from string table.
-		Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
-		const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+		const Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
+		const char* const sh_strtab_p = this->mapping->map(sh_strtab->sh_offset, sh_strtab->sh_size);
+		if (sh_strtab_p == NULL)
+		{
+			printf("SectionHeader: Failed to map section names!\n");
+			return;
+		}
 
-		fseek(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
 
 		for (int i = 0; i < this->elfHeader64->e_shnum; i++)
 		{
@@ -1285,25 +1317,30 @@ void ELFHeader::readSectionHeader(int index)
 		return;
 	}
 
-	// Get file size.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
-
 	// First change position to given offset.
-	fseek(this->readFile, 0, SEEK_SET);
+	fseeko(this->readFile, 0, SEEK_SET);
 
 	if (this->identifier->bitSystem == 0x01)
 	{
-		// Read file again, in memory.
-		char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-			this->readFile->_fileno, 0); // File int and offset.
-		Elf32_Shdr* shdr = (Elf32_Shdr*)(p + this->elfHeader32->e_shoff);
+		// Map only the section table and the section name table.
+		const Elf32_Shdr* shdr = (const Elf32_Shdr*)this->mapping->map(this->elfHeader32->e_shoff,
+			(unsigned long long)this->elfHeader32->e_shnum * sizeof(Elf32_Shdr));
+		if (shdr == NULL || this->elfHeader32->e_shstrndx >= this->elfHeader32->e_shnum)
+		{
+			printf("SectionHeader: Failed to map section table!\n");
+			return;
+		}
 
 		// Get the names from string table.
-		Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
-		const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+		const Elf32_Shdr* sh_strtab = &shdr[this->elfHeader32->e_shstrndx];
+		const char* const sh_strtab_p = this->mapping->map(sh_strtab->sh_offset, sh_strtab->sh_size);
+		if (sh_strtab_p == NULL)
+		{
+			printf("SectionHeader: Failed to map section names!\n");
+			return;
+		}
 
-		fseek(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
 
 		if (this->elfHeader32->e_shnum < index)
 		{
@@ -1331,16 +1368,25 @@ void ELFHeader::readSectionHeader(int index)
 	}
 	else
 	{
-		// Read file again, in memory.
-		char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-			this->readFile->_fileno, 0); // File int and offset.
-		Elf64_Shdr* shdr = (Elf64_Shdr*)(p + this->elfHeader64->e_shoff);
+		// Map only the section table and the section name table.
+		const Elf64_Shdr* shdr = (const Elf64_Shdr*)this->mapping->map(this->elfHeader64->e_shoff,
+			(unsigned long long)this->elfHeader64->e_shnum * sizeof(Elf64_Shdr));
+		if (shdr == NULL || this->elfHeader64->e_shstrndx >= this->elfHeader64->e_shnum)
+		{
+			printf("SectionHeader: Failed to map section table!\n");
+			return;
+		}
 
 		// Get the names from string table.
-		Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
-		const char* const sh_strtab_p = p + sh_strtab->sh_offset;
+		const Elf64_Shdr* sh_strtab = &shdr[this->elfHeader64->e_shstrndx];
+		const char* const sh_strtab_p = this->mapping->map(sh_strtab->sh_offset, sh_strtab->sh_size);
+		if (sh_strtab_p == NULL)
+		{
+			printf("SectionHeader: Failed to map section names!\n");
+			return;
+		}
 
-		fseek(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
 
 		if (this->elfHeader64->e_shnum < index)
 		{
@@ -1649,24 +1695,28 @@ bool ELFHeader::silentReadELFHeader()
 	}
 
 	// Change pointer to beginning of file.
-	fseek(this->readFile, 0, SEEK_SET);
+	fseeko(this->readFile, 0, SEEK_SET);
 
-	// Get size of file.
-	struct stat st;
-	fstat(this->readFile->_fileno, &st);
-
-	// Read file.
-	char* p = (char*)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE,
-		this->readFile->_fileno, 0);
-
-	// Based on bit system.
+	// Copy the header, only the bytes of the header are read.
+	bool status;
 	if (this->identifier->bitSystem == 0x01)
 	{
-		this->elfHeader32 = (Elf32_Ehdr*)p;
+		if (this->elfHeader32 == NULL)
+			this->elfHeader32 = new Elf32_Ehdr();
+		status = this->mapping->read(0, this->elfHeader32, sizeof(Elf32_Ehdr));
 	}
 	else
 	{
-		this->elfHeader64 = (Elf64_Ehdr*)p;
+		if (this->elfHeader64 == NULL)
+			this->elfHeader64 = new Elf64_Ehdr();
+		status = this->mapping->read(0, this->elfHeader64, sizeof(Elf64_Ehdr));
+	}
+
+	if (status == false)
+	{
+		printf("Silent ELFHeader: Failed to read bytes for ELF header!\n");
+		this->InvalidELFFormat = true;
+		return false;
 	}
 
 	return true;
@@ -1681,7 +1731,8 @@ bool ELFHeader::silentReadSectionHeaders()
 
 	if (this->identifier->bitSystem == 0x01)
 	{
-		fseek(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader32->e_shoff, SEEK_SET);
+		this->SectionHeaders32.clear();
 
 		for (int i = 0; i < this->elfHeader32->e_shnum; i++)
 		{
@@ -1700,7 +1751,8 @@ bool ELFHeader::silentReadSectionHeaders()
 	}
 	else
 	{
-		fseek(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+		fseeko(this->readFile, this->elfHeader64->e_shoff, SEEK_SET);
+		this->SectionHeaders64.clear();
 
 		for (int i = 0; i < this->elfHeader64->e_shnum; i++)
 		{
@@ -1719,5 +1771,5 @@ bool ELFHeader::silentReadSectionHeaders()
 	}
 
 	// Change pointer to beginning of file.
-	fseek(this->readFile, 0, SEEK_SET);
+	fseeko(this->readFile, 0, SEEK_SET);
 }
@@ -0,0 +1,299 @@
+#include "stdafx.h"
+
+#ifndef ELFHotText_H
+#define ELFHotText_H
+class ELFHotText
+{
+public:
+	explicit ELFHotText(string);
+	~ELFHotText();
+	bool IsReady();
+
+	/*   Options   */
+	void setTopCount(unsigned int);
+	void setOrderFile(string);
+
+	/*   Profile input   */
+	bool readProfile(string);
+
+	/*   Print the page touch of the hot functions and write the ordering   */
+	void readHotText();
+private:
+	/*   A function and the samples that fell into it.   */
+	typedef struct HotFunction {
+		string name;
+		unsigned long long address;
+		unsigned long long size;
+		unsigned long long samples;
+		unsigned long long firstSeen;		// Profile line that first hit it.
+	} HOT_FUNCTION;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int topCount = 20;
+	string orderFile;
+
+	vector<HOT_FUNCTION> Functions;			// Sorted by address.
+	unordered_map<string, unsigned long long> Names;
+	unsigned long long textStart = 0;
+
+	unsigned long long sampleCount = 0;
+	unsigned long long unmappedCount = 0;
+
+	static const unsigned long long SMALL_PAGE_SIZE = 0x1000;
+	static const unsigned long long HUGE_PAGE_SIZE = 0x200000;
+
+	void collectFunctions();
+	HOT_FUNCTION* FindFunction(unsigned long long);
+	static unsigned long long CountPages(const vector<pair<unsigned long long, unsigned long long> >&,
+		unsigned long long);
+};
+#endif // !~ ELFHotText_H
+
+/*   Constructor with string of filename.   */
+ELFHotText::ELFHotText(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFHotText: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	collectFunctions();
+	if (this->Functions.empty())
+	{
+		printf("ELFHotText: No function symbols found!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFHotText::~ELFHotText()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFHotText::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFHotText::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+void ELFHotText::setOrderFile(string fileName)
+{
+	this->orderFile = fileName;
+}
+
+/*   Reads the sized function symbols, one per address.   */
+void ELFHotText::collectFunctions()
+{
+	vector<ELFImage::FUNCTION_SYMBOL> symbols;
+	if (this->image->readFunctionSymbols(symbols) == false)
+		return;
+
+	HOT_FUNCTION function;
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		function.name = symbols[i].name;
+		function.address = symbols[i].address;
+		function.size = symbols[i].size;
+		function.samples = 0;
+		function.firstSeen = ~0ULL;
+		this->Functions.push_back(function);
+	}
+
+	// Samples are matched by address.
+	sort(this->Functions.begin(), this->Functions.end(), [](const HOT_FUNCTION& a, const HOT_FUNCTION& b)
+	{
+		return a.address < b.address;
+	});
+
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+		this->Names[this->Functions[i].name] = i;
+
+	int text = this->image->GetIndexOfSection(".text");
+	if (text >= 0)
+		this->textStart = this->image->SectionHeaders[text].sh_addr;
+	else if (this->Functions.empty() == false)
+		this->textStart = this->Functions[0].address;
+}
+
+/*   Function containing an address, NULL when none does.   */
+ELFHotText::HOT_FUNCTION* ELFHotText::FindFunction(unsigned long long address)
+{
+	vector<HOT_FUNCTION>::iterator it = upper_bound(this->Functions.begin(), this->Functions.end(), address,
+		[](unsigned long long value, const HOT_FUNCTION& function)
+	{
+		return value < function.address;
+	});
+	if (it == this->Functions.begin())
+		return NULL;
+
+	it--;
+	if (address - it->address >= it->size)
+		return NULL;
+	return &(*it);
+}
+
+/*   Reads a profile. Every line is a sampled address or a function name,
+	optionally followed by a count; a missing count means 1. Lists without
+	counts keep their order, so a plain hottest-first list works too.   */
+bool ELFHotText::readProfile(string fileName)
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return false;
+	}
+
+	ifstream profile(fileName);
+	if (profile.is_open() == false)
+	{
+		printf("ELFHotText: Failed to open %s! Error code: %d\n", fileName.c_str(), errno);
+		return false;
+	}
+
+	string line;
+	unsigned long long lineNumber = 0;
+	while (getline(profile, line))
+	{
+		lineNumber++;
+
+		char token[4096];
+		unsigned long long count = 1;
+		int fields = sscanf(line.c_str(), "%4095s %llu", token, &count);
+		if (fields < 1 || token[0] == '#')
+			continue;
+		if (fields < 2)
+			count = 1;
+
+		// Names are tried first, short ones like "face" are valid hex too.
+		HOT_FUNCTION* function = NULL;
+		unordered_map<string, unsigned long long>::iterator name = this->Names.find(token);
+		if (name != this->Names.end())
+			function = &this->Functions[name->second];
+		else
+		{
+			char* end;
+			unsigned long long address = strtoull(token, &end, 16);
+			if (*end == '\0')
+				function = FindFunction(address);
+		}
+
+		this->sampleCount += count;
+		if (function == NULL)
+		{
+			this->unmappedCount += count;
+			continue;
+		}
+
+		function->samples += count;
+		if (function->firstSeen == ~0ULL)
+			function->firstSeen = lineNumber;
+	}
+
+	return true;
+}
+
+/*   Distinct pages a set of address ranges touches.   */
+unsigned long long ELFHotText::CountPages(const vector<pair<unsigned long long, unsigned long long> >& ranges,
+	unsigned long long pageSize)
+{
+	vector<unsigned long long> pages;
+	for (unsigned long long i = 0; i < ranges.size(); i++)
+	{
+		for (unsigned long long page = ranges[i].first / pageSize;
+			page <= (ranges[i].first + ranges[i].second - 1) / pageSize; page++)
+			pages.push_back(page);
+	}
+
+	sort(pages.begin(), pages.end());
+	return unique(pages.begin(), pages.end()) - pages.begin();
+}
+
+/*   Prints the hot functions, the 4 KB and 2 MB pages they touch now and
+	after packing them hottest first at the start of .text, and writes the
+	order as a linker symbol ordering file.   */
+void ELFHotText::readHotText()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	vector<HOT_FUNCTION*> hot;
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		if (this->Functions[i].samples > 0)
+			hot.push_back(&this->Functions[i]);
+	}
+
+	sort(hot.begin(), hot.end(), [](const HOT_FUNCTION* a, const HOT_FUNCTION* b)
+	{
+		if (a->samples != b->samples)
+			return a->samples > b->samples;
+		return (a->firstSeen != b->firstSeen) ? a->firstSeen < b->firstSeen : a->address < b->address;
+	});
+
+	printf("Hot functions:\n");
+	printf("  Samples\tSize\t\tAddress\t\t\tFunction\n");
+	for (unsigned long long i = 0; i < hot.size() && i < this->topCount; i++)
+	{
+		printf("  %7llu\t%8llu\t0x%016llx\t%s\n", hot[i]->samples, hot[i]->size, hot[i]->address,
+			hot[i]->name.c_str());
+	}
+	printf("\n  %llu samples, %llu outside any function, %zu hot functions\n\n", this->sampleCount,
+		this->unmappedCount, hot.size());
+
+	if (hot.empty())
+		return;
+
+	// Packed layout, each function keeps the alignment its address shows.
+	vector<pair<unsigned long long, unsigned long long> > current, packed;
+	unsigned long long address = this->textStart, bytes = 0;
+	for (unsigned long long i = 0; i < hot.size(); i++)
+	{
+		current.push_back(make_pair(hot[i]->address, hot[i]->size));
+
+		unsigned long long alignment = hot[i]->address & (~hot[i]->address + 1);
+		if (alignment == 0 || alignment > 64)
+			alignment = 64;
+		address = (address + alignment - 1) / alignment * alignment;
+		packed.push_back(make_pair(address, hot[i]->size));
+		address += hot[i]->size;
+		bytes += hot[i]->size;
+	}
+
+	printf("Pages touched by hot text (%llu bytes):\n", bytes);
+	printf("  Page size\tToday\tReordered\n");
+	printf("  4 KB\t\t%llu\t%llu\n", CountPages(current, SMALL_PAGE_SIZE), CountPages(packed, SMALL_PAGE_SIZE));
+	printf("  2 MB\t\t%llu\t%llu\n\n", CountPages(current, HUGE_PAGE_SIZE), CountPages(packed, HUGE_PAGE_SIZE));
+
+	if (this->orderFile.empty())
+		return;
+
+	FILE* output = fopen(this->orderFile.c_str(), "w");
+	if (output == NULL)
+	{
+		printf("ELFHotText: Failed to create %s! Error code: %d\n", this->orderFile.c_str(), errno);
+		return;
+	}
+	for (unsigned long long i = 0; i < hot.size(); i++)
+		fprintf(output, "%s\n", hot[i]->name.c_str());
+	fclose(output);
+
+	printf("Symbol ordering file written to %s (%zu symbols)\n", this->orderFile.c_str(), hot.size());
+	printf("  Link with lld --symbol-ordering-file=%s\n\n", this->orderFile.c_str());
+}
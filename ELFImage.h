@@ -0,0 +1,585 @@
+#include "stdafx.h"
+
+#ifndef ELFImage_H
+#define ELFImage_H
+class ELFImage
+{
+public:
+	ELFImage(ELFMapping*, unsigned long long = 0, unsigned long long = 0);
+	bool IsReady();
+
+	/*   Header information   */
+	bool is64();
+	unsigned short getType();
+	unsigned short getMachine();
+	unsigned long long getEntry();
+	unsigned long long getBase();
+	unsigned long long getSize();
+
+	/*   Image relative access   */
+	const char* map(unsigned long long, unsigned long long);
+	const char* mapPinned(unsigned long long, unsigned long long);
+	bool read(unsigned long long, void*, unsigned long long);
+	string readString(unsigned long long, unsigned long long);
+	char* mapCopy(unsigned long long, unsigned long long);
+	bool GetFileOffset(unsigned long long, unsigned long long&);
+
+	/*   Sections   */
+	string GetSectionName(int);
+	int GetIndexOfSection(string);
+	const char* mapSection(int);
+	const char* pinSection(int);
+	void unpin(const char*);
+
+	/*   One sized function symbol and where its code lies.   */
+	typedef struct FunctionSymbol {
+		string name;
+		unsigned long long address;		// Symbol value.
+		unsigned long long size;
+		int section;
+		unsigned long long offset;		// Start within the section.
+	} FUNCTION_SYMBOL;
+
+	/*   Symbols   */
+	int GetSymbolTable();
+	bool readSymbols(int, vector<Elf64_Sym>&);
+	string GetSymbolName(int, const Elf64_Sym&);
+	bool readFunctionSymbols(vector<FUNCTION_SYMBOL>&);
+
+	/*   Relocations   */
+	bool readRelocations(int, vector<Elf64_Rela>&);
+	bool readRelativeRelocations(int, vector<unsigned long long>&);
+
+	// Headers, normalized to the 64 bit layout.
+	Elf64_Ehdr Header;
+	vector<Elf64_Phdr> ProgramHeaders;
+	vector<Elf64_Shdr> SectionHeaders;
+private:
+	ELFMapping* mapping = NULL;
+	unsigned long long base = 0;
+	unsigned long long size = 0;
+	bool InvalidELFFormat = false;
+	bool bit64 = false;
+
+	bool readHeader();
+	bool readProgramHeaders();
+	bool readSectionHeaders();
+};
+#endif // !~ ELFImage_H
+
+/*   Constructor with the mapping and the range of the image in it.
+	A size of 0 means the image runs to the end of the file.   */
+ELFImage::ELFImage(ELFMapping* mapping, unsigned long long base, unsigned long long size)
+{
+	this->mapping = mapping;
+	this->base = base;
+	this->size = size;
+
+	if (mapping == NULL || mapping->IsReady() == false || base > mapping->getFileSize())
+	{
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	if (this->size == 0 || base + this->size > mapping->getFileSize())
+		this->size = mapping->getFileSize() - base;
+
+	if (readHeader() == false || readProgramHeaders() == false || readSectionHeaders() == false)
+		this->InvalidELFFormat = true;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFImage::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Header information.   */
+bool ELFImage::is64()
+{
+	return this->bit64;
+}
+unsigned short ELFImage::getType()
+{
+	return this->Header.e_type;
+}
+unsigned short ELFImage::getMachine()
+{
+	return this->Header.e_machine;
+}
+unsigned long long ELFImage::getEntry()
+{
+	return this->Header.e_entry;
+}
+unsigned long long ELFImage::getBase()
+{
+	return this->base;
+}
+unsigned long long ELFImage::getSize()
+{
+	return this->size;
+}
+
+/*   Maps a range of the image, see ELFMapping::map.   */
+const char* ELFImage::map(unsigned long long offset, unsigned long long length)
+{
+	if (offset > this->size || length > this->size - offset)
+		return NULL;
+
+	return this->mapping->map(this->base + offset, length);
+}
+
+/*   Maps a range of the image and pins it, see ELFMapping::mapPinned.   */
+const char* ELFImage::mapPinned(unsigned long long offset, unsigned long long length)
+{
+	if (offset > this->size || length > this->size - offset)
+		return NULL;
+
+	return this->mapping->mapPinned(this->base + offset, length);
+}
+
+/*   Copies a range of the image into a buffer.   */
+bool ELFImage::read(unsigned long long offset, void* buffer, unsigned long long length)
+{
+	if (offset > this->size || length > this->size - offset)
+		return false;
+
+	return this->mapping->read(this->base + offset, buffer, length);
+}
+
+/*   Reads a null terminated string inside the image.   */
+string ELFImage::readString(unsigned long long offset, unsigned long long limit)
+{
+	if (offset >= this->size)
+		return "";
+	if (limit > this->size - offset)
+		limit = this->size - offset;
+
+	return this->mapping->readString(this->base + offset, limit);
+}
+
+/*   Maps a writable copy-on-write range of the image, see ELFMapping::mapCopy.   */
+char* ELFImage::mapCopy(unsigned long long offset, unsigned long long length)
+{
+	if (offset > this->size || length > this->size - offset)
+		return NULL;
+
+	return this->mapping->mapCopy(this->base + offset, length);
+}
+
+/*   Translates a virtual address to a file offset through the PT_LOAD
+	segments, false when no segment holds file data for it.   */
+bool ELFImage::GetFileOffset(unsigned long long address, unsigned long long& offset)
+{
+	for (unsigned long long i = 0; i < this->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->ProgramHeaders[i];
+		if (segment.p_type == PT_LOAD && address >= segment.p_vaddr && address - segment.p_vaddr < segment.p_filesz)
+		{
+			offset = segment.p_offset + (address - segment.p_vaddr);
+			return true;
+		}
+	}
+	return false;
+}
+
+/*   Gets the name of a section from the section name table.   */
+string ELFImage::GetSectionName(int index)
+{
+	if (index < 0 || index >= (int)this->SectionHeaders.size() ||
+		this->Header.e_shstrndx >= this->SectionHeaders.size())
+		return "";
+
+	Elf64_Shdr& names = this->SectionHeaders[this->Header.e_shstrndx];
+	unsigned int nameOffset = this->SectionHeaders[index].sh_name;
+	if (nameOffset >= names.sh_size)
+		return "";
+
+	return readString(names.sh_offset + nameOffset, names.sh_size - nameOffset);
+}
+
+/*   Gets the index number from the section table.   */
+int ELFImage::GetIndexOfSection(string sectionName)
+{
+	for (unsigned long long i = 0; i < this->SectionHeaders.size(); i++)
+	{
+		if (GetSectionName(i) == sectionName)
+			return i;
+	}
+
+	return -1;
+}
+
+/*   Maps the contents of a section, NULL for empty or SHT_NOBITS sections.   */
+const char* ELFImage::mapSection(int index)
+{
+	if (index < 0 || index >= (int)this->SectionHeaders.size())
+		return NULL;
+
+	Elf64_Shdr& section = this->SectionHeaders[index];
+	if (section.sh_type == SHT_NOBITS || section.sh_size == 0)
+		return NULL;
+
+	return map(section.sh_offset, section.sh_size);
+}
+
+/*   Maps the contents of a section and pins it, see ELFMapping::mapPinned.
+	Every non NULL result must be handed back to unpin.   */
+const char* ELFImage::pinSection(int index)
+{
+	if (index < 0 || index >= (int)this->SectionHeaders.size())
+		return NULL;
+
+	Elf64_Shdr& section = this->SectionHeaders[index];
+	if (section.sh_type == SHT_NOBITS || section.sh_size == 0 ||
+		section.sh_offset > this->size || section.sh_size > this->size - section.sh_offset)
+		return NULL;
+
+	return this->mapping->mapPinned(this->base + section.sh_offset, section.sh_size);
+}
+
+/*   Drops the pin of a range mapped by pinSection or mapPinned.   */
+void ELFImage::unpin(const char* pointer)
+{
+	if (pointer != NULL)
+		this->mapping->unpin(pointer);
+}
+
+/*   Index of .symtab when present, the dynamic table otherwise, -1 when
+	there is neither.   */
+int ELFImage::GetSymbolTable()
+{
+	int table = -1;
+	for (unsigned long long i = 0; i < this->SectionHeaders.size(); i++)
+	{
+		if (this->SectionHeaders[i].sh_type == SHT_SYMTAB)
+			table = i;
+		else if (this->SectionHeaders[i].sh_type == SHT_DYNSYM && table < 0)
+			table = i;
+	}
+	return table;
+}
+
+/*   Reads a symbol table section (SHT_SYMTAB or SHT_DYNSYM).   */
+bool ELFImage::readSymbols(int index, vector<Elf64_Sym>& symbols)
+{
+	symbols.clear();
+	if (index < 0 || index >= (int)this->SectionHeaders.size())
+		return false;
+
+	Elf64_Shdr& section = this->SectionHeaders[index];
+	unsigned long long entrySize = this->bit64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	if (section.sh_entsize != 0)
+		entrySize = section.sh_entsize;
+	if (entrySize < (this->bit64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym)))
+		return false;
+
+	const char* table = mapSection(index);
+	if (table == NULL)
+		return false;
+
+	unsigned long long count = section.sh_size / entrySize;
+	symbols.resize(count);
+
+	for (unsigned long long i = 0; i < count; i++)
+	{
+		if (this->bit64 == true)
+		{
+			memcpy(&symbols[i], table + i * entrySize, sizeof(Elf64_Sym));
+			continue;
+		}
+
+		Elf32_Sym symbol;
+		memcpy(&symbol, table + i * entrySize, sizeof(Elf32_Sym));
+		symbols[i].st_name = symbol.st_name;
+		symbols[i].st_info = symbol.st_info;
+		symbols[i].st_other = symbol.st_other;
+		symbols[i].st_shndx = symbol.st_shndx;
+		symbols[i].st_value = symbol.st_value;
+		symbols[i].st_size = symbol.st_size;
+	}
+
+	return true;
+}
+
+/*   Gets the name of a symbol from the string table linked to its table.   */
+string ELFImage::GetSymbolName(int index, const Elf64_Sym& symbol)
+{
+	if (index < 0 || index >= (int)this->SectionHeaders.size())
+		return "";
+
+	unsigned int link = this->SectionHeaders[index].sh_link;
+	if (link >= this->SectionHeaders.size())
+		return "";
+
+	Elf64_Shdr& strings = this->SectionHeaders[link];
+	if (symbol.st_name >= strings.sh_size)
+		return "";
+
+	return readString(strings.sh_offset + symbol.st_name, strings.sh_size - symbol.st_name);
+}
+
+/*   Reads the sized function symbols whose code lies inside an executable
+	section, sorted by section and offset. Aliases share their code, only
+	the largest of them is kept (the first by name on a tie).   */
+bool ELFImage::readFunctionSymbols(vector<FUNCTION_SYMBOL>& functions)
+{
+	functions.clear();
+
+	int table = GetSymbolTable();
+	vector<Elf64_Sym> symbols;
+	if (table < 0 || readSymbols(table, symbols) == false)
+		return false;
+
+	// Relocatable objects have section relative values.
+	bool relocatable = (getType() == ET_REL);
+	FUNCTION_SYMBOL function;
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		Elf64_Sym& symbol = symbols[i];
+		if (ELF64_ST_TYPE(symbol.st_info) != STT_FUNC || symbol.st_size == 0 ||
+			symbol.st_shndx == SHN_UNDEF || symbol.st_shndx >= this->SectionHeaders.size())
+			continue;
+
+		Elf64_Shdr& section = this->SectionHeaders[symbol.st_shndx];
+		if (relocatable == false && symbol.st_value < section.sh_addr)
+			continue;
+
+		unsigned long long start = relocatable ? symbol.st_value : symbol.st_value - section.sh_addr;
+		if ((section.sh_flags & SHF_EXECINSTR) == 0 || section.sh_type == SHT_NOBITS ||
+			start > section.sh_size || symbol.st_size > section.sh_size - start)
+			continue;
+
+		function.name = GetSymbolName(table, symbol);
+		function.address = symbol.st_value;
+		function.size = symbol.st_size;
+		function.section = symbol.st_shndx;
+		function.offset = start;
+		functions.push_back(function);
+	}
+
+	sort(functions.begin(), functions.end(), [](const FUNCTION_SYMBOL& a, const FUNCTION_SYMBOL& b)
+	{
+		if (a.section != b.section)
+			return a.section < b.section;
+		if (a.offset != b.offset)
+			return a.offset < b.offset;
+		return (a.size != b.size) ? a.size > b.size : a.name < b.name;
+	});
+	functions.erase(unique(functions.begin(), functions.end(), [](const FUNCTION_SYMBOL& a, const FUNCTION_SYMBOL& b)
+	{
+		return a.section == b.section && a.offset == b.offset;
+	}), functions.end());
+
+	return true;
+}
+
+/*   Reads a relocation section (SHT_REL or SHT_RELA). Entries without an
+	addend get 0, 32 bit r_info is widened to the 64 bit layout.   */
+bool ELFImage::readRelocations(int index, vector<Elf64_Rela>& relocations)
+{
+	relocations.clear();
+	if (index < 0 || index >= (int)this->SectionHeaders.size())
+		return false;
+
+	Elf64_Shdr& section = this->SectionHeaders[index];
+	if (section.sh_type != SHT_REL && section.sh_type != SHT_RELA)
+		return false;
+
+	bool withAddend = (section.sh_type == SHT_RELA);
+	unsigned long long minimum;
+	if (this->bit64 == true)
+		minimum = withAddend ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel);
+	else
+		minimum = withAddend ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel);
+
+	unsigned long long entrySize = (section.sh_entsize != 0) ? section.sh_entsize : minimum;
+	if (entrySize < minimum)
+		return false;
+
+	const char* table = mapSection(index);
+	if (table == NULL)
+		return false;
+
+	unsigned long long count = section.sh_size / entrySize;
+	relocations.resize(count);
+
+	for (unsigned long long i = 0; i < count; i++)
+	{
+		Elf64_Rela& relocation = relocations[i];
+		relocation.r_addend = 0;
+
+		if (this->bit64 == true)
+		{
+			memcpy(&relocation, table + i * entrySize, withAddend ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel));
+			continue;
+		}
+
+		Elf32_Rela entry;
+		entry.r_addend = 0;
+		memcpy(&entry, table + i * entrySize, withAddend ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel));
+		relocation.r_offset = entry.r_offset;
+		relocation.r_info = ELF64_R_INFO(ELF32_R_SYM(entry.r_info), ELF32_R_TYPE(entry.r_info));
+		relocation.r_addend = entry.r_addend;
+	}
+
+	return true;
+}
+
+/*   Decodes a SHT_RELR section into the addresses it relocates. An even
+	entry is an address, an odd entry a bitmap of the words following the
+	last address, one bit per word after the marker bit.   */
+bool ELFImage::readRelativeRelocations(int index, vector<unsigned long long>& offsets)
+{
+	offsets.clear();
+	if (index < 0 || index >= (int)this->SectionHeaders.size())
+		return false;
+
+	Elf64_Shdr& section = this->SectionHeaders[index];
+	if (section.sh_type != SHT_RELR)
+		return false;
+
+	const char* table = mapSection(index);
+	if (table == NULL)
+		return false;
+
+	unsigned long long wordSize = this->bit64 ? 8 : 4;
+	unsigned long long bits = wordSize * 8 - 1;
+	unsigned long long next = 0;
+
+	for (unsigned long long offset = 0; offset + wordSize <= section.sh_size; offset += wordSize)
+	{
+		unsigned long long entry = 0;
+		memcpy(&entry, table + offset, wordSize);
+
+		if ((entry & 1) == 0)
+		{
+			offsets.push_back(entry);
+			next = entry + wordSize;
+			continue;
+		}
+
+		for (unsigned long long bit = 0; bit < bits; bit++)
+		{
+			if ((entry >> (bit + 1)) & 1)
+				offsets.push_back(next + bit * wordSize);
+		}
+		next += bits * wordSize;
+	}
+
+	return true;
+}
+
+/*   Reads and normalizes the ELF header.   */
+bool ELFImage::readHeader()
+{
+	unsigned char ident[EI_NIDENT];
+	if (read(0, ident, EI_NIDENT) == false || memcmp(ident, ELFMAG, SELFMAG) != 0)
+		return false;
+
+	if (ident[EI_CLASS] == ELFCLASS64)
+	{
+		this->bit64 = true;
+		return read(0, &this->Header, sizeof(Elf64_Ehdr));
+	}
+	else if (ident[EI_CLASS] != ELFCLASS32)
+		return false;
+
+	Elf32_Ehdr header;
+	if (read(0, &header, sizeof(Elf32_Ehdr)) == false)
+		return false;
+
+	memcpy(this->Header.e_ident, header.e_ident, EI_NIDENT);
+	this->Header.e_type = header.e_type;
+	this->Header.e_machine = header.e_machine;
+	this->Header.e_version = header.e_version;
+	this->Header.e_entry = header.e_entry;
+	this->Header.e_phoff = header.e_phoff;
+	this->Header.e_shoff = header.e_shoff;
+	this->Header.e_flags = header.e_flags;
+	this->Header.e_ehsize = header.e_ehsize;
+	this->Header.e_phentsize = header.e_phentsize;
+	this->Header.e_phnum = header.e_phnum;
+	this->Header.e_shentsize = header.e_shentsize;
+	this->Header.e_shnum = header.e_shnum;
+	this->Header.e_shstrndx = header.e_shstrndx;
+	return true;
+}
+
+/*   Reads and normalizes the program header table.   */
+bool ELFImage::readProgramHeaders()
+{
+	unsigned int count = this->Header.e_phnum;
+	unsigned int entrySize = this->Header.e_phentsize;
+	if (count == 0)
+		return true;
+	if (entrySize < (this->bit64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr)))
+		return false;
+
+	const char* table = map(this->Header.e_phoff, (unsigned long long)count * entrySize);
+	if (table == NULL)
+		return false;
+
+	this->ProgramHeaders.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (this->bit64 == true)
+		{
+			memcpy(&this->ProgramHeaders[i], table + (unsigned long long)i * entrySize, sizeof(Elf64_Phdr));
+			continue;
+		}
+
+		Elf32_Phdr segment;
+		memcpy(&segment, table + (unsigned long long)i * entrySize, sizeof(Elf32_Phdr));
+		this->ProgramHeaders[i].p_type = segment.p_type;
+		this->ProgramHeaders[i].p_flags = segment.p_flags;
+		this->ProgramHeaders[i].p_offset = segment.p_offset;
+		this->ProgramHeaders[i].p_vaddr = segment.p_vaddr;
+		this->ProgramHeaders[i].p_paddr = segment.p_paddr;
+		this->ProgramHeaders[i].p_filesz = segment.p_filesz;
+		this->ProgramHeaders[i].p_memsz = segment.p_memsz;
+		this->ProgramHeaders[i].p_align = segment.p_align;
+	}
+
+	return true;
+}
+
+/*   Reads and normalizes the section header table.   */
+bool ELFImage::readSectionHeaders()
+{
+	unsigned int count = this->Header.e_shnum;
+	unsigned int entrySize = this->Header.e_shentsize;
+	if (count == 0 || this->Header.e_shoff == 0)
+		return true;
+	if (entrySize < (this->bit64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr)))
+		return false;
+
+	const char* table = map(this->Header.e_shoff, (unsigned long long)count * entrySize);
+	if (table == NULL)
+		return false;
+
+	this->SectionHeaders.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (this->bit64 == true)
+		{
+			memcpy(&this->SectionHeaders[i], table + (unsigned long long)i * entrySize, sizeof(Elf64_Shdr));
+			continue;
+		}
+
+		Elf32_Shdr section;
+		memcpy(&section, table + (unsigned long long)i * entrySize, sizeof(Elf32_Shdr));
+		this->SectionHeaders[i].sh_name = section.sh_name;
+		this->SectionHeaders[i].sh_type = section.sh_type;
+		this->SectionHeaders[i].sh_flags = section.sh_flags;
+		this->SectionHeaders[i].sh_addr = section.sh_addr;
+		this->SectionHeaders[i].sh_offset = section.sh_offset;
+		this->SectionHeaders[i].sh_size = section.sh_size;
+		this->SectionHeaders[i].sh_link = section.sh_link;
+		this->SectionHeaders[i].sh_info = section.sh_info;
+		this->SectionHeaders[i].sh_addralign = section.sh_addralign;
+		this->SectionHeaders[i].sh_entsize = section.sh_entsize;
+	}
+
+	return true;
+}
@@ -0,0 +1,285 @@
+#include "stdafx.h"
+
+#ifndef ELFIsa_H
+#define ELFIsa_H
+class ELFIsa
+{
+public:
+	explicit ELFIsa(string);
+	~ELFIsa();
+	bool IsReady();
+
+	/*   Options   */
+	void setBaseline(unsigned int);
+	void setTopCount(unsigned int);
+	static bool ParseBaseline(string, unsigned int&);
+
+	/*   Print the extension histogram and the functions above the baseline   */
+	void readCensus();
+private:
+	/*   Extension histogram of one function.   */
+	typedef struct IsaFunction {
+		string name;
+		unsigned long long address;
+		unsigned long long size;
+		int section;
+		unsigned long long offset;		// Start within the section.
+		unsigned int level;			// Highest level any instruction needs.
+		unsigned long long undecoded;		// Bytes skipped as undecodable.
+		unsigned long long counts[X86Decoder::EXTENSION_COUNT];
+	} ISA_FUNCTION;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int baseline = 1;
+	unsigned int topCount = 20;
+
+	vector<ISA_FUNCTION> Functions;
+	vector<const unsigned char*> SectionData;
+
+	void collectFunctions();
+	void decodeFunction(ISA_FUNCTION&);
+	static const char* GetLevelName(unsigned int);
+};
+#endif // !~ ELFIsa_H
+
+/*   Constructor with string of filename.   */
+ELFIsa::ELFIsa(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFIsa: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short machine = this->image->getMachine();
+	if (machine != EM_X86_64 && machine != EM_386)
+	{
+		printf("ELFIsa: Only x86 and x86-64 code can be decoded!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFIsa::~ELFIsa()
+{
+	for (unsigned long long i = 0; i < this->SectionData.size(); i++)
+		this->image->unpin((const char*)this->SectionData[i]);
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFIsa::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFIsa::setBaseline(unsigned int level)
+{
+	this->baseline = level;
+}
+void ELFIsa::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+
+/*   Parses x86-64, x86-64-v2, -v3 or -v4 into a level from 1 to 4.   */
+bool ELFIsa::ParseBaseline(string text, unsigned int& level)
+{
+	for (unsigned int i = 1; i <= 4; i++)
+	{
+		if (text == GetLevelName(i))
+		{
+			level = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*   Name of a psABI level.   */
+const char* ELFIsa::GetLevelName(unsigned int level)
+{
+	static const char* names[] = { "", "x86-64", "x86-64-v2", "x86-64-v3", "x86-64-v4", "beyond v4" };
+	return (level <= 5) ? names[level] : "";
+}
+
+/*   Collects the sized functions of the executable sections. Stripped
+	files are decoded a whole executable section at a time.   */
+void ELFIsa::collectFunctions()
+{
+	this->SectionData.assign(this->image->SectionHeaders.size(), NULL);
+
+	ISA_FUNCTION function;
+	memset(function.counts, 0, sizeof(function.counts));
+	function.level = 1;
+	function.undecoded = 0;
+
+	vector<ELFImage::FUNCTION_SYMBOL> symbols;
+	this->image->readFunctionSymbols(symbols);
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		function.name = symbols[i].name;
+		function.address = symbols[i].address;
+		function.size = symbols[i].size;
+		function.section = symbols[i].section;
+		function.offset = symbols[i].offset;
+		this->Functions.push_back(function);
+	}
+
+	if (this->Functions.empty())
+	{
+		bool relocatable = (this->image->getType() == ET_REL);
+		for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+		{
+			Elf64_Shdr& section = this->image->SectionHeaders[i];
+			if ((section.sh_flags & SHF_EXECINSTR) == 0 || section.sh_type == SHT_NOBITS || section.sh_size == 0)
+				continue;
+
+			function.name = this->image->GetSectionName(i);
+			function.address = relocatable ? 0 : section.sh_addr;
+			function.size = section.sh_size;
+			function.section = i;
+			function.offset = 0;
+			this->Functions.push_back(function);
+		}
+	}
+
+	// Sections are pinned here, the workers only read them.
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		int section = this->Functions[i].section;
+		if (this->SectionData[section] == NULL)
+			this->SectionData[section] = (const unsigned char*)this->image->pinSection(section);
+	}
+}
+
+/*   Linear sweep over one function, counting instructions by extension.   */
+void ELFIsa::decodeFunction(ISA_FUNCTION& function)
+{
+	const unsigned char* data = this->SectionData[function.section];
+	if (data == NULL)
+		return;
+
+	const unsigned char* code = data + function.offset;
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+
+	unsigned long long offset = 0;
+	while (offset < function.size)
+	{
+		X86Decoder::X86_INSTRUCTION instruction;
+		if (X86Decoder::Decode(code + offset, function.size - offset, is64, instruction) == false)
+		{
+			function.undecoded++;
+			offset++;
+			continue;
+		}
+
+		X86Decoder::Extension extension = X86Decoder::GetExtension(instruction);
+		function.counts[extension]++;
+		unsigned int level = X86Decoder::GetExtensionLevel(extension);
+		if (level > function.level)
+			function.level = level;
+		offset += instruction.length;
+	}
+}
+
+/*   Decodes every function on the pool and prints the extension histogram
+	of the binary, then the functions needing more than the baseline.   */
+void ELFIsa::readCensus()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	collectFunctions();
+	if (this->Functions.empty())
+	{
+		printf("ELFIsa: No executable code found!\n\n");
+		return;
+	}
+
+	ThreadPool pool;
+	pool.parallelFor(this->Functions.size(), [&](unsigned long long index, unsigned int)
+	{
+		decodeFunction(this->Functions[index]);
+	});
+
+	unsigned long long totals[X86Decoder::EXTENSION_COUNT] = { 0 };
+	unsigned long long users[X86Decoder::EXTENSION_COUNT] = { 0 };
+	unsigned long long instructions = 0, undecoded = 0;
+	vector<ISA_FUNCTION*> flagged;
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		ISA_FUNCTION& function = this->Functions[i];
+		for (int j = 0; j < X86Decoder::EXTENSION_COUNT; j++)
+		{
+			totals[j] += function.counts[j];
+			instructions += function.counts[j];
+			if (function.counts[j] > 0)
+				users[j]++;
+		}
+		undecoded += function.undecoded;
+
+		if (function.level > this->baseline)
+			flagged.push_back(&function);
+	}
+
+	printf("Instruction set extensions:\n");
+	printf("  Extension\t\tInstructions\tShare\tFunctions\tLevel\n");
+	for (int i = 0; i < X86Decoder::EXTENSION_COUNT; i++)
+	{
+		if (totals[i] == 0)
+			continue;
+
+		X86Decoder::Extension extension = (X86Decoder::Extension)i;
+		printf("  %-16s\t%12llu\t%5.1f%%\t%9llu\t%s\n", X86Decoder::GetExtensionName(extension), totals[i],
+			100.0 * totals[i] / instructions, users[i], GetLevelName(X86Decoder::GetExtensionLevel(extension)));
+	}
+	printf("\n  %zu functions, %llu instructions, %llu undecodable bytes\n\n", this->Functions.size(), instructions,
+		undecoded);
+
+	sort(flagged.begin(), flagged.end(), [](const ISA_FUNCTION* a, const ISA_FUNCTION* b)
+	{
+		return (a->level != b->level) ? a->level > b->level : a->size > b->size;
+	});
+
+	printf("Functions above %s: %zu\n", GetLevelName(this->baseline), flagged.size());
+	if (flagged.empty())
+	{
+		printf("\n");
+		return;
+	}
+
+	printf("  Needs\t\tSize\t\tFunction\n");
+	for (unsigned long long i = 0; i < flagged.size() && i < this->topCount; i++)
+	{
+		ISA_FUNCTION* function = flagged[i];
+		printf("  %-9s\t%8llu\t%s\n", GetLevelName(function->level), function->size, function->name.c_str());
+
+		// Histogram of the extensions the baseline lacks.
+		string histogram;
+		for (int j = 0; j < X86Decoder::EXTENSION_COUNT; j++)
+		{
+			X86Decoder::Extension extension = (X86Decoder::Extension)j;
+			if (function->counts[j] == 0 || X86Decoder::GetExtensionLevel(extension) <= this->baseline)
+				continue;
+
+			char entry[64];
+			snprintf(entry, sizeof(entry), "%s%s %llu", histogram.empty() ? "" : ", ",
+				X86Decoder::GetExtensionName(extension), function->counts[j]);
+			histogram += entry;
+		}
+		printf("\t\t\t\t%s\n", histogram.c_str());
+	}
+	printf("\n");
+}
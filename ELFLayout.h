@@ -0,0 +1,260 @@
+#include "stdafx.h"
+
+#ifndef ELFLayout_H
+#define ELFLayout_H
+class ELFLayout
+{
+public:
+	explicit ELFLayout(string);
+	~ELFLayout();
+	bool IsReady();
+
+	/*   Options   */
+	void setPageSize(unsigned long long);
+
+	/*   Print the page footprint of the load segments   */
+	void readLayout();
+private:
+	/*   Page footprint of one PT_LOAD segment.   */
+	typedef struct SegmentPages {
+		int index;				// Program header index.
+		unsigned long long pages;		// Pages the mapping spans.
+		unsigned long long filePages;		// Pages backed by the file.
+		unsigned long long anonPages;		// Zero-filled pages past the file data.
+		unsigned long long padding;		// Bytes of the pages outside the segment.
+		unsigned long long fileGap;		// File bytes skipped up to the next segment.
+		unsigned long long dirty;		// Pages written by relocations.
+		unsigned long long relro;		// Pages made read-only after relocation.
+	} SEGMENT_PAGES;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+	unsigned long long pageSize = 4096;
+
+	static const unsigned long long HUGE_PAGE_SIZE = 0x200000;
+
+	void collectRelocationPages(vector<unsigned long long>&);
+	unsigned long long countPages(const vector<unsigned long long>&, unsigned long long, unsigned long long);
+	void readHugePages(int);
+};
+#endif // !~ ELFLayout_H
+
+/*   Constructor with string of filename.   */
+ELFLayout::ELFLayout(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFLayout: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFLayout::~ELFLayout()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFLayout::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFLayout::setPageSize(unsigned long long size)
+{
+	this->pageSize = size;
+}
+
+/*   Sorted, distinct page numbers written by the dynamic relocations,
+	RELR included.   */
+void ELFLayout::collectRelocationPages(vector<unsigned long long>& pages)
+{
+	pages.clear();
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0)
+			continue;
+
+		if (section.sh_type == SHT_REL || section.sh_type == SHT_RELA)
+		{
+			vector<Elf64_Rela> relocations;
+			this->image->readRelocations(i, relocations);
+			for (unsigned long long j = 0; j < relocations.size(); j++)
+				pages.push_back(relocations[j].r_offset / this->pageSize);
+		}
+		else if (section.sh_type == SHT_RELR)
+		{
+			vector<unsigned long long> offsets;
+			this->image->readRelativeRelocations(i, offsets);
+			for (unsigned long long j = 0; j < offsets.size(); j++)
+				pages.push_back(offsets[j] / this->pageSize);
+		}
+	}
+
+	sort(pages.begin(), pages.end());
+	pages.erase(unique(pages.begin(), pages.end()), pages.end());
+}
+
+/*   Number of sorted pages in [first, last).   */
+unsigned long long ELFLayout::countPages(const vector<unsigned long long>& pages, unsigned long long first,
+	unsigned long long last)
+{
+	return lower_bound(pages.begin(), pages.end(), last) - lower_bound(pages.begin(), pages.end(), first);
+}
+
+/*   Prints how much of an executable segment 2 MB transparent huge pages
+	could back. File backed THP needs the address and file offset to agree
+	modulo 2 MB, and the loader only keeps that when p_align asks for it.   */
+void ELFLayout::readHugePages(int index)
+{
+	Elf64_Phdr& segment = this->image->ProgramHeaders[index];
+
+	unsigned long long start = (segment.p_vaddr + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	unsigned long long end = (segment.p_vaddr + segment.p_filesz) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	unsigned long long hugePages = (end > start) ? (end - start) / HUGE_PAGE_SIZE : 0;
+
+	bool congruent = (segment.p_vaddr % HUGE_PAGE_SIZE) == (segment.p_offset % HUGE_PAGE_SIZE);
+	bool aligned = segment.p_align >= HUGE_PAGE_SIZE;
+
+	printf("  [%d] 0x%llx bytes of text, p_align 0x%llx\n", index, (unsigned long long)segment.p_filesz,
+		(unsigned long long)segment.p_align);
+	printf("      %llu huge pages fit (%llu bytes), %llu bytes left in %llu byte pages\n", hugePages,
+		hugePages * HUGE_PAGE_SIZE, segment.p_filesz - hugePages * HUGE_PAGE_SIZE, this->pageSize);
+
+	if (segment.p_filesz < HUGE_PAGE_SIZE)
+		printf("      Not eligible: segment is smaller than a huge page\n");
+	else if (congruent == false)
+		printf("      Not eligible: address and file offset differ modulo 2 MB\n");
+	else if (aligned == false)
+		printf("      Not eligible: p_align is below 2 MB, link with -z max-page-size=0x200000\n");
+	else if (hugePages == 0)
+		printf("      Not eligible: no 2 MB aligned range inside the segment\n");
+	else
+		printf("      Eligible\n");
+}
+
+/*   Prints the pages mapped per PT_LOAD, what backs them, the padding lost
+	to alignment and the pages relocations make private.   */
+void ELFLayout::readLayout()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	vector<unsigned long long> relocated;
+	collectRelocationPages(relocated);
+
+	// RELRO is page aligned by the linker, partial pages are not protected.
+	unsigned long long relroFirst = 0, relroLast = 0;
+	vector<int> loads;
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		if (segment.p_type == PT_LOAD)
+			loads.push_back(i);
+		else if (segment.p_type == PT_GNU_RELRO)
+		{
+			relroFirst = segment.p_vaddr / this->pageSize;
+			relroLast = (segment.p_vaddr + segment.p_memsz) / this->pageSize;
+		}
+	}
+
+	if (loads.empty())
+	{
+		printf("ELFLayout: No PT_LOAD segments!\n\n");
+		return;
+	}
+
+	vector<SEGMENT_PAGES> layout;
+	for (unsigned long long i = 0; i < loads.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[loads[i]];
+		SEGMENT_PAGES pages;
+		pages.index = loads[i];
+
+		unsigned long long first = segment.p_vaddr / this->pageSize;
+		unsigned long long last = (segment.p_vaddr + segment.p_memsz + this->pageSize - 1) / this->pageSize;
+		unsigned long long fileLast = (segment.p_vaddr + segment.p_filesz + this->pageSize - 1) / this->pageSize;
+		if (fileLast > last)
+			fileLast = last;
+
+		pages.pages = last - first;
+		pages.filePages = fileLast - first;
+		pages.anonPages = last - fileLast;
+		pages.padding = pages.pages * this->pageSize - segment.p_memsz;
+
+		pages.fileGap = 0;
+		if (i + 1 < loads.size())
+		{
+			Elf64_Phdr& next = this->image->ProgramHeaders[loads[i + 1]];
+			if (next.p_offset > segment.p_offset + segment.p_filesz)
+				pages.fileGap = next.p_offset - (segment.p_offset + segment.p_filesz);
+		}
+
+		pages.dirty = (segment.p_flags & PF_W) ? countPages(relocated, first, last) : 0;
+
+		pages.relro = 0;
+		if (relroLast > relroFirst)
+		{
+			unsigned long long overlapFirst = max(first, relroFirst);
+			unsigned long long overlapLast = min(last, relroLast);
+			if (overlapLast > overlapFirst)
+				pages.relro = overlapLast - overlapFirst;
+		}
+
+		layout.push_back(pages);
+	}
+
+	printf("Load segments (%llu byte pages):\n", this->pageSize);
+	printf("  [Nr]\tFlags\tVirtAddr\t\tMemSize\t\tPages\tFile\tAnon\tPadding\tFileGap\tDirty\tRELRO\n");
+
+	unsigned long long total = 0, shared = 0, dirty = 0, anon = 0, relro = 0, padding = 0, fileGap = 0;
+	for (unsigned long long i = 0; i < layout.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[layout[i].index];
+		SEGMENT_PAGES& pages = layout[i];
+
+		printf("  [%d]\t%c%c%c\t0x%016llx\t0x%08llx\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\t%llu\n", pages.index,
+			(segment.p_flags & PF_R) ? 'R' : ' ', (segment.p_flags & PF_W) ? 'W' : ' ',
+			(segment.p_flags & PF_X) ? 'E' : ' ', (unsigned long long)segment.p_vaddr,
+			(unsigned long long)segment.p_memsz, pages.pages, pages.filePages, pages.anonPages, pages.padding,
+			pages.fileGap, pages.dirty, pages.relro);
+
+		total += pages.pages;
+		shared += pages.filePages - min(pages.filePages, pages.dirty);
+		dirty += pages.dirty;
+		anon += pages.anonPages;
+		relro += pages.relro;
+		padding += pages.padding;
+		fileGap += pages.fileGap;
+	}
+
+	printf("\n  %llu pages mapped (%llu KB), %llu bytes of page padding, %llu bytes of file gaps\n", total,
+		total * this->pageSize / 1024, padding, fileGap);
+	printf("  %llu clean file pages shareable between processes\n", shared);
+	printf("  %llu pages dirtied by relocations (%llu KB per process), %llu of %llu RELRO pages\n", dirty,
+		dirty * this->pageSize / 1024, countPages(relocated, relroFirst, relroLast), relro);
+	printf("  %llu zero-filled pages private once touched\n\n", anon);
+
+	printf("Huge pages (2 MB):\n");
+	bool text = false;
+	for (unsigned long long i = 0; i < layout.size(); i++)
+	{
+		if ((this->image->ProgramHeaders[layout[i].index].p_flags & PF_X) == 0)
+			continue;
+		readHugePages(layout[i].index);
+		text = true;
+	}
+	if (text == false)
+		printf("  No executable segments\n");
+	printf("\n");
+}
@@ -0,0 +1,395 @@
+#include "stdafx.h"
+
+#ifndef ELFMapping_H
+#define ELFMapping_H
+class ELFMapping
+{
+public:
+	explicit ELFMapping(string);
+	ELFMapping(int);
+	~ELFMapping();
+	bool IsReady();
+
+	unsigned long long getFileSize();
+
+	/*   Windowed access to the file   */
+	const char* map(unsigned long long, unsigned long long);
+	const char* mapPinned(unsigned long long, unsigned long long);
+	void unpin(const char*);
+	void release(unsigned long long, unsigned long long);
+	bool read(unsigned long long, void*, unsigned long long);
+	string readString(unsigned long long, unsigned long long);
+
+	/*   Writable copy-on-write view of a range   */
+	char* mapCopy(unsigned long long, unsigned long long);
+	void releaseCopy(char*);
+
+	/*   Mapping budget shared by every mapping   */
+	static void setMaxMap(unsigned long long);
+	static unsigned long long getMaxMap();
+	static bool parseSize(string, unsigned long long&);
+private:
+	/*   One mapped range of the file.   */
+	typedef struct MapWindow {
+		unsigned long long offset;		// File offset, window aligned.
+		unsigned long long size;		// Mapped length.
+		char* base;				// Start of the mapping.
+		unsigned long long lastUse;		// Tick of last access, for eviction.
+		unsigned int pins;			// Outstanding mapPinned calls, never evicted while set.
+	} MAP_WINDOW;
+
+	int fileDescriptor = -1;
+	bool ownsFile = false;
+	unsigned long long fileSize = 0;
+	unsigned long long mappedBytes = 0;
+	unsigned long long useCounter = 0;
+	bool reportedOverBudget = false;
+	vector<MAP_WINDOW> Windows;
+	// Copy-on-write views, never evicted.
+	vector<MAP_WINDOW> Copies;
+
+	// Granularity of windows, keeps small neighbouring reads in one mapping.
+	static const unsigned long long WINDOW_SIZE = 1ULL << 20;
+	static const unsigned long long MIN_MAP = 16ULL << 20;
+	static unsigned long long maxMapBytes;
+
+	int mapWindow(unsigned long long, unsigned long long);
+	void evictFor(unsigned long long);
+	void unmapWindow(int);
+};
+#endif // !~ ELFMapping_H
+
+unsigned long long ELFMapping::maxMapBytes = 512ULL << 20;
+
+/*   Constructor with string of filename.   */
+ELFMapping::ELFMapping(string FileName)
+{
+	this->fileDescriptor = open(FileName.c_str(), O_RDONLY);
+	if (this->fileDescriptor < 0)
+	{
+		printf("ELFMapping: Failed to open file! Error code: %d\n", errno);
+		return;
+	}
+	this->ownsFile = true;
+
+	struct stat st;
+	if (fstat(this->fileDescriptor, &st) == 0)
+		this->fileSize = st.st_size;
+}
+
+/*   Constructor with an already opened file descriptor.   */
+ELFMapping::ELFMapping(int fd)
+{
+	this->fileDescriptor = fd;
+
+	struct stat st;
+	if (fd >= 0 && fstat(fd, &st) == 0)
+		this->fileSize = st.st_size;
+}
+
+/*   Deconstructor of the class.   */
+ELFMapping::~ELFMapping()
+{
+	while (this->Windows.size() > 0)
+		unmapWindow(this->Windows.size() - 1);
+	for (unsigned long long i = 0; i < this->Copies.size(); i++)
+		munmap(this->Copies[i].base, this->Copies[i].size);
+
+	if (this->ownsFile == true)
+		close(this->fileDescriptor);
+}
+
+/*   Checks if the class is ready.   */
+bool ELFMapping::IsReady()
+{
+	return this->fileDescriptor >= 0;
+}
+
+/*   Size of the underlying file.   */
+unsigned long long ELFMapping::getFileSize()
+{
+	return this->fileSize;
+}
+
+/*   Maps a range of the file and returns a pointer to its first byte.
+	The pointer stays valid only until the next map call on this mapping,
+	which may evict its window. Use mapPinned to hold on to it longer.   */
+const char* ELFMapping::map(unsigned long long offset, unsigned long long size)
+{
+	int index = mapWindow(offset, size);
+	if (index < 0)
+		return NULL;
+
+	MAP_WINDOW& window = this->Windows[index];
+	return window.base + (offset - window.offset);
+}
+
+/*   Maps a range like map, but its window is never evicted or released
+	until the pointer is handed back to unpin.   */
+const char* ELFMapping::mapPinned(unsigned long long offset, unsigned long long size)
+{
+	int index = mapWindow(offset, size);
+	if (index < 0)
+		return NULL;
+
+	MAP_WINDOW& window = this->Windows[index];
+	window.pins++;
+	return window.base + (offset - window.offset);
+}
+
+/*   Drops one pin of the window holding a pointer returned by mapPinned.   */
+void ELFMapping::unpin(const char* pointer)
+{
+	for (unsigned long long i = 0; i < this->Windows.size(); i++)
+	{
+		MAP_WINDOW& window = this->Windows[i];
+		if (pointer < window.base || pointer >= window.base + window.size || window.pins == 0)
+			continue;
+
+		window.pins--;
+		return;
+	}
+}
+
+/*   Finds or maps the window covering a range, -1 on failure.   */
+int ELFMapping::mapWindow(unsigned long long offset, unsigned long long size)
+{
+	if (IsReady() == false || offset >= this->fileSize)
+		return -1;
+
+	if (size == 0)
+		size = 1;
+	if (offset + size > this->fileSize)
+		size = this->fileSize - offset;
+
+	// Reuse a window that already covers the range.
+	for (unsigned long long i = 0; i < this->Windows.size(); i++)
+	{
+		MAP_WINDOW& window = this->Windows[i];
+		if (offset >= window.offset && offset + size <= window.offset + window.size)
+		{
+			window.lastUse = ++this->useCounter;
+			return i;
+		}
+	}
+
+	// Widen the range to whole windows, clipped to the file.
+	unsigned long long start = offset & ~(WINDOW_SIZE - 1);
+	unsigned long long end = (offset + size + WINDOW_SIZE - 1) & ~(WINDOW_SIZE - 1);
+	if (end > this->fileSize)
+		end = this->fileSize;
+
+	evictFor(end - start);
+
+	char* base = (char*)mmap(0, end - start, PROT_READ, MAP_PRIVATE,
+		this->fileDescriptor, start);
+	if (base == MAP_FAILED)
+	{
+		printf("ELFMapping: Failed to map 0x%llx bytes at 0x%llx! Error code: %d\n",
+			end - start, start, errno);
+		return -1;
+	}
+
+	MAP_WINDOW window;
+	window.offset = start;
+	window.size = end - start;
+	window.base = base;
+	window.lastUse = ++this->useCounter;
+	window.pins = 0;
+	this->Windows.push_back(window);
+	this->mappedBytes += window.size;
+
+	return this->Windows.size() - 1;
+}
+
+/*   Maps a range privately and writable. Pages stay shared with the file
+	until they are written, so only patched pages cost memory.   */
+char* ELFMapping::mapCopy(unsigned long long offset, unsigned long long size)
+{
+	if (IsReady() == false || offset > this->fileSize || size > this->fileSize - offset)
+		return NULL;
+
+	unsigned long long start = offset & ~((unsigned long long)sysconf(_SC_PAGESIZE) - 1);
+	unsigned long long length = offset + size - start;
+	if (length == 0)
+		length = 1;
+
+	char* base = (char*)mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, this->fileDescriptor, start);
+	if (base == MAP_FAILED)
+	{
+		printf("ELFMapping: Failed to map a copy of 0x%llx bytes at 0x%llx! Error code: %d\n",
+			size, offset, errno);
+		return NULL;
+	}
+
+	MAP_WINDOW copy;
+	copy.offset = start;
+	copy.size = length;
+	copy.base = base;
+	copy.lastUse = 0;
+	copy.pins = 0;
+	this->Copies.push_back(copy);
+
+	return base + (offset - start);
+}
+
+/*   Unmaps a view returned by mapCopy.   */
+void ELFMapping::releaseCopy(char* view)
+{
+	for (unsigned long long i = 0; i < this->Copies.size(); i++)
+	{
+		MAP_WINDOW& copy = this->Copies[i];
+		if (view < copy.base || view >= copy.base + copy.size)
+			continue;
+
+		munmap(copy.base, copy.size);
+		this->Copies.erase(this->Copies.begin() + i);
+		return;
+	}
+}
+
+/*   Drops every unpinned window lying fully inside a range that was read.   */
+void ELFMapping::release(unsigned long long offset, unsigned long long size)
+{
+	for (int i = this->Windows.size() - 1; i >= 0; i--)
+	{
+		MAP_WINDOW& window = this->Windows[i];
+		if (window.pins == 0 && window.offset >= offset && window.offset + window.size <= offset + size)
+			unmapWindow(i);
+	}
+}
+
+/*   Copies a range of the file into a buffer.   */
+bool ELFMapping::read(unsigned long long offset, void* buffer, unsigned long long size)
+{
+	if (IsReady() == false || offset + size > this->fileSize)
+		return false;
+
+	return pread(this->fileDescriptor, buffer, size, offset) == (ssize_t)size;
+}
+
+/*   Reads a null terminated string of at most limit bytes.   */
+string ELFMapping::readString(unsigned long long offset, unsigned long long limit)
+{
+	if (offset >= this->fileSize)
+		return "";
+	if (offset + limit > this->fileSize)
+		limit = this->fileSize - offset;
+
+	// Try the rest of the current window first, most names are short.
+	unsigned long long windowEnd = (offset & ~(WINDOW_SIZE - 1)) + WINDOW_SIZE;
+	unsigned long long length = windowEnd - offset;
+	if (length > limit)
+		length = limit;
+
+	const char* p = map(offset, length);
+	if (p == NULL)
+		return "";
+
+	const char* terminator = (const char*)memchr(p, 0, length);
+	if (terminator != NULL)
+		return string(p, terminator - p);
+
+	// The string runs across a window boundary.
+	p = map(offset, limit);
+	if (p == NULL)
+		return "";
+
+	terminator = (const char*)memchr(p, 0, limit);
+	return string(p, terminator != NULL ? terminator - p : limit);
+}
+
+/*   Sets the budget of mapped bytes per mapping.   */
+void ELFMapping::setMaxMap(unsigned long long bytes)
+{
+	// Callers keep a few windows alive at once (e.g. a symbol chunk and
+	//  its string table), so don't go below a handful of windows.
+	if (bytes < MIN_MAP)
+		bytes = MIN_MAP;
+
+	maxMapBytes = bytes;
+}
+unsigned long long ELFMapping::getMaxMap()
+{
+	return maxMapBytes;
+}
+
+/*   Parses sizes like 4096, 512K, 256M or 2G.   */
+bool ELFMapping::parseSize(string text, unsigned long long& bytes)
+{
+	char* end = NULL;
+	errno = 0;
+	bytes = strtoull(text.c_str(), &end, 10);
+	if (end == text.c_str() || errno == ERANGE || text[0] == '-')
+		return false;
+
+	unsigned int shift;
+	switch (*end)
+	{
+		case 0:
+			return true;
+		case 'k':
+		case 'K':
+			shift = 10;
+			break;
+		case 'm':
+		case 'M':
+			shift = 20;
+			break;
+		case 'g':
+		case 'G':
+			shift = 30;
+			break;
+		default:
+			return false;
+	}
+
+	// Reject sizes the suffix would shift out of range.
+	if (bytes > (~0ULL >> shift))
+		return false;
+
+	bytes <<= shift;
+	return *(end + 1) == 0;
+}
+
+/*   Evicts least recently used unpinned windows until size bytes fit the
+	budget. When pinned windows hold too much of it the range is mapped
+	past the budget anyway, and that is reported once.   */
+void ELFMapping::evictFor(unsigned long long size)
+{
+	while (this->mappedBytes + size > maxMapBytes)
+	{
+		int oldest = -1;
+		for (unsigned long long i = 0; i < this->Windows.size(); i++)
+		{
+			if (this->Windows[i].pins == 0 && (oldest < 0 || this->Windows[i].lastUse < this->Windows[oldest].lastUse))
+				oldest = i;
+		}
+
+		// Nothing left to evict. A single range larger than the budget
+		//  is mapped as is, pinned windows in the way are reported.
+		if (oldest < 0)
+		{
+			if (this->Windows.size() > 0 && this->reportedOverBudget == false)
+			{
+				printf("ELFMapping: Pinned windows exceed the mapping budget, mapping 0x%llx bytes past it!\n",
+					this->mappedBytes + size - maxMapBytes);
+				this->reportedOverBudget = true;
+			}
+			return;
+		}
+
+		unmapWindow(oldest);
+	}
+}
+
+/*   Unmaps a window.   */
+void ELFMapping::unmapWindow(int index)
+{
+	MAP_WINDOW window = this->Windows[index];
+
+	munmap(window.base, window.size);
+
+	this->mappedBytes -= window.size;
+	this->Windows.erase(this->Windows.begin() + index);
+}
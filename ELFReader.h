@@ -1,10 +1,16 @@
 #include "stdafx.h"
 
+#ifndef ELFReader_H
+#define ELFReader_H
+#include "ELFMapping.h"
+#include "ELFImage.h"
+#include "ThreadPool.h"
+#include "HashFunctions.h"
+#include "ELFCache.h"
+#include "X86Decoder.h"
 #include "ELFHeader.h"
 #include "ELFFunction.h"
 
-#ifndef ELFReader_H
-#define ELFReader_H
 class ELFReader : public ELFHeader, public ELFFunction
 {
 public:
@@ -26,7 +32,6 @@ public:
 private:
 	FILE* readFile = NULL;
 };
-#endif // !~ELFReader_H
 
 
 ELFReader::ELFReader(string FileName) : ELFHeader::ELFHeader(FileName),
@@ -113,3 +118,5 @@ void ELFReader::readSymbol(string symbolName)
 
 	ELFFunction::readSymbol(symbolName);
 }
+
+#endif // !~ELFReader_H
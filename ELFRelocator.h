@@ -0,0 +1,608 @@
+#include "stdafx.h"
+
+#ifndef ELFRelocator_H
+#define ELFRelocator_H
+class ELFRelocator
+{
+public:
+	explicit ELFRelocator(string);
+	~ELFRelocator();
+	bool IsReady();
+
+	/*   Options   */
+	void setBaseAddress(unsigned long long);
+
+	/*   Resolved view of the sections   */
+	bool applyRelocations();
+	const unsigned char* getSectionView(int);
+	unsigned long long getSectionAddress(int);
+
+	/*   Print the layout, relocation counts and a relocated section   */
+	void readRelocated(string);
+private:
+	/*   Formulas of the relocation types.   */
+	enum RelocationForm {
+		FORM_SYMBOL,				// S + A, or Z + A, minus P when PC relative.
+		FORM_GOT,				// GOT + A - P.
+		FORM_GOT_OFFSET,			// S + A - GOT.
+		FORM_RELAX				// GOT load rewritten to reference S directly.
+	};
+
+	/*   What a relaxed GOT load was rewritten to.   */
+	enum RelaxResult {
+		RELAX_NONE,				// Needs a real GOT entry.
+		RELAX_PC,				// lea, call or jmp relative to the place.
+		RELAX_ABSOLUTE,				// mov of an immediate.
+		RELAX_GOT_OFFSET			// lea relative to the GOT base register.
+	};
+
+	/*   How a relocation type computes and stores its value.   */
+	typedef struct RelocationKind {
+		unsigned int width;			// Bytes written.
+		bool pcRelative;			// Subtract the place (P).
+		bool symbolSize;			// Use the symbol size (Z) instead of its value.
+		unsigned int form;			// RelocationForm.
+		const char* name;
+	} RELOCATION_KIND;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+	bool applied = false;
+
+	unsigned long long baseAddress = 0;
+	vector<unsigned long long> SectionAddresses;
+	vector<unsigned char*> Views;
+	// Synthetic GOT placed after the sections, for GOT relative types.
+	unsigned long long gotAddress = 0;
+	bool usedGOT = false;
+
+	int symbolTable = -1;
+	vector<Elf64_Sym> Symbols;
+	// _GLOBAL_OFFSET_TABLE_, which resolves to the synthetic GOT.
+	unsigned int gotSymbol = 0;
+
+	// Statistics of the last applyRelocations.
+	vector<pair<string, unsigned long long> > TypeCounts;
+	vector<string> Undefined;
+	unsigned long long appliedCount = 0, unsupportedCount = 0;
+
+	static bool GetKind(unsigned short, unsigned int, RELOCATION_KIND&);
+	static unsigned int RelaxGOTLoad(unsigned short, unsigned char*, unsigned long long&, bool);
+	void layoutSections();
+	bool GetSymbolValue(unsigned int, unsigned long long&, unsigned long long&);
+	void applySection(int);
+	unsigned long long applyRun(int, bool, const RELOCATION_KIND&, vector<Elf64_Rela>::iterator,
+		vector<Elf64_Rela>::iterator);
+};
+#endif // !~ ELFRelocator_H
+
+/*   Constructor with string of filename.   */
+ELFRelocator::ELFRelocator(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFRelocator: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	if (this->image->getType() != ET_REL)
+	{
+		printf("ELFRelocator: Not a relocatable object file!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short machine = this->image->getMachine();
+	if (machine != EM_X86_64 && machine != EM_386)
+	{
+		printf("ELFRelocator: Only x86-64 and i386 relocations are supported!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class, the views go with the mapping.   */
+ELFRelocator::~ELFRelocator()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFRelocator::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFRelocator::setBaseAddress(unsigned long long address)
+{
+	this->baseAddress = address;
+}
+
+/*   Width and formula of a relocation type. Relaxable GOT loads are
+	rewritten to the symbol itself like ld does, GOT base relative types
+	use a synthetic GOT address. Types that need real GOT entries, a PLT
+	or a TLS layout are not supported.   */
+bool ELFRelocator::GetKind(unsigned short machine, unsigned int type, RELOCATION_KIND& kind)
+{
+	kind.pcRelative = false;
+	kind.symbolSize = false;
+	kind.form = FORM_SYMBOL;
+
+	if (machine == EM_X86_64)
+	{
+		switch (type)
+		{
+			case R_X86_64_64:
+				kind.width = 8; kind.name = "R_X86_64_64";
+				return true;
+			case R_X86_64_32:
+				kind.width = 4; kind.name = "R_X86_64_32";
+				return true;
+			case R_X86_64_32S:
+				kind.width = 4; kind.name = "R_X86_64_32S";
+				return true;
+			case R_X86_64_16:
+				kind.width = 2; kind.name = "R_X86_64_16";
+				return true;
+			case R_X86_64_8:
+				kind.width = 1; kind.name = "R_X86_64_8";
+				return true;
+			case R_X86_64_PC64:
+				kind.width = 8; kind.pcRelative = true; kind.name = "R_X86_64_PC64";
+				return true;
+			case R_X86_64_PC32:
+				kind.width = 4; kind.pcRelative = true; kind.name = "R_X86_64_PC32";
+				return true;
+			case R_X86_64_PLT32:
+				kind.width = 4; kind.pcRelative = true; kind.name = "R_X86_64_PLT32";
+				return true;
+			case R_X86_64_GOTPCRELX:
+				kind.width = 4; kind.form = FORM_RELAX; kind.name = "R_X86_64_GOTPCRELX";
+				return true;
+			case R_X86_64_REX_GOTPCRELX:
+				kind.width = 4; kind.form = FORM_RELAX; kind.name = "R_X86_64_REX_GOTPCRELX";
+				return true;
+			case R_X86_64_PC16:
+				kind.width = 2; kind.pcRelative = true; kind.name = "R_X86_64_PC16";
+				return true;
+			case R_X86_64_PC8:
+				kind.width = 1; kind.pcRelative = true; kind.name = "R_X86_64_PC8";
+				return true;
+			case R_X86_64_SIZE32:
+				kind.width = 4; kind.symbolSize = true; kind.name = "R_X86_64_SIZE32";
+				return true;
+			case R_X86_64_SIZE64:
+				kind.width = 8; kind.symbolSize = true; kind.name = "R_X86_64_SIZE64";
+				return true;
+		}
+		return false;
+	}
+
+	if (machine == EM_386)
+	{
+		switch (type)
+		{
+			case R_386_32:
+				kind.width = 4; kind.name = "R_386_32";
+				return true;
+			case R_386_16:
+				kind.width = 2; kind.name = "R_386_16";
+				return true;
+			case R_386_8:
+				kind.width = 1; kind.name = "R_386_8";
+				return true;
+			case R_386_PC32:
+				kind.width = 4; kind.pcRelative = true; kind.name = "R_386_PC32";
+				return true;
+			case R_386_PLT32:
+				kind.width = 4; kind.pcRelative = true; kind.name = "R_386_PLT32";
+				return true;
+			case R_386_PC16:
+				kind.width = 2; kind.pcRelative = true; kind.name = "R_386_PC16";
+				return true;
+			case R_386_PC8:
+				kind.width = 1; kind.pcRelative = true; kind.name = "R_386_PC8";
+				return true;
+			case R_386_SIZE32:
+				kind.width = 4; kind.symbolSize = true; kind.name = "R_386_SIZE32";
+				return true;
+			case R_386_GOTPC:
+				kind.width = 4; kind.form = FORM_GOT; kind.name = "R_386_GOTPC";
+				return true;
+			case R_386_GOTOFF:
+				kind.width = 4; kind.form = FORM_GOT_OFFSET; kind.name = "R_386_GOTOFF";
+				return true;
+			case R_386_GOT32X:
+				kind.width = 4; kind.form = FORM_RELAX; kind.name = "R_386_GOT32X";
+				return true;
+		}
+	}
+	return false;
+}
+
+/*   Rewrites the instruction of a GOT load so it references the symbol
+	directly, as ld relaxes R_X86_64_[REX_]GOTPCRELX and R_386_GOT32X:
+	mov becomes lea (or mov of an immediate without a base register on
+	i386), an indirect call becomes addr32 call and an indirect jmp
+	becomes jmp followed by a nop. The jmp field starts a byte earlier,
+	offset is moved back to it.   */
+unsigned int ELFRelocator::RelaxGOTLoad(unsigned short machine, unsigned char* view, unsigned long long& offset, bool rex)
+{
+	if (offset < (rex ? 3 : 2))
+		return RELAX_NONE;
+
+	unsigned char* opcode = view + offset - 2;
+	unsigned char modrm = view[offset - 1];
+	// No base register, only a 32 bit displacement (RIP relative on x86-64).
+	bool direct = ((modrm & 0xc7) == 0x05);
+
+	if (opcode[0] == 0x8b)
+	{
+		if (machine == EM_X86_64)
+		{
+			if (direct == false)
+				return RELAX_NONE;
+			opcode[0] = 0x8d;
+			return RELAX_PC;
+		}
+
+		if (direct == true)
+		{
+			// mov foo@GOT, %reg -> mov $foo, %reg
+			opcode[0] = 0xc7;
+			view[offset - 1] = 0xc0 | ((modrm >> 3) & 7);
+			return RELAX_ABSOLUTE;
+		}
+		if ((modrm & 0xc0) != 0x80 || (modrm & 7) == 4)
+			return RELAX_NONE;
+		opcode[0] = 0x8d;
+		return RELAX_GOT_OFFSET;
+	}
+
+	if (opcode[0] != 0xff || rex == true)
+		return RELAX_NONE;
+
+	// call *foo@GOTPCREL(%rip) or call *foo@GOT(%reg)
+	if (modrm == 0x15 || (machine == EM_386 && (modrm & 0xf8) == 0x90))
+	{
+		opcode[0] = 0x67;
+		opcode[1] = 0xe8;
+		return RELAX_PC;
+	}
+
+	// jmp *foo@GOTPCREL(%rip) or jmp *foo@GOT(%reg)
+	if (modrm == 0x25 || (machine == EM_386 && (modrm & 0xf8) == 0xa0))
+	{
+		opcode[0] = 0xe9;
+		view[offset + 3] = 0x90;
+		offset--;
+		return RELAX_PC;
+	}
+
+	return RELAX_NONE;
+}
+
+/*   Places the allocated sections one after the other from the base
+	address, each at its own alignment. Other sections stay at 0.   */
+void ELFRelocator::layoutSections()
+{
+	this->SectionAddresses.assign(this->image->SectionHeaders.size(), 0);
+
+	unsigned long long address = this->baseAddress;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0)
+			continue;
+
+		unsigned long long alignment = (section.sh_addralign > 1) ? section.sh_addralign : 1;
+		address = (address + alignment - 1) / alignment * alignment;
+		this->SectionAddresses[i] = address;
+		address += section.sh_size;
+	}
+
+	this->gotAddress = (address + 7) & ~7ULL;
+}
+
+/*   Final value and size of a symbol, false when it is undefined.   */
+bool ELFRelocator::GetSymbolValue(unsigned int index, unsigned long long& value, unsigned long long& size)
+{
+	value = 0;
+	size = 0;
+	if (index == 0)
+		return true;
+	if (index >= this->Symbols.size())
+		return false;
+
+	Elf64_Sym& symbol = this->Symbols[index];
+	size = symbol.st_size;
+
+	if (symbol.st_shndx == SHN_ABS)
+	{
+		value = symbol.st_value;
+		return true;
+	}
+	if (index == this->gotSymbol)
+	{
+		value = this->gotAddress;
+		return true;
+	}
+	if (symbol.st_shndx == SHN_UNDEF || symbol.st_shndx >= this->SectionAddresses.size())
+		return false;
+
+	value = this->SectionAddresses[symbol.st_shndx] + symbol.st_value;
+	return true;
+}
+
+/*   Applies a run of relocations of one type to one section. The kind is
+	decided once, so the loop only computes and stores values.   */
+unsigned long long ELFRelocator::applyRun(int target, bool withAddend, const RELOCATION_KIND& kind,
+	vector<Elf64_Rela>::iterator first, vector<Elf64_Rela>::iterator last)
+{
+	unsigned char* view = this->Views[target];
+	unsigned long long sectionSize = this->image->SectionHeaders[target].sh_size;
+	unsigned long long sectionAddress = this->SectionAddresses[target];
+	unsigned short machine = this->image->getMachine();
+	unsigned long long count = 0;
+
+	for (vector<Elf64_Rela>::iterator it = first; it != last; it++)
+	{
+		if (it->r_offset > sectionSize || kind.width > sectionSize - it->r_offset)
+			continue;
+
+		unsigned char* place = view + it->r_offset;
+
+		// REL keeps the addend in the field itself.
+		long long addend = it->r_addend;
+		if (withAddend == false)
+		{
+			long long implicit = 0;
+			memcpy(&implicit, place, kind.width);
+			if (kind.width < 8)
+				implicit = (implicit << (64 - kind.width * 8)) >> (64 - kind.width * 8);
+			addend = implicit;
+		}
+
+		unsigned int symbol = ELF64_R_SYM(it->r_info);
+		unsigned long long value, size;
+		bool defined = GetSymbolValue(symbol, value, size);
+
+		// Only a GOT load of a defined symbol can be relaxed, the others
+		//  need a GOT entry.
+		unsigned long long offset = it->r_offset;
+		unsigned int relaxed = RELAX_NONE;
+		if (kind.form == FORM_RELAX)
+		{
+			if (defined == true)
+				relaxed = RelaxGOTLoad(machine, view, offset, ELF64_R_TYPE(it->r_info) == R_X86_64_REX_GOTPCRELX);
+			if (relaxed == RELAX_NONE)
+			{
+				this->unsupportedCount++;
+				continue;
+			}
+			place = view + offset;
+		}
+
+		// Undefined symbols resolve to 0, as for an unresolved weak reference.
+		if (defined == false && kind.form != FORM_GOT && symbol < this->Symbols.size())
+			this->Undefined.push_back(this->image->GetSymbolName(this->symbolTable, this->Symbols[symbol]));
+
+		unsigned long long result = (kind.symbolSize ? size : value) + addend;
+		unsigned long long address = sectionAddress + offset;
+		switch (kind.form)
+		{
+			case FORM_SYMBOL:
+				if (kind.pcRelative == true)
+					result -= address;
+				break;
+			case FORM_GOT:
+				result = this->gotAddress + addend - address;
+				this->usedGOT = true;
+				break;
+			case FORM_GOT_OFFSET:
+				result -= this->gotAddress;
+				this->usedGOT = true;
+				break;
+			case FORM_RELAX:
+				if (relaxed == RELAX_GOT_OFFSET)
+				{
+					result -= this->gotAddress;
+					this->usedGOT = true;
+				}
+				else if (relaxed == RELAX_PC)
+				{
+					result -= address;
+					// R_386_GOT32X has no PC bias in its addend, the field
+					//  is now relative to the end of the instruction.
+					if (machine == EM_386)
+						result -= 4;
+				}
+				break;
+		}
+
+		memcpy(place, &result, kind.width);
+		count++;
+	}
+
+	return count;
+}
+
+/*   Applies one relocation section, batched by type.   */
+void ELFRelocator::applySection(int index)
+{
+	Elf64_Shdr& section = this->image->SectionHeaders[index];
+	unsigned int target = section.sh_info;
+	if (target == 0 || target >= this->image->SectionHeaders.size() ||
+		this->image->SectionHeaders[target].sh_type == SHT_NOBITS)
+		return;
+
+	vector<Elf64_Rela> relocations;
+	if (this->image->readRelocations(index, relocations) == false || relocations.empty())
+		return;
+
+	if (this->Views[target] == NULL)
+	{
+		Elf64_Shdr& data = this->image->SectionHeaders[target];
+		this->Views[target] = (unsigned char*)this->image->mapCopy(data.sh_offset, data.sh_size);
+		if (this->Views[target] == NULL)
+			return;
+	}
+
+	// Stable, so relocations of one field keep their order.
+	stable_sort(relocations.begin(), relocations.end(), [](const Elf64_Rela& a, const Elf64_Rela& b)
+	{
+		return ELF64_R_TYPE(a.r_info) < ELF64_R_TYPE(b.r_info);
+	});
+
+	unsigned short machine = this->image->getMachine();
+	vector<Elf64_Rela>::iterator first = relocations.begin();
+	while (first != relocations.end())
+	{
+		unsigned int type = ELF64_R_TYPE(first->r_info);
+		vector<Elf64_Rela>::iterator last = first;
+		while (last != relocations.end() && ELF64_R_TYPE(last->r_info) == type)
+			last++;
+
+		RELOCATION_KIND kind;
+		if (GetKind(machine, type, kind) == false)
+		{
+			// R_*_NONE does nothing and is not worth reporting.
+			if (type != 0)
+				this->unsupportedCount += last - first;
+		}
+		else
+		{
+			unsigned long long count = applyRun(target, section.sh_type == SHT_RELA, kind, first, last);
+			this->appliedCount += count;
+
+			unsigned long long i = 0;
+			while (i < this->TypeCounts.size() && this->TypeCounts[i].first != kind.name)
+				i++;
+			if (i == this->TypeCounts.size())
+				this->TypeCounts.push_back(make_pair(string(kind.name), 0ULL));
+			this->TypeCounts[i].second += count;
+		}
+
+		first = last;
+	}
+}
+
+/*   Lays out the sections and applies every relocation section into
+	copy-on-write views of the sections they patch.   */
+bool ELFRelocator::applyRelocations()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return false;
+	}
+	if (this->applied == true)
+		return true;
+	this->applied = true;
+
+	layoutSections();
+	this->Views.assign(this->image->SectionHeaders.size(), NULL);
+
+	this->symbolTable = this->image->GetIndexOfSection(".symtab");
+	if (this->symbolTable >= 0)
+		this->image->readSymbols(this->symbolTable, this->Symbols);
+	for (unsigned int i = 1; i < this->Symbols.size() && this->gotSymbol == 0; i++)
+	{
+		if (this->Symbols[i].st_shndx == SHN_UNDEF &&
+			this->image->GetSymbolName(this->symbolTable, this->Symbols[i]) == "_GLOBAL_OFFSET_TABLE_")
+			this->gotSymbol = i;
+	}
+
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		unsigned int type = this->image->SectionHeaders[i].sh_type;
+		if (type == SHT_REL || type == SHT_RELA)
+			applySection(i);
+	}
+
+	sort(this->Undefined.begin(), this->Undefined.end());
+	this->Undefined.erase(unique(this->Undefined.begin(), this->Undefined.end()), this->Undefined.end());
+	return true;
+}
+
+/*   Contents of a section with relocations applied, or as in the file
+	when nothing patches it.   */
+const unsigned char* ELFRelocator::getSectionView(int index)
+{
+	if (applyRelocations() == false || index < 0 || index >= (int)this->Views.size())
+		return NULL;
+
+	if (this->Views[index] != NULL)
+		return this->Views[index];
+	return (const unsigned char*)this->image->mapSection(index);
+}
+
+/*   Address a section was placed at.   */
+unsigned long long ELFRelocator::getSectionAddress(int index)
+{
+	if (applyRelocations() == false || index < 0 || index >= (int)this->SectionAddresses.size())
+		return 0;
+
+	return this->SectionAddresses[index];
+}
+
+/*   Prints the layout, the applied relocations and, when a section name
+	is given, the relocated bytes of that section.   */
+void ELFRelocator::readRelocated(string sectionName)
+{
+	if (applyRelocations() == false)
+		return;
+
+	printf("Section layout:\n");
+	printf("  [Nr]\tName\t\t\tAddress\t\t\tSize\n");
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		if ((this->image->SectionHeaders[i].sh_flags & SHF_ALLOC) == 0)
+			continue;
+		printf("  [%llu]\t%-16s\t0x%016llx\t0x%08llx\n", i, this->image->GetSectionName(i).c_str(),
+			this->SectionAddresses[i], (unsigned long long)this->image->SectionHeaders[i].sh_size);
+	}
+	if (this->usedGOT == true)
+		printf("  \t%-16s\t0x%016llx\n", "(GOT)", this->gotAddress);
+
+	printf("\nApplied relocations:\n");
+	for (unsigned long long i = 0; i < this->TypeCounts.size(); i++)
+		printf("  %-24s\t%llu\n", this->TypeCounts[i].first.c_str(), this->TypeCounts[i].second);
+	printf("  %llu applied, %llu unsupported\n", this->appliedCount, this->unsupportedCount);
+
+	if (this->Undefined.empty() == false)
+	{
+		printf("\nUndefined symbols (resolved to 0):\n");
+		for (unsigned long long i = 0; i < this->Undefined.size(); i++)
+			printf("  %s\n", this->Undefined[i].c_str());
+	}
+	printf("\n");
+
+	if (sectionName.empty())
+		return;
+
+	int index = this->image->GetIndexOfSection(sectionName);
+	const unsigned char* data = getSectionView(index);
+	if (data == NULL)
+	{
+		printf("%s section not found!\n\n", sectionName.c_str());
+		return;
+	}
+
+	printf("%s (relocated):\n", sectionName.c_str());
+	unsigned long long size = this->image->SectionHeaders[index].sh_size;
+	unsigned long long address = this->SectionAddresses[index];
+	for (unsigned long long i = 0; i < size; i += 16)
+	{
+		printf("0x%016llx ", address + i);
+		for (unsigned long long j = i; j < i + 16 && j < size; j++)
+			printf(" %02x", data[j]);
+		printf("\n");
+	}
+	printf("\n");
+}
@@ -0,0 +1,303 @@
+#include "stdafx.h"
+
+#ifndef ELFRelr_H
+#define ELFRelr_H
+class ELFRelr
+{
+public:
+	explicit ELFRelr(string);
+	~ELFRelr();
+	bool IsReady();
+
+	/*   Print current and RELR packed relocation sizes   */
+	void readSavings();
+private:
+	/*   Streaming RELR encoder, fed relative offsets in ascending order.   */
+	typedef struct RelrEncoder {
+		unsigned long long wordSize;
+		unsigned long long base;		// First address the next bitmap covers.
+		bool started;				// An address entry was written.
+		bool bitmapUsed;			// The current bitmap has bits set.
+		unsigned long long entries;		// RELR words written.
+		unsigned long long bitmaps;		// Of which bitmaps.
+	} RELR_ENCODER;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int GetRelativeType();
+	unsigned long long walkRelative(int, unsigned int, const function<void(unsigned long long)>&);
+	static void Encode(RELR_ENCODER&, unsigned long long);
+	static void Finish(RELR_ENCODER&);
+};
+#endif // !~ ELFRelr_H
+
+/*   Constructor with string of filename.   */
+ELFRelr::ELFRelr(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFRelr: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFRelr::~ELFRelr()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFRelr::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   The *_RELATIVE type of the machine, 0 when unknown.   */
+unsigned int ELFRelr::GetRelativeType()
+{
+	switch (this->image->getMachine())
+	{
+		case EM_X86_64:
+			return R_X86_64_RELATIVE;
+		case EM_386:
+			return R_386_RELATIVE;
+		case EM_AARCH64:
+			return R_AARCH64_RELATIVE;
+		case EM_ARM:
+			return R_ARM_RELATIVE;
+		case EM_RISCV:
+			return R_RISCV_RELATIVE;
+	}
+	return 0;
+}
+
+/*   Calls visit with the place of every relative relocation of a REL or
+	RELA section, straight from the mapped table. Returns the entry count.   */
+unsigned long long ELFRelr::walkRelative(int index, unsigned int relativeType,
+	const function<void(unsigned long long)>& visit)
+{
+	Elf64_Shdr& section = this->image->SectionHeaders[index];
+	bool bit64 = this->image->is64();
+	bool withAddend = (section.sh_type == SHT_RELA);
+	unsigned long long minimum = bit64 ? (withAddend ? sizeof(Elf64_Rela) : sizeof(Elf64_Rel)) :
+		(withAddend ? sizeof(Elf32_Rela) : sizeof(Elf32_Rel));
+	unsigned long long entrySize = (section.sh_entsize >= minimum) ? section.sh_entsize : minimum;
+
+	const char* table = this->image->mapSection(index);
+	if (table == NULL)
+		return 0;
+
+	unsigned long long count = section.sh_size / entrySize;
+	for (unsigned long long i = 0; i < count; i++)
+	{
+		const char* entry = table + i * entrySize;
+		unsigned long long offset = 0, type;
+		if (bit64 == true)
+		{
+			unsigned long long info;
+			memcpy(&offset, entry, 8);
+			memcpy(&info, entry + 8, 8);
+			type = ELF64_R_TYPE(info);
+		}
+		else
+		{
+			unsigned int info;
+			memcpy(&offset, entry, 4);
+			memcpy(&info, entry + 4, 4);
+			type = ELF32_R_TYPE(info);
+		}
+
+		if (type == relativeType)
+			visit(offset);
+	}
+	return count;
+}
+
+/*   Adds one offset to the encoding. An address entry starts a run, the
+	bitmaps after it cover wordSize * 8 - 1 words each; a bitmap with no
+	bit set ends the run, so the next offset takes an address entry.   */
+void ELFRelr::Encode(RELR_ENCODER& encoder, unsigned long long offset)
+{
+	unsigned long long span = (encoder.wordSize * 8 - 1) * encoder.wordSize;
+	while (true)
+	{
+		if (encoder.started == false)
+		{
+			encoder.entries++;
+			encoder.base = offset + encoder.wordSize;
+			encoder.started = true;
+			encoder.bitmapUsed = false;
+			return;
+		}
+
+		if (offset >= encoder.base && offset < encoder.base + span &&
+			(offset - encoder.base) % encoder.wordSize == 0)
+		{
+			encoder.bitmapUsed = true;
+			return;
+		}
+
+		if (encoder.bitmapUsed == true)
+		{
+			// Close the bitmap, the next one may still reach the offset.
+			encoder.entries++;
+			encoder.bitmaps++;
+			encoder.base += span;
+			encoder.bitmapUsed = false;
+		}
+		else
+			encoder.started = false;
+	}
+}
+void ELFRelr::Finish(RELR_ENCODER& encoder)
+{
+	if (encoder.bitmapUsed == true)
+	{
+		encoder.entries++;
+		encoder.bitmaps++;
+		encoder.bitmapUsed = false;
+	}
+}
+
+/*   Walks the mapped dynamic relocation tables once, feeding the word
+	aligned relative relocations to a RELR encoder, and prints the table
+	sizes and the entries the loader decodes at startup before and after.   */
+void ELFRelr::readSavings()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	unsigned int relativeType = GetRelativeType();
+	if (relativeType == 0)
+	{
+		printf("ELFRelr: Unsupported machine %u!\n\n", this->image->getMachine());
+		return;
+	}
+
+	bool bit64 = this->image->is64();
+	unsigned long long wordSize = bit64 ? 8 : 4;
+
+	RELR_ENCODER encoder;
+	memset(&encoder, 0, sizeof(encoder));
+	encoder.wordSize = wordSize;
+
+	unsigned long long tableBytes = 0, entries = 0, relative = 0, relativeBytes = 0, unaligned = 0;
+	unsigned long long relrBytes = 0, relrOffsets = 0;
+	unsigned long long previous = 0;
+	bool sorted = true;
+
+	printf("Dynamic relocation tables:\n");
+	printf("  [Nr]\tName\t\t\tEntries\t\tRelative\tSize\n");
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0)
+			continue;
+
+		if (section.sh_type == SHT_RELR)
+		{
+			// Already packed, count what it holds.
+			vector<unsigned long long> packed;
+			this->image->readRelativeRelocations(i, packed);
+			relrBytes += section.sh_size;
+			relrOffsets += packed.size();
+			printf("  [%llu]\t%-16s\t%llu\t\t%zu\t\t%llu\n", i, this->image->GetSectionName(i).c_str(),
+				section.sh_size / wordSize, packed.size(), (unsigned long long)section.sh_size);
+			continue;
+		}
+		if (section.sh_type != SHT_REL && section.sh_type != SHT_RELA)
+			continue;
+
+		unsigned long long entrySize = (section.sh_type == SHT_RELA) ?
+			(bit64 ? sizeof(Elf64_Rela) : sizeof(Elf32_Rela)) : (bit64 ? sizeof(Elf64_Rel) : sizeof(Elf32_Rel));
+		if (section.sh_entsize > entrySize)
+			entrySize = section.sh_entsize;
+
+		unsigned long long sectionRelative = 0;
+		unsigned long long count = walkRelative(i, relativeType, [&](unsigned long long offset)
+		{
+			sectionRelative++;
+
+			// RELR can only describe word aligned places.
+			if (offset % wordSize != 0)
+			{
+				unaligned++;
+				return;
+			}
+
+			if (offset < previous)
+				sorted = false;
+			if (sorted == true && (offset != previous || relative == 0))
+				Encode(encoder, offset);
+			previous = offset;
+			relative++;
+		});
+
+		tableBytes += count * entrySize;
+		entries += count;
+		relativeBytes += sectionRelative * entrySize;
+		printf("  [%llu]\t%-16s\t%llu\t\t%llu\t\t%llu\n", i, this->image->GetSectionName(i).c_str(), count,
+			sectionRelative, count * entrySize);
+	}
+
+	// Linkers sort relative relocations by address, so this is rare.
+	if (sorted == false)
+	{
+		vector<unsigned long long> offsets;
+		for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+		{
+			Elf64_Shdr& section = this->image->SectionHeaders[i];
+			if ((section.sh_flags & SHF_ALLOC) != 0 && (section.sh_type == SHT_REL || section.sh_type == SHT_RELA))
+			{
+				walkRelative(i, relativeType, [&](unsigned long long offset)
+				{
+					if (offset % wordSize == 0)
+						offsets.push_back(offset);
+				});
+			}
+		}
+
+		sort(offsets.begin(), offsets.end());
+		offsets.erase(unique(offsets.begin(), offsets.end()), offsets.end());
+		memset(&encoder, 0, sizeof(encoder));
+		encoder.wordSize = wordSize;
+		for (unsigned long long i = 0; i < offsets.size(); i++)
+			Encode(encoder, offsets[i]);
+	}
+	Finish(encoder);
+
+	if (relrBytes > 0)
+		printf("\n  Already packed: %llu relative relocations in %llu bytes of RELR\n", relrOffsets, relrBytes);
+
+	if (relative == 0)
+	{
+		printf("\n  No packable relative relocations\n\n");
+		return;
+	}
+
+	unsigned long long relativeEntrySize = relativeBytes / (relative + unaligned);
+	unsigned long long packedBytes = encoder.entries * wordSize;
+	// DT_RELR, DT_RELRSZ and DT_RELRENT.
+	unsigned long long dynamicBytes = 3 * 2 * wordSize;
+	unsigned long long projected = tableBytes - relative * relativeEntrySize + packedBytes + dynamicBytes;
+
+	printf("\nRELR projection:\n");
+	printf("  %llu relative relocations, %llu word aligned, %llu stay in the table\n", relative + unaligned,
+		relative, unaligned);
+	printf("  %llu RELR words (%llu addresses, %llu bitmaps), %.2f relocations per word\n", encoder.entries,
+		encoder.entries - encoder.bitmaps, encoder.bitmaps, (double)relative / encoder.entries);
+	printf("  Relocation bytes:\t%llu -> %llu (%lld saved, %.1f%%)\n", tableBytes, projected,
+		(long long)(tableBytes - projected), 100.0 * ((double)tableBytes - projected) / tableBytes);
+	printf("  Entries decoded:\t%llu -> %llu\n", entries, entries - relative + encoder.entries);
+	printf("  Table pages read:\t%llu -> %llu\n", (tableBytes + 4095) / 4096, (projected + 4095) / 4096);
+	printf("  Link with -z pack-relative-relocs (ld 2.38+, lld) to apply\n\n");
+}
@@ -0,0 +1,354 @@
+#include "stdafx.h"
+
+#ifndef ELFSearch_H
+#define ELFSearch_H
+class ELFSearch
+{
+public:
+	ELFSearch(string, string, bool);
+	~ELFSearch();
+	bool IsReady();
+
+	/*   Print matching symbols   */
+	void readMatches();
+
+	/*   Literal search over raw bytes   */
+	static void FindLiteral(const char*, unsigned long long, string, vector<unsigned long long>&);
+private:
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	string pattern;
+	bool isRegex;
+	regex* compiled = NULL;
+
+	// Literal every match must contain, and whether it starts the name.
+	string literal;
+	bool anchored = false;
+
+	void ExtractGlobLiteral();
+	void ExtractRegexLiteral();
+	bool Matches(const string&);
+	unsigned long long searchTable(int);
+};
+#endif // !~ ELFSearch_H
+
+/*   Constructor with string of filename, the pattern and its syntax.   */
+ELFSearch::ELFSearch(string FileName, string pattern, bool isRegex)
+{
+	this->pattern = pattern;
+	this->isRegex = isRegex;
+
+	if (isRegex == true)
+	{
+		try
+		{
+			this->compiled = new regex(pattern, regex::extended | regex::optimize);
+		}
+		catch (regex_error& error)
+		{
+			printf("ELFSearch: Invalid regular expression: %s\n", error.what());
+			this->InvalidELFFormat = true;
+			return;
+		}
+		ExtractRegexLiteral();
+	}
+	else
+		ExtractGlobLiteral();
+
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFSearch: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFSearch::~ELFSearch()
+{
+	if (this->compiled != NULL)
+		delete this->compiled;
+	if (this->image != NULL)
+		delete this->image;
+	if (this->mapping != NULL)
+		delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFSearch::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Picks the longest literal run of a glob pattern.   */
+void ELFSearch::ExtractGlobLiteral()
+{
+	string current;
+	bool atStart = true, currentAnchored = false;
+
+	for (unsigned long long i = 0; i <= this->pattern.size(); i++)
+	{
+		char c = (i < this->pattern.size()) ? this->pattern[i] : 0;
+		bool special = (c == 0 || c == '*' || c == '?' || c == '[' || c == '\\');
+
+		if (special == false)
+		{
+			if (current.empty())
+				currentAnchored = atStart;
+			current += c;
+			continue;
+		}
+
+		if (current.size() > this->literal.size())
+		{
+			this->literal = current;
+			this->anchored = currentAnchored;
+		}
+		current.clear();
+		atStart = false;
+
+		// Skip over a bracket expression, it matches a single character.
+		if (c == '[')
+		{
+			size_t end = this->pattern.find(']', i + 2);
+			if (end != string::npos)
+				i = end;
+		}
+		else if (c == '\\' && i + 1 < this->pattern.size())
+			i++;
+	}
+}
+
+/*   Picks the longest literal run a regular expression requires.
+	Anything with alternation gets no literal, every name is tried.
+	Runs inside groups are never taken, the group may be optional.   */
+void ELFSearch::ExtractRegexLiteral()
+{
+	if (this->pattern.find('|') != string::npos)
+		return;
+
+	string current;
+	bool atStart = (this->pattern.size() > 0 && this->pattern[0] == '^');
+	bool currentAnchored = false;
+	int depth = 0;
+
+	for (unsigned long long i = atStart ? 1 : 0; i <= this->pattern.size(); i++)
+	{
+		char c = (i < this->pattern.size()) ? this->pattern[i] : 0;
+
+		// A quantifier makes the character before it optional.
+		if (c == '?' || c == '*' || c == '{')
+		{
+			if (current.size() > 0)
+				current.erase(current.size() - 1);
+		}
+
+		bool special = (c == 0 || strchr(".[]()^$+?*{}\\", c) != NULL);
+		if (special == false && depth == 0)
+		{
+			if (current.empty())
+				currentAnchored = atStart;
+			current += c;
+			continue;
+		}
+
+		if (current.size() > this->literal.size())
+		{
+			this->literal = current;
+			this->anchored = currentAnchored;
+		}
+		current.clear();
+		atStart = false;
+
+		if (c == '(')
+			depth++;
+		else if (c == ')' && depth > 0)
+			depth--;
+
+		// Skip bracket expressions and repetition counts.
+		if (c == '[' || c == '{')
+		{
+			size_t end = this->pattern.find(c == '[' ? ']' : '}', i + 2);
+			if (end != string::npos)
+				i = end;
+		}
+		else if (c == '\\' && i + 1 < this->pattern.size())
+			i++;
+	}
+}
+
+/*   Full match of one name against the pattern.   */
+bool ELFSearch::Matches(const string& name)
+{
+	if (this->isRegex == true)
+		return regex_search(name, *this->compiled);
+
+	return fnmatch(this->pattern.c_str(), name.c_str(), 0) == 0;
+}
+
+/*   Finds every occurrence of a literal, 16 bytes at a time.
+	Blocks are tested on the first and last byte of the literal, only
+	positions where both match are compared in full.   */
+void ELFSearch::FindLiteral(const char* data, unsigned long long size, string literal,
+	vector<unsigned long long>& hits)
+{
+	unsigned long long length = literal.size();
+	if (length == 0 || size < length)
+		return;
+
+	unsigned long long i = 0;
+
+#ifdef __SSE2__
+	const __m128i first = _mm_set1_epi8(literal[0]);
+	const __m128i last = _mm_set1_epi8(literal[length - 1]);
+
+	for (; i + length - 1 + 16 <= size; i += 16)
+	{
+		__m128i blockFirst = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i blockLast = _mm_loadu_si128((const __m128i*)(data + i + length - 1));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst),
+			_mm_cmpeq_epi8(last, blockLast)));
+
+		while (mask != 0)
+		{
+			unsigned int bit = __builtin_ctz(mask);
+			if (length <= 2 || memcmp(data + i + bit + 1, literal.data() + 1, length - 2) == 0)
+				hits.push_back(i + bit);
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	// Tail of the buffer, or everything without SSE2.
+	for (; i + length <= size; i++)
+	{
+		if (data[i] == literal[0] && memcmp(data + i, literal.data(), length) == 0)
+			hits.push_back(i);
+	}
+}
+
+/*   Searches one symbol table, returns the number of matches.   */
+unsigned long long ELFSearch::searchTable(int index)
+{
+	vector<Elf64_Sym> symbols;
+	if (this->image->readSymbols(index, symbols) == false)
+		return 0;
+
+	unsigned int link = this->image->SectionHeaders[index].sh_link;
+	if (link >= this->image->SectionHeaders.size())
+		return 0;
+
+	Elf64_Shdr& strings = this->image->SectionHeaders[link];
+	const char* table = this->image->mapSection(link);
+	if (table == NULL)
+		return 0;
+
+	// Offset to symbol index, sorted on the name offset.
+	vector<pair<unsigned int, unsigned int> > byName;
+	byName.reserve(symbols.size());
+	for (unsigned int i = 0; i < symbols.size(); i++)
+	{
+		if (symbols[i].st_name != 0 && symbols[i].st_name < strings.sh_size)
+			byName.push_back(make_pair(symbols[i].st_name, i));
+	}
+	sort(byName.begin(), byName.end());
+
+	// Candidate symbols from the literal hits. A name can start anywhere
+	//  between the previous terminator and the hit, since linkers share
+	//  suffixes of names, so the whole span of offsets is a candidate.
+	vector<unsigned int> candidates;
+	if (this->literal.empty())
+	{
+		for (unsigned long long i = 0; i < byName.size(); i++)
+			candidates.push_back(byName[i].second);
+	}
+	else
+	{
+		vector<unsigned long long> hits;
+		FindLiteral(table, strings.sh_size, this->literal, hits);
+
+		for (unsigned long long i = 0; i < hits.size(); i++)
+		{
+			unsigned long long first = hits[i];
+			if (this->anchored == false)
+			{
+				const char* terminator = (const char*)memrchr(table, 0, hits[i]);
+				first = (terminator == NULL) ? 0 : terminator - table + 1;
+			}
+
+			vector<pair<unsigned int, unsigned int> >::iterator it = lower_bound(byName.begin(), byName.end(),
+				make_pair((unsigned int)first, 0U));
+			for (; it != byName.end() && it->first <= hits[i]; it++)
+				candidates.push_back(it->second);
+		}
+
+		// A symbol may be reached by several hits inside its name.
+		sort(candidates.begin(), candidates.end());
+		candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+	}
+
+	unsigned long long matches = 0;
+	for (unsigned long long i = 0; i < candidates.size(); i++)
+	{
+		Elf64_Sym& symbol = symbols[candidates[i]];
+		unsigned long long limit = strings.sh_size - symbol.st_name;
+		string name(table + symbol.st_name, strnlen(table + symbol.st_name, limit));
+		if (Matches(name) == false)
+			continue;
+
+		const char* type;
+		switch (ELF64_ST_TYPE(symbol.st_info))
+		{
+			case STT_OBJECT:
+				type = "OBJECT";
+				break;
+			case STT_FUNC:
+				type = "FUNCTION";
+				break;
+			case STT_SECTION:
+				type = "SECTION";
+				break;
+			case STT_FILE:
+				type = "FILE";
+				break;
+			default:
+				type = "NO TYPE";
+				break;
+		}
+
+		printf("  [%u]\t0x%016llx\t%8llu\t%-8s\t%s\n", candidates[i], (unsigned long long)symbol.st_value,
+			(unsigned long long)symbol.st_size, type, name.c_str());
+		matches++;
+	}
+
+	return matches;
+}
+
+/*   Prints the symbols of .symtab and .dynsym matching the pattern.   */
+void ELFSearch::readMatches()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	unsigned long long total = 0;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		unsigned int type = this->image->SectionHeaders[i].sh_type;
+		if (type != SHT_SYMTAB && type != SHT_DYNSYM)
+			continue;
+
+		printf("%s:\n", this->image->GetSectionName(i).c_str());
+		unsigned long long matches = searchTable(i);
+		printf("  %llu matching symbols\n\n", matches);
+		total += matches;
+	}
+
+	if (total == 0)
+		printf("%s symbol not found!\n\n", this->pattern.c_str());
+}
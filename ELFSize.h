@@ -0,0 +1,441 @@
+#include "stdafx.h"
+
+#ifndef ELFSize_H
+#define ELFSize_H
+class ELFSize
+{
+public:
+	explicit ELFSize(string);
+	~ELFSize();
+	bool IsReady();
+
+	/*   Options   */
+	void setDemangle(bool);
+	void setTopCount(unsigned int);
+
+	/*   Print the size attribution report   */
+	void readSizes();
+
+	/*   Namespace or class of a demangled name, "(global)" if none   */
+	static string GetScope(string);
+private:
+	/*   One symbol placed in a section.   */
+	typedef struct SizeSymbol {
+		unsigned long long address;
+		unsigned long long size;		// Bytes inside the section.
+		unsigned int nameOffset;		// Offset in the string table.
+		int section;				// Index in SectionHeaders.
+	} SIZE_SYMBOL;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	bool demangle = false;
+	unsigned int topCount = 20;
+
+	// Bytes covered by symbols per section, filled by attributeSymbols.
+	vector<unsigned long long> SymbolBytes;
+	vector<SIZE_SYMBOL> Symbols;
+	// String table of the symbols, names are read on demand.
+	unsigned long long stringTableOffset = 0;
+	unsigned long long stringTableSize = 0;
+
+	bool isAllocated(const Elf64_Shdr&);
+	unsigned long long GetFileBytes(const Elf64_Shdr&);
+	unsigned long long GetVMBytes(const Elf64_Shdr&);
+	string GetName(const SIZE_SYMBOL&);
+	void attributeSymbols();
+	void printSegments();
+	void printSections();
+	void printSymbols();
+	void printScopes();
+};
+#endif // !~ ELFSize_H
+
+/*   Constructor with string of filename.   */
+ELFSize::ELFSize(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFSize: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFSize::~ELFSize()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFSize::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFSize::setDemangle(bool enabled)
+{
+	this->demangle = enabled;
+}
+void ELFSize::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+
+/*   Sections taking address space. TLS templates for .tbss overlap the
+	sections after them and take none.   */
+bool ELFSize::isAllocated(const Elf64_Shdr& section)
+{
+	if ((section.sh_flags & SHF_ALLOC) == 0)
+		return false;
+
+	return !(section.sh_type == SHT_NOBITS && (section.sh_flags & SHF_TLS) != 0);
+}
+unsigned long long ELFSize::GetFileBytes(const Elf64_Shdr& section)
+{
+	return (section.sh_type == SHT_NOBITS || section.sh_type == SHT_NULL) ? 0 : section.sh_size;
+}
+unsigned long long ELFSize::GetVMBytes(const Elf64_Shdr& section)
+{
+	return isAllocated(section) ? section.sh_size : 0;
+}
+
+/*   Name of a symbol, demangled when asked for.   */
+string ELFSize::GetName(const SIZE_SYMBOL& symbol)
+{
+	if (symbol.nameOffset >= this->stringTableSize)
+		return "";
+
+	string result = this->image->readString(this->stringTableOffset + symbol.nameOffset,
+		this->stringTableSize - symbol.nameOffset);
+
+	if (this->demangle == true)
+	{
+		int status;
+		char* demangled = abi::__cxa_demangle(result.c_str(), NULL, NULL, &status);
+		if (demangled != NULL)
+		{
+			result = demangled;
+			free(demangled);
+		}
+	}
+	return result;
+}
+
+/*   Strips the return type, parameter list and template arguments of a
+	demangled name and returns everything before the last "::".   */
+string ELFSize::GetScope(string name)
+{
+	string scope;
+	int depth = 0;
+	size_t lastSeparator = string::npos;
+
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		char c = name[i];
+
+		// Not a parameter list.
+		if (depth == 0 && name.compare(i, 21, "(anonymous namespace)") == 0)
+		{
+			scope += "(anonymous namespace)";
+			i += 20;
+			continue;
+		}
+
+		// A top level space ends the return type of a template function.
+		if (c == ' ' && depth == 0 && (scope.size() < 8 || scope.compare(scope.size() - 8, 8, "operator") != 0))
+		{
+			scope.clear();
+			lastSeparator = string::npos;
+			continue;
+		}
+
+		if (c == '<' || c == '(')
+		{
+			// Parameters start the first top level parenthesis.
+			if (c == '(' && depth == 0)
+				break;
+			depth++;
+		}
+		else if ((c == '>' || c == ')') && depth > 0)
+			depth--;
+		else if (c == ':' && depth == 0 && i + 1 < name.size() && name[i + 1] == ':')
+		{
+			lastSeparator = scope.size();
+			scope += "::";
+			i++;
+			continue;
+		}
+
+		if (depth == 0 && c != '>' && c != ')')
+			scope += c;
+	}
+
+	if (lastSeparator == string::npos)
+		return "(global)";
+	return scope.substr(0, lastSeparator);
+}
+
+/*   Joins the address sorted symbols to the address sorted sections in a
+	single pass. Aliases and overlapping symbols count once.   */
+void ELFSize::attributeSymbols()
+{
+	this->SymbolBytes.assign(this->image->SectionHeaders.size(), 0);
+
+	// .symtab when present, the dynamic table otherwise.
+	int table = this->image->GetSymbolTable();
+
+	vector<Elf64_Sym> symbols;
+	if (table < 0 || this->image->readSymbols(table, symbols) == false)
+		return;
+
+	unsigned int link = this->image->SectionHeaders[table].sh_link;
+	if (link < this->image->SectionHeaders.size() && this->image->SectionHeaders[link].sh_type != SHT_NOBITS)
+	{
+		this->stringTableOffset = this->image->SectionHeaders[link].sh_offset;
+		this->stringTableSize = this->image->SectionHeaders[link].sh_size;
+	}
+
+	// Relocatable objects have section relative values, addresses are
+	//  then made unique by the section offset in the file.
+	bool relocatable = (this->image->getType() == ET_REL);
+	vector<int> sections;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		if (isAllocated(this->image->SectionHeaders[i]) && this->image->SectionHeaders[i].sh_size > 0)
+			sections.push_back(i);
+	}
+	auto GetStart = [this, relocatable](int index) -> unsigned long long
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[index];
+		return relocatable ? section.sh_offset : section.sh_addr;
+	};
+	sort(sections.begin(), sections.end(), [&](int a, int b) { return GetStart(a) < GetStart(b); });
+
+	for (unsigned long long i = 0; i < symbols.size(); i++)
+	{
+		Elf64_Sym& symbol = symbols[i];
+		unsigned char type = ELF64_ST_TYPE(symbol.st_info);
+		if (symbol.st_size == 0 || symbol.st_shndx == SHN_UNDEF || symbol.st_shndx >= SHN_LORESERVE ||
+			(type != STT_FUNC && type != STT_OBJECT && type != STT_NOTYPE))
+			continue;
+
+		SIZE_SYMBOL entry;
+		entry.address = symbol.st_value;
+		if (relocatable == true && symbol.st_shndx < this->image->SectionHeaders.size())
+			entry.address += this->image->SectionHeaders[symbol.st_shndx].sh_offset;
+		entry.size = symbol.st_size;
+		entry.nameOffset = symbol.st_name;
+		entry.section = -1;
+		this->Symbols.push_back(entry);
+	}
+
+	sort(this->Symbols.begin(), this->Symbols.end(), [](const SIZE_SYMBOL& a, const SIZE_SYMBOL& b)
+	{
+		return (a.address != b.address) ? a.address < b.address : a.size > b.size;
+	});
+
+	unsigned long long current = 0;
+	unsigned long long coveredEnd = 0;
+	vector<SIZE_SYMBOL> placed;
+	placed.reserve(this->Symbols.size());
+
+	for (unsigned long long i = 0; i < this->Symbols.size(); i++)
+	{
+		SIZE_SYMBOL entry = this->Symbols[i];
+
+		while (current < sections.size() &&
+			GetStart(sections[current]) + this->image->SectionHeaders[sections[current]].sh_size <= entry.address)
+		{
+			current++;
+			coveredEnd = 0;
+		}
+		if (current >= sections.size())
+			break;
+
+		int index = sections[current];
+		unsigned long long start = GetStart(index);
+		unsigned long long end = start + this->image->SectionHeaders[index].sh_size;
+		if (entry.address < start)
+			continue;
+
+		unsigned long long symbolEnd = min(entry.address + entry.size, end);
+		entry.size = symbolEnd - entry.address;
+		entry.section = index;
+
+		// Only bytes past what earlier symbols covered are new.
+		unsigned long long newStart = max(entry.address, coveredEnd);
+		if (symbolEnd > newStart)
+			this->SymbolBytes[index] += symbolEnd - newStart;
+		if (symbolEnd > coveredEnd)
+			coveredEnd = symbolEnd;
+
+		// Aliases of the symbol before it are not listed again.
+		if (placed.empty() == false && placed.back().address == entry.address && placed.back().size == entry.size)
+			continue;
+		placed.push_back(entry);
+	}
+
+	this->Symbols.swap(placed);
+}
+
+/*   Loadable segments with the bytes no section accounts for.   */
+void ELFSize::printSegments()
+{
+	printf("Segments:\n");
+	printf("  [Nr]\tFile size\tVM size\t\tUnattributed file\tUnattributed VM\n");
+
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		if (segment.p_type != PT_LOAD)
+			continue;
+
+		unsigned long long fileBytes = 0, vmBytes = 0;
+		for (unsigned long long j = 0; j < this->image->SectionHeaders.size(); j++)
+		{
+			Elf64_Shdr& section = this->image->SectionHeaders[j];
+			if (isAllocated(section) == false || section.sh_addr < segment.p_vaddr ||
+				section.sh_addr >= segment.p_vaddr + segment.p_memsz)
+				continue;
+
+			fileBytes += GetFileBytes(section);
+			vmBytes += GetVMBytes(section);
+		}
+
+		printf("  [%llu]\t%9llu\t%9llu\t%9llu\t\t%9llu\n", i, (unsigned long long)segment.p_filesz,
+			(unsigned long long)segment.p_memsz,
+			segment.p_filesz > fileBytes ? (unsigned long long)segment.p_filesz - fileBytes : 0ULL,
+			segment.p_memsz > vmBytes ? (unsigned long long)segment.p_memsz - vmBytes : 0ULL);
+	}
+	printf("\n");
+}
+
+/*   Sections with the bytes covered by symbols, largest first.   */
+void ELFSize::printSections()
+{
+	vector<int> order;
+	for (unsigned long long i = 1; i < this->image->SectionHeaders.size(); i++)
+		order.push_back(i);
+	sort(order.begin(), order.end(), [this](int a, int b)
+	{
+		Elf64_Shdr& first = this->image->SectionHeaders[a];
+		Elf64_Shdr& second = this->image->SectionHeaders[b];
+		unsigned long long sizeA = max(GetFileBytes(first), GetVMBytes(first));
+		unsigned long long sizeB = max(GetFileBytes(second), GetVMBytes(second));
+		return (sizeA != sizeB) ? sizeA > sizeB : a < b;
+	});
+
+	printf("Sections:\n");
+	printf("  [Nr]\tName\t\t\tFile size\tVM size\t\tSymbols\t\tUnattributed\n");
+
+	unsigned long long sectionBytes = 0;
+	for (unsigned long long i = 0; i < order.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[order[i]];
+		unsigned long long size = max(GetFileBytes(section), GetVMBytes(section));
+		sectionBytes += GetFileBytes(section);
+
+		printf("  [%d]\t%-16s\t%9llu\t%9llu\t%9llu\t%9llu\n", order[i],
+			this->image->GetSectionName(order[i]).c_str(), GetFileBytes(section), GetVMBytes(section),
+			this->SymbolBytes[order[i]], size - this->SymbolBytes[order[i]]);
+	}
+
+	// Everything else in the file: headers, tables and padding.
+	Elf64_Ehdr& header = this->image->Header;
+	unsigned long long headerBytes = header.e_ehsize + (unsigned long long)header.e_phnum * header.e_phentsize +
+		(unsigned long long)header.e_shnum * header.e_shentsize;
+	unsigned long long fileSize = this->image->getSize();
+	unsigned long long known = sectionBytes + headerBytes;
+
+	printf("\n  File: %llu bytes, %llu in sections, %llu in headers, %llu unattributed\n\n", fileSize,
+		sectionBytes, headerBytes, fileSize > known ? fileSize - known : 0ULL);
+}
+
+/*   Largest symbols.   */
+void ELFSize::printSymbols()
+{
+	if (this->Symbols.empty())
+	{
+		printf("No sized symbols found!\n\n");
+		return;
+	}
+
+	vector<int> order(this->Symbols.size());
+	for (unsigned long long i = 0; i < order.size(); i++)
+		order[i] = i;
+
+	unsigned int count = min<unsigned long long>(this->topCount, order.size());
+	partial_sort(order.begin(), order.begin() + count, order.end(), [this](int a, int b)
+	{
+		return this->Symbols[a].size > this->Symbols[b].size;
+	});
+
+	printf("Largest symbols:\n");
+	printf("  Size\t\tSection\t\t\tName\n");
+	for (unsigned int i = 0; i < count; i++)
+	{
+		SIZE_SYMBOL& symbol = this->Symbols[order[i]];
+		printf("  %9llu\t%-16s\t%s\n", symbol.size, this->image->GetSectionName(symbol.section).c_str(),
+			GetName(symbol).c_str());
+	}
+	printf("\n");
+}
+
+/*   Symbol bytes rolled up per namespace or class.   */
+void ELFSize::printScopes()
+{
+	vector<pair<string, pair<unsigned long long, unsigned long long> > > scopes;
+	{
+		vector<pair<string, unsigned long long> > named;
+		named.reserve(this->Symbols.size());
+		for (unsigned long long i = 0; i < this->Symbols.size(); i++)
+			named.push_back(make_pair(GetScope(GetName(this->Symbols[i])), this->Symbols[i].size));
+
+		sort(named.begin(), named.end());
+		for (unsigned long long i = 0; i < named.size(); i++)
+		{
+			if (scopes.empty() || scopes.back().first != named[i].first)
+				scopes.push_back(make_pair(named[i].first, make_pair(0ULL, 0ULL)));
+			scopes.back().second.first += named[i].second;
+			scopes.back().second.second++;
+		}
+	}
+
+	sort(scopes.begin(), scopes.end(), [](const pair<string, pair<unsigned long long, unsigned long long> >& a,
+		const pair<string, pair<unsigned long long, unsigned long long> >& b)
+	{
+		return a.second.first > b.second.first;
+	});
+
+	printf("Namespaces:\n");
+	printf("  Size\t\tSymbols\t\tNamespace\n");
+	for (unsigned long long i = 0; i < scopes.size() && i < this->topCount; i++)
+		printf("  %9llu\t%7llu\t\t%s\n", scopes[i].second.first, scopes[i].second.second, scopes[i].first.c_str());
+	printf("\n");
+}
+
+/*   Prints the size report, segments then sections then symbols.   */
+void ELFSize::readSizes()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	attributeSymbols();
+
+	if (this->image->ProgramHeaders.empty() == false)
+		printSegments();
+	printSections();
+	printSymbols();
+	if (this->demangle == true)
+		printScopes();
+}
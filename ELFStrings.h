@@ -0,0 +1,300 @@
+#include "stdafx.h"
+
+#ifndef ELFStrings_H
+#define ELFStrings_H
+class ELFStrings
+{
+public:
+	explicit ELFStrings(string);
+	~ELFStrings();
+	bool IsReady();
+
+	/*   Options   */
+	void setMinimumLength(unsigned int);
+	void setUTF16(bool);
+	void addSection(string);
+
+	/*   Print strings   */
+	void readStrings();
+
+	/*   Printable byte classification   */
+	static unsigned int GetPrintableMask(const unsigned char*);
+	static unsigned int GetUTF16Mask(const unsigned char*);
+private:
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int minimumLength = 4;
+	bool utf16 = false;
+	vector<string> Sections;
+
+	unsigned long long scanASCII(int, const unsigned char*, unsigned long long);
+	unsigned long long scanUTF16(int, const unsigned char*, unsigned long long);
+	void printString(int, unsigned long long, const unsigned char*, unsigned long long, bool);
+};
+#endif // !~ ELFStrings_H
+
+/*   Constructor with string of filename.   */
+ELFStrings::ELFStrings(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFStrings: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFStrings::~ELFStrings()
+{
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFStrings::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFStrings::setMinimumLength(unsigned int length)
+{
+	this->minimumLength = (length == 0) ? 1 : length;
+}
+void ELFStrings::setUTF16(bool enabled)
+{
+	this->utf16 = enabled;
+}
+void ELFStrings::addSection(string sectionName)
+{
+	this->Sections.push_back(sectionName);
+}
+
+/*   Bit i is set when byte i of the 16 byte block is printable ASCII or a tab.   */
+unsigned int ELFStrings::GetPrintableMask(const unsigned char* block)
+{
+#ifdef __SSE2__
+	__m128i bytes = _mm_loadu_si128((const __m128i*)block);
+
+	// Unsigned range check 0x20..0x7e done with a signed compare:
+	//  (b - 0x20) ^ 0x80 < (0x5f ^ 0x80).
+	__m128i shifted = _mm_xor_si128(_mm_sub_epi8(bytes, _mm_set1_epi8(0x20)), _mm_set1_epi8((char)0x80));
+	__m128i printable = _mm_cmplt_epi8(shifted, _mm_set1_epi8((char)(0x5f ^ 0x80)));
+	__m128i tab = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('\t'));
+
+	return _mm_movemask_epi8(_mm_or_si128(printable, tab));
+#else
+	unsigned int mask = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if ((block[i] >= 0x20 && block[i] <= 0x7e) || block[i] == '\t')
+			mask |= 1U << i;
+	}
+	return mask;
+#endif
+}
+
+/*   Bit i is set when bytes i, i+1 of the block (17 bytes are read) form a
+	printable little endian UTF-16 unit.   */
+unsigned int ELFStrings::GetUTF16Mask(const unsigned char* block)
+{
+	unsigned int printable = GetPrintableMask(block);
+
+#ifdef __SSE2__
+	__m128i next = _mm_loadu_si128((const __m128i*)(block + 1));
+	unsigned int zero = _mm_movemask_epi8(_mm_cmpeq_epi8(next, _mm_setzero_si128()));
+#else
+	unsigned int zero = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		if (block[i + 1] == 0)
+			zero |= 1U << i;
+	}
+#endif
+
+	return printable & zero;
+}
+
+/*   Prints one string with its section, offset and virtual address.   */
+void ELFStrings::printString(int index, unsigned long long position, const unsigned char* data,
+	unsigned long long length, bool wide)
+{
+	Elf64_Shdr& section = this->image->SectionHeaders[index];
+
+	string text;
+	text.reserve(length);
+	for (unsigned long long i = 0; i < length; i++)
+		text += (char)data[position + (wide ? i * 2 : i)];
+
+	printf("  0x%08llx\t0x%016llx\t%s%s\n", section.sh_offset + position,
+		section.sh_addr != 0 ? section.sh_addr + position : 0ULL, wide ? "(UTF-16) " : "", text.c_str());
+}
+
+/*   Finds printable runs from the block masks, returns the count.
+	Run boundaries are where the mask changes from one byte to the
+	next, so only the changes are visited.   */
+unsigned long long ELFStrings::scanASCII(int index, const unsigned char* data, unsigned long long size)
+{
+	unsigned long long count = 0;
+	unsigned long long runStart = 0;
+	bool inRun = false;
+
+	unsigned long long i = 0;
+	for (; i + 16 <= size; i += 16)
+	{
+		unsigned int mask = GetPrintableMask(data + i);
+
+		// Whole block continues the current state.
+		if ((mask == 0xFFFF && inRun == true) || (mask == 0 && inRun == false))
+			continue;
+
+		unsigned int changes = (mask ^ ((mask << 1) | (inRun ? 1U : 0U))) & 0xFFFF;
+		while (changes != 0)
+		{
+			unsigned int bit = __builtin_ctz(changes);
+			changes &= changes - 1;
+
+			if (mask & (1U << bit))
+			{
+				runStart = i + bit;
+				inRun = true;
+			}
+			else
+			{
+				if (i + bit - runStart >= this->minimumLength)
+				{
+					printString(index, runStart, data, i + bit - runStart, false);
+					count++;
+				}
+				inRun = false;
+			}
+		}
+	}
+
+	// Tail of the section, byte by byte.
+	for (; i < size; i++)
+	{
+		bool printable = (data[i] >= 0x20 && data[i] <= 0x7e) || data[i] == '\t';
+		if (printable == true && inRun == false)
+		{
+			runStart = i;
+			inRun = true;
+		}
+		else if (printable == false && inRun == true)
+		{
+			if (i - runStart >= this->minimumLength)
+			{
+				printString(index, runStart, data, i - runStart, false);
+				count++;
+			}
+			inRun = false;
+		}
+	}
+
+	if (inRun == true && size - runStart >= this->minimumLength)
+	{
+		printString(index, runStart, data, size - runStart, false);
+		count++;
+	}
+
+	return count;
+}
+
+/*   Finds UTF-16 runs at even and odd offsets, blocks without any printable
+	unit are skipped as a whole.   */
+unsigned long long ELFStrings::scanUTF16(int index, const unsigned char* data, unsigned long long size)
+{
+	unsigned long long count = 0;
+
+	for (int parity = 0; parity < 2; parity++)
+	{
+		unsigned long long runStart = 0, units = 0;
+		bool inRun = false;
+
+		for (unsigned long long i = parity; i + 1 < size; i += 2)
+		{
+			// Skip ahead while nothing printable is in the next block.
+			if (inRun == false && (i & 15) == (unsigned long long)parity && i + 17 <= size &&
+				GetUTF16Mask(data + i - parity) == 0)
+			{
+				i += 14;
+				continue;
+			}
+
+			bool printable = ((data[i] >= 0x20 && data[i] <= 0x7e) || data[i] == '\t') && data[i + 1] == 0;
+			if (printable == true)
+			{
+				if (inRun == false)
+				{
+					runStart = i;
+					units = 0;
+					inRun = true;
+				}
+				units++;
+				continue;
+			}
+
+			if (inRun == true && units >= this->minimumLength)
+			{
+				printString(index, runStart, data, units, true);
+				count++;
+			}
+			inRun = false;
+		}
+
+		if (inRun == true && units >= this->minimumLength)
+		{
+			printString(index, runStart, data, units, true);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+/*   Prints the strings of the selected sections.   */
+void ELFStrings::readStrings()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	if (this->Sections.empty())
+	{
+		this->Sections.push_back(".rodata");
+		this->Sections.push_back(".data");
+		this->Sections.push_back(".comment");
+	}
+
+	for (unsigned long long i = 0; i < this->Sections.size(); i++)
+	{
+		int index = this->image->GetIndexOfSection(this->Sections[i]);
+		if (index < 0)
+		{
+			printf("%s section not found!\n\n", this->Sections[i].c_str());
+			continue;
+		}
+
+		printf("%s:\n", this->Sections[i].c_str());
+
+		const unsigned char* data = (const unsigned char*)this->image->mapSection(index);
+		if (data == NULL)
+		{
+			printf("  No data in file.\n\n");
+			continue;
+		}
+
+		unsigned long long size = this->image->SectionHeaders[index].sh_size;
+		unsigned long long count = scanASCII(index, data, size);
+		if (this->utf16 == true)
+			count += scanUTF16(index, data, size);
+
+		printf("  %llu strings\n\n", count);
+	}
+}
@@ -0,0 +1,513 @@
+#include "stdafx.h"
+
+#ifndef ELFUnreferenced_H
+#define ELFUnreferenced_H
+class ELFUnreferenced
+{
+public:
+	explicit ELFUnreferenced(string);
+	~ELFUnreferenced();
+	bool IsReady();
+
+	/*   Options   */
+	void setTopCount(unsigned int);
+
+	/*   Print the functions nothing in the binary refers to   */
+	void readUnreferenced();
+private:
+	/*   Function symbol and how it is reached.   */
+	typedef ELFImage::FUNCTION_SYMBOL UNREFERENCED_FUNCTION;
+
+	/*   Range of a section scanned by one worker.   */
+	typedef struct ScanUnit {
+		int section;
+		unsigned long long offset;
+		unsigned long long size;
+		bool code;				// Decoded, otherwise read as pointers.
+		unsigned long long owner;		// Start of the function decoded, self references do not count.
+	} SCAN_UNIT;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	unsigned int topCount = 20;
+
+	unsigned long long textStart = 0;
+	unsigned long long textEnd = 0;
+	unsigned long long wordSize = 8;
+	unsigned long long gotAddress = 0;	// i386 @GOTOFF base.
+
+	vector<UNREFERENCED_FUNCTION> Functions;
+	vector<SCAN_UNIT> Units;
+	vector<const unsigned char*> SectionData;
+	vector<unsigned long long> Roots;	// Entry point and init/fini array entries.
+
+	void collectFunctions();
+	void collectUnits();
+	void collectExports(vector<unsigned long long>&);
+	unsigned long long markRelocations(vector<unsigned long long>&);
+	void scanCode(const SCAN_UNIT&, vector<unsigned long long>&);
+	void scanData(const SCAN_UNIT&, vector<unsigned long long>&);
+	bool IsInitArray(int);
+	void mark(vector<unsigned long long>&, unsigned long long, unsigned long long);
+	bool IsMarked(const vector<unsigned long long>&, unsigned long long);
+};
+#endif // !~ ELFUnreferenced_H
+
+/*   Constructor with string of filename.   */
+ELFUnreferenced::ELFUnreferenced(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFUnreferenced: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short machine = this->image->getMachine();
+	if (machine != EM_X86_64 && machine != EM_386)
+	{
+		printf("ELFUnreferenced: Only x86 and x86-64 code can be decoded!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short type = this->image->getType();
+	if (type != ET_EXEC && type != ET_DYN)
+	{
+		printf("ELFUnreferenced: Only linked executables and shared objects have final addresses!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFUnreferenced::~ELFUnreferenced()
+{
+	for (unsigned long long i = 0; i < this->SectionData.size(); i++)
+		this->image->unpin((const char*)this->SectionData[i]);
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFUnreferenced::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFUnreferenced::setTopCount(unsigned int count)
+{
+	this->topCount = count;
+}
+
+/*   Sets the bit of an address inside the text range, unless it is the
+	start of the function doing the referencing.   */
+void ELFUnreferenced::mark(vector<unsigned long long>& bitmap, unsigned long long address, unsigned long long owner)
+{
+	if (address < this->textStart || address >= this->textEnd || address == owner)
+		return;
+
+	unsigned long long bit = address - this->textStart;
+	bitmap[bit >> 6] |= 1ULL << (bit & 63);
+}
+bool ELFUnreferenced::IsMarked(const vector<unsigned long long>& bitmap, unsigned long long address)
+{
+	if (address < this->textStart || address >= this->textEnd)
+		return false;
+
+	unsigned long long bit = address - this->textStart;
+	return (bitmap[bit >> 6] & (1ULL << (bit & 63))) != 0;
+}
+
+/*   Arrays the loader calls through.   */
+bool ELFUnreferenced::IsInitArray(int index)
+{
+	unsigned int type = this->image->SectionHeaders[index].sh_type;
+	return type == SHT_INIT_ARRAY || type == SHT_FINI_ARRAY || type == SHT_PREINIT_ARRAY;
+}
+
+/*   Collects the sized functions of the executable sections and the
+	address range the target bitmaps cover.   */
+void ELFUnreferenced::collectFunctions()
+{
+	this->SectionData.assign(this->image->SectionHeaders.size(), NULL);
+	this->wordSize = this->image->is64() ? 8 : 4;
+
+	this->textStart = ~0ULL;
+	this->textEnd = 0;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) != 0 && (section.sh_flags & SHF_EXECINSTR) != 0 &&
+			section.sh_type != SHT_NOBITS && section.sh_size > 0)
+		{
+			this->textStart = min(this->textStart, (unsigned long long)section.sh_addr);
+			this->textEnd = max(this->textEnd, (unsigned long long)(section.sh_addr + section.sh_size));
+		}
+
+		// i386 PIC code addresses functions as @GOTOFF from the GOT.
+		string name = this->image->GetSectionName(i);
+		if (name == ".got.plt" || (name == ".got" && this->gotAddress == 0))
+			this->gotAddress = section.sh_addr;
+	}
+	if (this->textEnd == 0)
+		return;
+
+	// Sorted by address across sections.
+	this->image->readFunctionSymbols(this->Functions);
+	sort(this->Functions.begin(), this->Functions.end(), [](const UNREFERENCED_FUNCTION& a, const UNREFERENCED_FUNCTION& b)
+	{
+		return a.address < b.address;
+	});
+}
+
+/*   Splits the work into functions, the code between them and chunks of
+	the data sections that may hold pointers, pinning every section here
+	since the workers only read them.   */
+void ELFUnreferenced::collectUnits()
+{
+	const unsigned long long chunk = 1 << 20;
+	SCAN_UNIT unit;
+
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0 || section.sh_type == SHT_NOBITS || section.sh_size == 0)
+			continue;
+
+		bool code = (section.sh_flags & SHF_EXECINSTR) != 0;
+		if (code == false)
+		{
+			// Symbol, hash, version and relocation tables hold no pointers to
+			// follow, and unwind tables refer to every function.
+			string name = this->image->GetSectionName(i);
+			if ((section.sh_type != SHT_PROGBITS && section.sh_type != SHT_DYNAMIC && IsInitArray(i) == false) ||
+				name.compare(0, 9, ".eh_frame") == 0 || name.compare(0, 17, ".gcc_except_table") == 0)
+				continue;
+		}
+
+		this->SectionData[i] = (const unsigned char*)this->image->pinSection(i);
+		if (this->SectionData[i] == NULL)
+			continue;
+
+		unit.section = i;
+		unit.code = code;
+		unit.owner = ~0ULL;
+
+		// Code outside the function symbols (PLT, _start, stripped text) is
+		// swept as well, it may be the only caller of a local function.
+		unsigned long long cursor = 0;
+		vector<pair<unsigned long long, unsigned long long> > ranges;
+		if (code == true)
+		{
+			for (unsigned long long j = 0; j < this->Functions.size(); j++)
+			{
+				UNREFERENCED_FUNCTION& function = this->Functions[j];
+				if (function.section != (int)i)
+					continue;
+
+				if (function.offset > cursor)
+					ranges.push_back(make_pair(cursor, function.offset - cursor));
+				unit.offset = function.offset;
+				unit.size = function.size;
+				unit.owner = function.address;
+				this->Units.push_back(unit);
+				cursor = max(cursor, function.offset + function.size);
+			}
+			unit.owner = ~0ULL;
+		}
+		if (cursor < section.sh_size)
+			ranges.push_back(make_pair(cursor, section.sh_size - cursor));
+
+		for (unsigned long long j = 0; j < ranges.size(); j++)
+		{
+			for (unsigned long long offset = 0; offset < ranges[j].second; offset += chunk)
+			{
+				unit.offset = ranges[j].first + offset;
+				unit.size = min(chunk, ranges[j].second - offset);
+				this->Units.push_back(unit);
+			}
+		}
+	}
+}
+
+/*   Linear sweep marking branch targets, RIP relative addresses,
+	absolute displacements and immediates that land in the text.   */
+void ELFUnreferenced::scanCode(const SCAN_UNIT& unit, vector<unsigned long long>& bitmap)
+{
+	const unsigned char* code = this->SectionData[unit.section] + unit.offset;
+	unsigned long long address = this->image->SectionHeaders[unit.section].sh_addr + unit.offset;
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+
+	unsigned long long offset = 0;
+	while (offset < unit.size)
+	{
+		X86Decoder::X86_INSTRUCTION instruction;
+		if (X86Decoder::Decode(code + offset, unit.size - offset, is64, instruction) == false)
+		{
+			offset++;
+			continue;
+		}
+
+		const unsigned char* bytes = code + offset;
+		unsigned long long next = address + offset + instruction.length;
+		if (instruction.relativeBranch == true)
+			mark(bitmap, next + X86Decoder::GetBranchDisplacement(bytes, instruction), unit.owner);
+		else
+		{
+			if (instruction.dispSize == 4)
+			{
+				int displacement;
+				memcpy(&displacement, bytes + instruction.dispOffset, 4);
+				if (instruction.ripRelative == true)
+					mark(bitmap, next + displacement, unit.owner);
+				else
+				{
+					mark(bitmap, (unsigned int)displacement, unit.owner);
+					if (is64 == false && this->gotAddress != 0)
+						mark(bitmap, (unsigned int)(this->gotAddress + displacement), unit.owner);
+				}
+			}
+
+			if (instruction.immSize == 4)
+			{
+				unsigned int immediate;
+				memcpy(&immediate, bytes + instruction.immOffset, 4);
+				mark(bitmap, immediate, unit.owner);
+			}
+			else if (instruction.immSize == 8)
+			{
+				unsigned long long immediate;
+				memcpy(&immediate, bytes + instruction.immOffset, 8);
+				mark(bitmap, immediate, unit.owner);
+			}
+		}
+		offset += instruction.length;
+	}
+}
+
+/*   Marks every aligned pointer sized word that lands in the text. Non PIE
+	tables and RELR places already hold the final address.   */
+void ELFUnreferenced::scanData(const SCAN_UNIT& unit, vector<unsigned long long>& bitmap)
+{
+	const unsigned char* data = this->SectionData[unit.section];
+	unsigned long long address = this->image->SectionHeaders[unit.section].sh_addr;
+
+	unsigned long long offset = unit.offset;
+	if ((address + offset) % this->wordSize != 0)
+		offset += this->wordSize - (address + offset) % this->wordSize;
+
+	for (; offset + this->wordSize <= unit.offset + unit.size; offset += this->wordSize)
+	{
+		unsigned long long value = 0;
+		memcpy(&value, data + offset, this->wordSize);
+		mark(bitmap, value, ~0ULL);
+	}
+}
+
+/*   Marks the functions dynamic and emitted relocations point at: the
+	addend of relative and IRELATIVE ones, the symbol of the others. Places
+	inside an init or fini array also make their target a root. Returns the
+	number of relocations read.   */
+unsigned long long ELFUnreferenced::markRelocations(vector<unsigned long long>& bitmap)
+{
+	vector<int> arrays;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		if (IsInitArray(i) == true)
+			arrays.push_back(i);
+	}
+
+	unsigned long long count = 0;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if (section.sh_type != SHT_REL && section.sh_type != SHT_RELA)
+			continue;
+
+		vector<Elf64_Rela> relocations;
+		if (this->image->readRelocations(i, relocations) == false)
+			continue;
+
+		vector<Elf64_Sym> symbols;
+		unsigned int table = section.sh_link;
+		if (table > 0 && table < this->image->SectionHeaders.size())
+			this->image->readSymbols(table, symbols);
+
+		for (unsigned long long j = 0; j < relocations.size(); j++)
+		{
+			Elf64_Rela& relocation = relocations[j];
+			unsigned long long index = ELF64_R_SYM(relocation.r_info);
+			unsigned long long target = relocation.r_addend;
+			if (index != 0)
+			{
+				if (index >= symbols.size() || symbols[index].st_shndx == SHN_UNDEF)
+					continue;
+				target += symbols[index].st_value;
+			}
+			mark(bitmap, target, ~0ULL);
+
+			for (unsigned long long k = 0; k < arrays.size(); k++)
+			{
+				Elf64_Shdr& array = this->image->SectionHeaders[arrays[k]];
+				if (relocation.r_offset >= array.sh_addr &&
+					relocation.r_offset - array.sh_addr < array.sh_size)
+					this->Roots.push_back(target);
+			}
+		}
+		count += relocations.size();
+	}
+	return count;
+}
+
+/*   Addresses of the functions the dynamic symbol table exports.   */
+void ELFUnreferenced::collectExports(vector<unsigned long long>& exports)
+{
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		if (this->image->SectionHeaders[i].sh_type != SHT_DYNSYM)
+			continue;
+
+		vector<Elf64_Sym> symbols;
+		this->image->readSymbols(i, symbols);
+		for (unsigned long long j = 0; j < symbols.size(); j++)
+		{
+			Elf64_Sym& symbol = symbols[j];
+			unsigned char visibility = ELF64_ST_VISIBILITY(symbol.st_other);
+			if (symbol.st_shndx != SHN_UNDEF && ELF64_ST_BIND(symbol.st_info) != STB_LOCAL &&
+				(visibility == STV_DEFAULT || visibility == STV_PROTECTED))
+				exports.push_back(symbol.st_value);
+		}
+	}
+	sort(exports.begin(), exports.end());
+}
+
+/*   Scans code and data on the pool, each worker marking a bitmap of its
+	own over the text range with one bit per byte, ORs the bitmaps together
+	and lists the functions whose start no reference reached.   */
+void ELFUnreferenced::readUnreferenced()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	collectFunctions();
+	if (this->textEnd == 0)
+	{
+		printf("ELFUnreferenced: No executable code found!\n\n");
+		return;
+	}
+	if (this->Functions.empty())
+	{
+		printf("ELFUnreferenced: No function symbols to check!\n\n");
+		return;
+	}
+	collectUnits();
+
+	unsigned long long words = (this->textEnd - this->textStart + 63) / 64;
+	ThreadPool pool;
+	vector<vector<unsigned long long> > bitmaps(pool.getThreadCount());
+	pool.parallelFor(this->Units.size(), [&](unsigned long long index, unsigned int worker)
+	{
+		// Allocated on first use, workers without a task cost nothing.
+		if (bitmaps[worker].empty())
+			bitmaps[worker].assign(words, 0);
+
+		if (this->Units[index].code == true)
+			scanCode(this->Units[index], bitmaps[worker]);
+		else
+			scanData(this->Units[index], bitmaps[worker]);
+	});
+
+	const unsigned long long block = 1 << 16;
+	vector<unsigned long long> targets(words, 0);
+	pool.parallelFor((words + block - 1) / block, [&](unsigned long long index, unsigned int)
+	{
+		unsigned long long end = min(words, (index + 1) * block);
+		for (unsigned long long i = 0; i < bitmaps.size(); i++)
+		{
+			if (bitmaps[i].empty())
+				continue;
+			for (unsigned long long j = index * block; j < end; j++)
+				targets[j] |= bitmaps[i][j];
+		}
+	});
+	bitmaps.clear();
+
+	unsigned long long relocations = markRelocations(targets);
+
+	// The loader calls the entry point and the init and fini arrays.
+	this->Roots.push_back(this->image->getEntry());
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		const unsigned char* data = this->SectionData[i];
+		if (IsInitArray(i) == false || data == NULL)
+			continue;
+
+		for (unsigned long long offset = 0; offset + this->wordSize <= this->image->SectionHeaders[i].sh_size;
+			offset += this->wordSize)
+		{
+			unsigned long long value = 0;
+			memcpy(&value, data + offset, this->wordSize);
+			this->Roots.push_back(value);
+		}
+	}
+	sort(this->Roots.begin(), this->Roots.end());
+
+	vector<unsigned long long> exports;
+	collectExports(exports);
+
+	unsigned long long exported = 0, roots = 0, referenced = 0, deadBytes = 0, textBytes = 0;
+	vector<UNREFERENCED_FUNCTION*> unreferenced;
+	for (unsigned long long i = 0; i < this->Functions.size(); i++)
+	{
+		UNREFERENCED_FUNCTION& function = this->Functions[i];
+		textBytes += function.size;
+		if (binary_search(exports.begin(), exports.end(), function.address))
+			exported++;
+		else if (binary_search(this->Roots.begin(), this->Roots.end(), function.address))
+			roots++;
+		else if (IsMarked(targets, function.address))
+			referenced++;
+		else
+		{
+			unreferenced.push_back(&function);
+			deadBytes += function.size;
+		}
+	}
+
+	printf("Reference scan:\n");
+	printf("  Text range:\t\t0x%llx-0x%llx (%llu bytes)\n", this->textStart, this->textEnd,
+		this->textEnd - this->textStart);
+	printf("  Units scanned:\t%zu on %u workers\n", this->Units.size(), pool.getThreadCount());
+	printf("  Relocations read:\t%llu\n\n", relocations);
+
+	printf("Functions:\n");
+	printf("  Total:\t\t%zu\n", this->Functions.size());
+	printf("  Exported:\t\t%llu\n", exported);
+	printf("  Entry and init/fini:\t%llu\n", roots);
+	printf("  Referenced:\t\t%llu\n", referenced);
+	printf("  Unreferenced:\t\t%zu (%llu bytes, %.1f%% of function bytes)\n\n", unreferenced.size(), deadBytes,
+		textBytes ? 100.0 * deadBytes / textBytes : 0.0);
+
+	if (unreferenced.empty())
+		return;
+
+	sort(unreferenced.begin(), unreferenced.end(), [](const UNREFERENCED_FUNCTION* a, const UNREFERENCED_FUNCTION* b)
+	{
+		return (a->size != b->size) ? a->size > b->size : a->address < b->address;
+	});
+
+	printf("Unreferenced functions (largest first):\n");
+	printf("  Address\t\t\tSize\t\tFunction\n");
+	for (unsigned long long i = 0; i < unreferenced.size() && i < this->topCount; i++)
+		printf("  0x%016llx\t%8llu\t%s\n", unreferenced[i]->address, unreferenced[i]->size,
+			unreferenced[i]->name.c_str());
+	printf("  Targets computed at run time (dlsym, offset tables) are not seen\n\n");
+}
@@ -0,0 +1,969 @@
+#include "stdafx.h"
+
+#ifndef ELFUnwind_H
+#define ELFUnwind_H
+class ELFUnwind
+{
+public:
+	explicit ELFUnwind(string);
+	~ELFUnwind();
+	bool IsReady();
+
+	/*   Function extents from the FDE ranges, for files without .symtab   */
+	bool readFunctionRanges(vector<pair<unsigned long long, unsigned long long> >&);
+	bool GetFunctionRange(unsigned long long, unsigned long long&, unsigned long long&);
+
+	/*   Print the CIEs, FDE statistics and the .eh_frame_hdr table   */
+	void readUnwind();
+	/*   Print the function boundaries the FDEs describe   */
+	void readFunctions();
+	/*   Print the FDE covering an address and its CFA program   */
+	void readLookup(unsigned long long);
+private:
+	/*   DW_EH_PE pointer encodings: format in the low nibble, application above.   */
+	enum PointerEncoding {
+		DW_EH_PE_absptr = 0x00, DW_EH_PE_uleb128 = 0x01, DW_EH_PE_udata2 = 0x02, DW_EH_PE_udata4 = 0x03,
+		DW_EH_PE_udata8 = 0x04, DW_EH_PE_sleb128 = 0x09, DW_EH_PE_sdata2 = 0x0A, DW_EH_PE_sdata4 = 0x0B,
+		DW_EH_PE_sdata8 = 0x0C, DW_EH_PE_pcrel = 0x10, DW_EH_PE_textrel = 0x20, DW_EH_PE_datarel = 0x30,
+		DW_EH_PE_funcrel = 0x40, DW_EH_PE_aligned = 0x50, DW_EH_PE_indirect = 0x80, DW_EH_PE_omit = 0xFF
+	};
+
+	/*   Call frame instructions, the first three carry an operand in the low 6 bits.   */
+	enum CallFrameOpcode {
+		DW_CFA_advance_loc = 0x40, DW_CFA_offset = 0x80, DW_CFA_restore = 0xC0,
+		DW_CFA_nop = 0x00, DW_CFA_set_loc = 0x01, DW_CFA_advance_loc1 = 0x02, DW_CFA_advance_loc2 = 0x03,
+		DW_CFA_advance_loc4 = 0x04, DW_CFA_offset_extended = 0x05, DW_CFA_restore_extended = 0x06,
+		DW_CFA_undefined = 0x07, DW_CFA_same_value = 0x08, DW_CFA_register = 0x09, DW_CFA_remember_state = 0x0A,
+		DW_CFA_restore_state = 0x0B, DW_CFA_def_cfa = 0x0C, DW_CFA_def_cfa_register = 0x0D,
+		DW_CFA_def_cfa_offset = 0x0E, DW_CFA_def_cfa_expression = 0x0F, DW_CFA_expression = 0x10,
+		DW_CFA_offset_extended_sf = 0x11, DW_CFA_def_cfa_sf = 0x12, DW_CFA_def_cfa_offset_sf = 0x13,
+		DW_CFA_val_offset = 0x14, DW_CFA_val_offset_sf = 0x15, DW_CFA_val_expression = 0x16,
+		DW_CFA_GNU_window_save = 0x2D, DW_CFA_GNU_args_size = 0x2E, DW_CFA_GNU_negative_offset_extended = 0x2F
+	};
+
+	/*   Common Information Entry.   */
+	typedef struct UnwindCIE {
+		unsigned long long offset;		// Within .eh_frame.
+		unsigned int version;
+		string augmentation;
+		unsigned long long codeAlignment;
+		long long dataAlignment;
+		unsigned long long returnRegister;
+		unsigned char pointerEncoding;		// 'R', of the FDE pc range.
+		unsigned char lsdaEncoding;		// 'L'
+		unsigned char personalityEncoding;	// 'P'
+		unsigned long long personality;
+		bool signalFrame;			// 'S'
+		unsigned long long instructions;	// Offset and size of the initial CFA program.
+		unsigned long long instructionsSize;
+	} UNWIND_CIE;
+
+	/*   Frame Description Entry.   */
+	typedef struct UnwindFDE {
+		unsigned long long offset;		// Within .eh_frame.
+		unsigned long long cieOffset;
+		unsigned long long pcBegin;
+		unsigned long long pcRange;
+		unsigned long long lsda;		// 0 without one.
+		unsigned long long instructions;
+		unsigned long long instructionsSize;
+	} UNWIND_FDE;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	bool InvalidELFFormat = false;
+
+	// .eh_frame, by section or through .eh_frame_hdr when sections are gone.
+	const unsigned char* frame = NULL;
+	unsigned long long frameAddress = 0;
+	unsigned long long frameSize = 0;
+
+	// .eh_frame_hdr and its sorted search table.
+	const unsigned char* header = NULL;
+	unsigned long long headerAddress = 0;
+	unsigned long long headerSize = 0;
+	unsigned char tableEncoding = DW_EH_PE_omit;
+	unsigned long long tableCount = 0;
+	const unsigned char* table = NULL;
+	unsigned int tableEntrySize = 0;	// 0 when not searchable.
+
+	bool located = false;
+	bool parsed = false;
+	vector<UNWIND_CIE> CIEs;
+	vector<UNWIND_FDE> FDEs;		// In .eh_frame order.
+	vector<pair<unsigned long long, unsigned long long> > Index;	// Built fallback, pc to FDE offset.
+
+	bool locateTables();
+	void parseHeader();
+	bool parseFrame();
+	int parseEntry(unsigned long long, unsigned long long&, UNWIND_CIE&, UNWIND_FDE&);
+	bool parseCIE(unsigned long long, UNWIND_CIE&);
+	bool FindFDE(unsigned long long, UNWIND_FDE&, bool&);
+	void printInstructions(const UNWIND_CIE&, unsigned long long, unsigned long long, unsigned long long);
+	string GetRegisterName(unsigned long long);
+
+	static bool ReadULEB128(const unsigned char*&, const unsigned char*, unsigned long long&);
+	static bool ReadSLEB128(const unsigned char*&, const unsigned char*, long long&);
+	bool ReadEncoded(const unsigned char*&, const unsigned char*, unsigned char, unsigned long long,
+		unsigned long long&);
+	unsigned int GetEncodedSize(unsigned char);
+	static string GetEncodingName(unsigned char);
+};
+#endif // !~ ELFUnwind_H
+
+/*   Constructor with string of filename.   */
+ELFUnwind::ELFUnwind(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFUnwind: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short type = this->image->getType();
+	if (type != ET_EXEC && type != ET_DYN)
+	{
+		printf("ELFUnwind: Only linked executables and shared objects have final addresses!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFUnwind::~ELFUnwind()
+{
+	this->image->unpin((const char*)this->header);
+	this->image->unpin((const char*)this->frame);
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFUnwind::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   LEB128 numbers, false when they run past the end.   */
+bool ELFUnwind::ReadULEB128(const unsigned char*& data, const unsigned char* end, unsigned long long& value)
+{
+	value = 0;
+	for (unsigned int shift = 0; data < end; shift += 7)
+	{
+		unsigned char byte = *data++;
+		if (shift < 64)
+			value |= (unsigned long long)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+bool ELFUnwind::ReadSLEB128(const unsigned char*& data, const unsigned char* end, long long& value)
+{
+	unsigned long long result = 0;
+	for (unsigned int shift = 0; data < end; shift += 7)
+	{
+		unsigned char byte = *data++;
+		if (shift < 64)
+			result |= (unsigned long long)(byte & 0x7F) << shift;
+		if ((byte & 0x80) == 0)
+		{
+			if (shift + 7 < 64 && (byte & 0x40) != 0)
+				result |= ~0ULL << (shift + 7);
+			value = (long long)result;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*   Size of a fixed size DW_EH_PE format, 0 for LEB128 and omit.   */
+unsigned int ELFUnwind::GetEncodedSize(unsigned char encoding)
+{
+	switch (encoding & 0x0F)
+	{
+		case DW_EH_PE_absptr:
+			return this->image->is64() ? 8 : 4;
+		case DW_EH_PE_udata2: case DW_EH_PE_sdata2:
+			return 2;
+		case DW_EH_PE_udata4: case DW_EH_PE_sdata4:
+			return 4;
+		case DW_EH_PE_udata8: case DW_EH_PE_sdata8:
+			return 8;
+	}
+	return 0;
+}
+
+/*   Reads a DW_EH_PE encoded pointer whose field lives at address. pcrel
+	is relative to the field, datarel to .eh_frame_hdr; an indirect value
+	is left as the address of the pointer.   */
+bool ELFUnwind::ReadEncoded(const unsigned char*& data, const unsigned char* end, unsigned char encoding,
+	unsigned long long address, unsigned long long& value)
+{
+	value = 0;
+	if (encoding == DW_EH_PE_omit)
+		return true;
+
+	unsigned char format = encoding & 0x0F;
+	if (format == DW_EH_PE_uleb128)
+	{
+		if (ReadULEB128(data, end, value) == false)
+			return false;
+	}
+	else if (format == DW_EH_PE_sleb128)
+	{
+		long long signedValue;
+		if (ReadSLEB128(data, end, signedValue) == false)
+			return false;
+		value = signedValue;
+	}
+	else
+	{
+		unsigned int size = GetEncodedSize(encoding);
+		if (size == 0 || data + size > end)
+			return false;
+
+		unsigned long long raw = 0;
+		memcpy(&raw, data, size);
+		data += size;
+		// Sign extend the signed formats, and a 4 byte absptr stays unsigned.
+		if (format == DW_EH_PE_sdata2)
+			raw = (long long)(short)raw;
+		else if (format == DW_EH_PE_sdata4)
+			raw = (long long)(int)raw;
+		value = raw;
+	}
+
+	switch (encoding & 0x70)
+	{
+		case DW_EH_PE_pcrel:
+			value += address;
+			break;
+		case DW_EH_PE_datarel:
+			value += this->headerAddress;
+			break;
+	}
+	if (this->image->is64() == false)
+		value &= 0xFFFFFFFFULL;
+	return true;
+}
+
+/*   Readable DW_EH_PE encoding, like "pcrel sdata4".   */
+string ELFUnwind::GetEncodingName(unsigned char encoding)
+{
+	if (encoding == DW_EH_PE_omit)
+		return "omit";
+
+	static const char* formats[16] = { "absptr", "uleb128", "udata2", "udata4", "udata8", "?", "?", "?",
+		"?", "sleb128", "sdata2", "sdata4", "sdata8", "?", "?", "?" };
+	static const char* applications[8] = { "", "pcrel ", "textrel ", "datarel ", "funcrel ", "aligned ", "? ", "? " };
+
+	string name = (encoding & DW_EH_PE_indirect) ? "indirect " : "";
+	return name + applications[(encoding >> 4) & 7] + formats[encoding & 0x0F];
+}
+
+/*   Finds .eh_frame_hdr and .eh_frame by section name, or through
+	PT_GNU_EH_FRAME and the header's eh_frame_ptr when the section headers
+	are stripped. Both stay pinned until the class is destroyed.   */
+bool ELFUnwind::locateTables()
+{
+	if (this->located == true)
+		return this->frame != NULL;
+	this->located = true;
+
+	int index = this->image->GetIndexOfSection(".eh_frame_hdr");
+	if (index >= 0 && this->image->SectionHeaders[index].sh_type != SHT_NOBITS)
+	{
+		this->header = (const unsigned char*)this->image->pinSection(index);
+		this->headerAddress = this->image->SectionHeaders[index].sh_addr;
+		this->headerSize = this->image->SectionHeaders[index].sh_size;
+	}
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size() && this->header == NULL; i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		if (segment.p_type == PT_GNU_EH_FRAME && segment.p_filesz > 0)
+		{
+			this->header = (const unsigned char*)this->image->mapPinned(segment.p_offset, segment.p_filesz);
+			this->headerAddress = segment.p_vaddr;
+			this->headerSize = segment.p_filesz;
+		}
+	}
+	if (this->header != NULL)
+		parseHeader();
+
+	index = this->image->GetIndexOfSection(".eh_frame");
+	if (index >= 0 && this->image->SectionHeaders[index].sh_type != SHT_NOBITS)
+	{
+		this->frame = (const unsigned char*)this->image->pinSection(index);
+		this->frameAddress = this->image->SectionHeaders[index].sh_addr;
+		this->frameSize = this->image->SectionHeaders[index].sh_size;
+		return this->frame != NULL;
+	}
+	if (this->header == NULL || this->frameAddress == 0)
+		return false;
+
+	// Without a size, read to the end of the segment; the zero terminator
+	// stops the parse.
+	for (unsigned long long i = 0; i < this->image->ProgramHeaders.size(); i++)
+	{
+		Elf64_Phdr& segment = this->image->ProgramHeaders[i];
+		if (segment.p_type == PT_LOAD && this->frameAddress >= segment.p_vaddr &&
+			this->frameAddress - segment.p_vaddr < segment.p_filesz)
+		{
+			unsigned long long skip = this->frameAddress - segment.p_vaddr;
+			this->frameSize = segment.p_filesz - skip;
+			this->frame = (const unsigned char*)this->image->mapPinned(segment.p_offset + skip, this->frameSize);
+			break;
+		}
+	}
+	return this->frame != NULL;
+}
+
+/*   Reads the .eh_frame_hdr fields. The table is only searched when its
+	entries have a fixed size.   */
+void ELFUnwind::parseHeader()
+{
+	const unsigned char* data = this->header;
+	const unsigned char* end = this->header + this->headerSize;
+	if (this->headerSize < 4 || data[0] != 1)
+		return;
+
+	unsigned char framePointerEncoding = data[1];
+	unsigned char countEncoding = data[2];
+	this->tableEncoding = data[3];
+	data += 4;
+
+	unsigned long long count = 0;
+	if (ReadEncoded(data, end, framePointerEncoding, this->headerAddress + (data - this->header),
+		this->frameAddress) == false ||
+		ReadEncoded(data, end, countEncoding, this->headerAddress + (data - this->header), count) == false)
+		return;
+
+	unsigned int size = GetEncodedSize(this->tableEncoding);
+	if (countEncoding == DW_EH_PE_omit || this->tableEncoding == DW_EH_PE_omit || size == 0 ||
+		(this->tableEncoding & DW_EH_PE_indirect) != 0 || (unsigned long long)(end - data) / (2 * size) < count)
+		return;
+
+	this->table = data;
+	this->tableCount = count;
+	this->tableEntrySize = 2 * size;
+}
+
+/*   Decodes a CIE at an offset of .eh_frame.   */
+bool ELFUnwind::parseCIE(unsigned long long offset, UNWIND_CIE& cie)
+{
+	unsigned long long next;
+	UNWIND_FDE unused;
+	return parseEntry(offset, next, cie, unused) == 1;
+}
+
+/*   Decodes the entry at an offset of .eh_frame and sets the offset of the
+	next one. Returns 1 for a CIE, 2 for an FDE (its CIE in cie), 0 at the
+	terminator and -1 when malformed.   */
+int ELFUnwind::parseEntry(unsigned long long offset, unsigned long long& next, UNWIND_CIE& cie, UNWIND_FDE& fde)
+{
+	if (offset + 4 > this->frameSize)
+		return 0;
+
+	const unsigned char* data = this->frame + offset;
+	unsigned long long length = 0;
+	memcpy(&length, data, 4);
+	data += 4;
+	if (length == 0)
+		return 0;
+
+	bool dwarf64 = (length == 0xFFFFFFFFULL);
+	if (dwarf64 == true)
+	{
+		if (offset + 12 > this->frameSize)
+			return -1;
+		memcpy(&length, data, 8);
+		data += 8;
+	}
+
+	const unsigned char* idField = data;
+	if (length > this->frameSize - (idField - this->frame) || length < (dwarf64 ? 8 : 4))
+		return -1;
+	const unsigned char* end = idField + length;
+	next = end - this->frame;
+
+	unsigned long long id = 0;
+	memcpy(&id, data, dwarf64 ? 8 : 4);
+	data += dwarf64 ? 8 : 4;
+
+	if (id != 0)
+	{
+		// The id of an FDE is the distance back to its CIE.
+		unsigned long long position = idField - this->frame;
+		if (id > position)
+			return -1;
+
+		fde.offset = offset;
+		fde.cieOffset = position - id;
+		if (parseCIE(fde.cieOffset, cie) == false)
+			return -1;
+
+		if (ReadEncoded(data, end, cie.pointerEncoding, this->frameAddress + (data - this->frame), fde.pcBegin) == false ||
+			ReadEncoded(data, end, cie.pointerEncoding & 0x0F, 0, fde.pcRange) == false)
+			return -1;
+
+		fde.lsda = 0;
+		if (cie.augmentation.size() > 0 && cie.augmentation[0] == 'z')
+		{
+			unsigned long long augmentationSize;
+			if (ReadULEB128(data, end, augmentationSize) == false || augmentationSize > (unsigned long long)(end - data))
+				return -1;
+			const unsigned char* augmentationEnd = data + augmentationSize;
+			if (cie.lsdaEncoding != DW_EH_PE_omit)
+				ReadEncoded(data, augmentationEnd, cie.lsdaEncoding, this->frameAddress + (data - this->frame), fde.lsda);
+			data = augmentationEnd;
+		}
+
+		fde.instructions = data - this->frame;
+		fde.instructionsSize = end - data;
+		return 2;
+	}
+
+	cie.offset = offset;
+	cie.version = (data < end) ? *data++ : 0;
+	const unsigned char* terminator = (const unsigned char*)memchr(data, 0, end - data);
+	if (terminator == NULL)
+		return -1;
+	cie.augmentation = string((const char*)data, terminator - data);
+	data = terminator + 1;
+
+	// GCC 2 era "eh" augmentation carries a pointer.
+	if (cie.augmentation.find("eh") != string::npos)
+		data += this->image->is64() ? 8 : 4;
+
+	cie.pointerEncoding = DW_EH_PE_absptr;
+	cie.lsdaEncoding = DW_EH_PE_omit;
+	cie.personalityEncoding = DW_EH_PE_omit;
+	cie.personality = 0;
+	cie.signalFrame = false;
+	if (ReadULEB128(data, end, cie.codeAlignment) == false || ReadSLEB128(data, end, cie.dataAlignment) == false)
+		return -1;
+	if (cie.version == 1)
+		cie.returnRegister = (data < end) ? *data++ : 0;
+	else if (ReadULEB128(data, end, cie.returnRegister) == false)
+		return -1;
+
+	if (cie.augmentation.size() > 0 && cie.augmentation[0] == 'z')
+	{
+		unsigned long long augmentationSize;
+		if (ReadULEB128(data, end, augmentationSize) == false || augmentationSize > (unsigned long long)(end - data))
+			return -1;
+		const unsigned char* augmentationEnd = data + augmentationSize;
+
+		for (unsigned long long i = 1; i < cie.augmentation.size() && data < augmentationEnd; i++)
+		{
+			char letter = cie.augmentation[i];
+			if (letter == 'L')
+				cie.lsdaEncoding = *data++;
+			else if (letter == 'R')
+				cie.pointerEncoding = *data++;
+			else if (letter == 'P')
+			{
+				cie.personalityEncoding = *data++;
+				if (ReadEncoded(data, augmentationEnd, cie.personalityEncoding,
+					this->frameAddress + (data - this->frame), cie.personality) == false)
+					return -1;
+			}
+			else if (letter == 'S')
+				cie.signalFrame = true;
+			// B (AArch64 BTI key) and G (MTE) have no data, the size covers anything else.
+		}
+		data = augmentationEnd;
+	}
+
+	cie.instructions = data - this->frame;
+	cie.instructionsSize = end - data;
+	return 1;
+}
+
+/*   Parses every entry of .eh_frame once and builds the sorted index the
+	lookups fall back on without a usable .eh_frame_hdr.   */
+bool ELFUnwind::parseFrame()
+{
+	if (this->parsed == true)
+		return true;
+	if (locateTables() == false)
+		return false;
+	this->parsed = true;
+
+	UNWIND_CIE cie;
+	UNWIND_FDE fde;
+	unsigned long long offset = 0, next = 0;
+	while (offset < this->frameSize)
+	{
+		int kind = parseEntry(offset, next, cie, fde);
+		if (kind <= 0)
+		{
+			if (kind < 0)
+				printf("ELFUnwind: Malformed entry at .eh_frame+0x%llx!\n", offset);
+			break;
+		}
+
+		if (kind == 1)
+			this->CIEs.push_back(cie);
+		else
+		{
+			this->FDEs.push_back(fde);
+			// Discarded functions keep an FDE starting at 0.
+			if (fde.pcRange > 0 && fde.pcBegin != 0)
+				this->Index.push_back(make_pair(fde.pcBegin, fde.offset));
+		}
+		offset = next;
+	}
+
+	sort(this->Index.begin(), this->Index.end());
+	return true;
+}
+
+/*   FDE covering an address, by binary search of the .eh_frame_hdr table
+	when it is usable, of the index built from .eh_frame otherwise.   */
+bool ELFUnwind::FindFDE(unsigned long long address, UNWIND_FDE& fde, bool& usedHeader)
+{
+	if (locateTables() == false)
+		return false;
+
+	unsigned long long offset = ~0ULL;
+	usedHeader = (this->tableEntrySize != 0);
+	if (usedHeader == true)
+	{
+		unsigned long long low = 0, high = this->tableCount;
+		while (low < high)
+		{
+			unsigned long long middle = low + (high - low) / 2;
+			const unsigned char* entry = this->table + middle * this->tableEntrySize;
+			unsigned long long location;
+			ReadEncoded(entry, entry + this->tableEntrySize, this->tableEncoding,
+				this->headerAddress + (entry - this->header), location);
+			if (location <= address)
+				low = middle + 1;
+			else
+				high = middle;
+		}
+		if (low == 0)
+			return false;
+
+		const unsigned char* entry = this->table + (low - 1) * this->tableEntrySize + this->tableEntrySize / 2;
+		unsigned long long fdeAddress;
+		ReadEncoded(entry, entry + this->tableEntrySize / 2, this->tableEncoding,
+			this->headerAddress + (entry - this->header), fdeAddress);
+		offset = fdeAddress - this->frameAddress;
+	}
+	else
+	{
+		parseFrame();
+		auto found = upper_bound(this->Index.begin(), this->Index.end(), make_pair(address, ~0ULL));
+		if (found == this->Index.begin())
+			return false;
+		offset = (found - 1)->second;
+	}
+
+	UNWIND_CIE cie;
+	unsigned long long next;
+	if (offset >= this->frameSize || parseEntry(offset, next, cie, fde) != 2)
+		return false;
+	return address >= fde.pcBegin && address - fde.pcBegin < fde.pcRange;
+}
+
+/*   Sorted, non empty FDE ranges as start and size.   */
+bool ELFUnwind::readFunctionRanges(vector<pair<unsigned long long, unsigned long long> >& ranges)
+{
+	ranges.clear();
+	if (IsReady() == false || parseFrame() == false)
+		return false;
+
+	for (unsigned long long i = 0; i < this->FDEs.size(); i++)
+	{
+		if (this->FDEs[i].pcRange > 0 && this->FDEs[i].pcBegin != 0)
+			ranges.push_back(make_pair(this->FDEs[i].pcBegin, this->FDEs[i].pcRange));
+	}
+	sort(ranges.begin(), ranges.end());
+	ranges.erase(unique(ranges.begin(), ranges.end()), ranges.end());
+	return true;
+}
+
+/*   Start and size of the function an address lies in, per its FDE.   */
+bool ELFUnwind::GetFunctionRange(unsigned long long address, unsigned long long& start, unsigned long long& size)
+{
+	UNWIND_FDE fde;
+	bool usedHeader;
+	if (IsReady() == false || FindFDE(address, fde, usedHeader) == false)
+		return false;
+
+	start = fde.pcBegin;
+	size = fde.pcRange;
+	return true;
+}
+
+/*   DWARF register names of x86, numbers elsewhere.   */
+string ELFUnwind::GetRegisterName(unsigned long long reg)
+{
+	static const char* x64[] = { "rax", "rdx", "rcx", "rbx", "rsi", "rdi", "rbp", "rsp", "r8", "r9", "r10",
+		"r11", "r12", "r13", "r14", "r15", "rip" };
+	static const char* x86[] = { "eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi", "eip" };
+
+	unsigned short machine = this->image->getMachine();
+	if (machine == EM_X86_64 && reg < 17)
+		return x64[reg];
+	if (machine == EM_386 && reg < 9)
+		return x86[reg];
+	return "r" + to_string(reg);
+}
+
+/*   Prints a CFA program, tracking the location the rows apply from.   */
+void ELFUnwind::printInstructions(const UNWIND_CIE& cie, unsigned long long offset, unsigned long long size,
+	unsigned long long location)
+{
+	const unsigned char* data = this->frame + offset;
+	const unsigned char* end = data + size;
+	while (data < end)
+	{
+		unsigned char opcode = *data++;
+		unsigned char high = opcode & 0xC0;
+		unsigned char low = opcode & 0x3F;
+		unsigned long long reg = 0, value = 0, delta = 0;
+		long long signedValue = 0;
+
+		if (high == DW_CFA_advance_loc)
+		{
+			location += low * cie.codeAlignment;
+			printf("    DW_CFA_advance_loc: %llu to 0x%llx\n", low * cie.codeAlignment, location);
+			continue;
+		}
+		if (high == DW_CFA_offset)
+		{
+			if (ReadULEB128(data, end, value) == false)
+				break;
+			printf("    DW_CFA_offset: %s at cfa%+lld\n", GetRegisterName(low).c_str(), (long long)value * cie.dataAlignment);
+			continue;
+		}
+		if (high == DW_CFA_restore)
+		{
+			printf("    DW_CFA_restore: %s\n", GetRegisterName(low).c_str());
+			continue;
+		}
+
+		bool valid = true;
+		switch (opcode)
+		{
+			case DW_CFA_nop:
+				// Padding to the entry size, not worth a line each.
+				break;
+			case DW_CFA_set_loc:
+				valid = ReadEncoded(data, end, cie.pointerEncoding, this->frameAddress + (data - this->frame), location);
+				printf("    DW_CFA_set_loc: 0x%llx\n", location);
+				break;
+			case DW_CFA_advance_loc1: case DW_CFA_advance_loc2: case DW_CFA_advance_loc4:
+			{
+				unsigned int width = (opcode == DW_CFA_advance_loc1) ? 1 : (opcode == DW_CFA_advance_loc2) ? 2 : 4;
+				if (data + width > end)
+				{
+					valid = false;
+					break;
+				}
+				memcpy(&delta, data, width);
+				data += width;
+				location += delta * cie.codeAlignment;
+				printf("    DW_CFA_advance_loc%u: %llu to 0x%llx\n", width, delta * cie.codeAlignment, location);
+				break;
+			}
+			case DW_CFA_offset_extended:
+				valid = ReadULEB128(data, end, reg) && ReadULEB128(data, end, value);
+				printf("    DW_CFA_offset_extended: %s at cfa%+lld\n", GetRegisterName(reg).c_str(),
+					(long long)value * cie.dataAlignment);
+				break;
+			case DW_CFA_offset_extended_sf:
+				valid = ReadULEB128(data, end, reg) && ReadSLEB128(data, end, signedValue);
+				printf("    DW_CFA_offset_extended_sf: %s at cfa%+lld\n", GetRegisterName(reg).c_str(),
+					signedValue * cie.dataAlignment);
+				break;
+			case DW_CFA_restore_extended: case DW_CFA_undefined: case DW_CFA_same_value: case DW_CFA_def_cfa_register:
+			{
+				const char* name = (opcode == DW_CFA_restore_extended) ? "restore_extended" :
+					(opcode == DW_CFA_undefined) ? "undefined" : (opcode == DW_CFA_same_value) ? "same_value" :
+					"def_cfa_register";
+				valid = ReadULEB128(data, end, reg);
+				printf("    DW_CFA_%s: %s\n", name, GetRegisterName(reg).c_str());
+				break;
+			}
+			case DW_CFA_register:
+				valid = ReadULEB128(data, end, reg) && ReadULEB128(data, end, value);
+				printf("    DW_CFA_register: %s in %s\n", GetRegisterName(reg).c_str(), GetRegisterName(value).c_str());
+				break;
+			case DW_CFA_remember_state:
+				printf("    DW_CFA_remember_state\n");
+				break;
+			case DW_CFA_restore_state:
+				printf("    DW_CFA_restore_state\n");
+				break;
+			case DW_CFA_def_cfa:
+				valid = ReadULEB128(data, end, reg) && ReadULEB128(data, end, value);
+				printf("    DW_CFA_def_cfa: %s ofs %llu\n", GetRegisterName(reg).c_str(), value);
+				break;
+			case DW_CFA_def_cfa_sf:
+				valid = ReadULEB128(data, end, reg) && ReadSLEB128(data, end, signedValue);
+				printf("    DW_CFA_def_cfa_sf: %s ofs %lld\n", GetRegisterName(reg).c_str(), signedValue * cie.dataAlignment);
+				break;
+			case DW_CFA_def_cfa_offset:
+				valid = ReadULEB128(data, end, value);
+				printf("    DW_CFA_def_cfa_offset: %llu\n", value);
+				break;
+			case DW_CFA_def_cfa_offset_sf:
+				valid = ReadSLEB128(data, end, signedValue);
+				printf("    DW_CFA_def_cfa_offset_sf: %lld\n", signedValue * cie.dataAlignment);
+				break;
+			case DW_CFA_val_offset:
+				valid = ReadULEB128(data, end, reg) && ReadULEB128(data, end, value);
+				printf("    DW_CFA_val_offset: %s is cfa%+lld\n", GetRegisterName(reg).c_str(),
+					(long long)value * cie.dataAlignment);
+				break;
+			case DW_CFA_val_offset_sf:
+				valid = ReadULEB128(data, end, reg) && ReadSLEB128(data, end, signedValue);
+				printf("    DW_CFA_val_offset_sf: %s is cfa%+lld\n", GetRegisterName(reg).c_str(),
+					signedValue * cie.dataAlignment);
+				break;
+			case DW_CFA_def_cfa_expression:
+				valid = ReadULEB128(data, end, value) && value <= (unsigned long long)(end - data);
+				if (valid == true)
+					data += value;
+				printf("    DW_CFA_def_cfa_expression: %llu bytes\n", value);
+				break;
+			case DW_CFA_expression: case DW_CFA_val_expression:
+				valid = ReadULEB128(data, end, reg) && ReadULEB128(data, end, value) && value <= (unsigned long long)(end - data);
+				if (valid == true)
+					data += value;
+				printf("    DW_CFA_%s: %s, %llu bytes\n", (opcode == DW_CFA_expression) ? "expression" : "val_expression",
+					GetRegisterName(reg).c_str(), value);
+				break;
+			case DW_CFA_GNU_args_size:
+				valid = ReadULEB128(data, end, value);
+				printf("    DW_CFA_GNU_args_size: %llu\n", value);
+				break;
+			case DW_CFA_GNU_negative_offset_extended:
+				valid = ReadULEB128(data, end, reg) && ReadULEB128(data, end, value);
+				printf("    DW_CFA_GNU_negative_offset_extended: %s at cfa%+lld\n", GetRegisterName(reg).c_str(),
+					-(long long)value * cie.dataAlignment);
+				break;
+			case DW_CFA_GNU_window_save:
+				// DW_CFA_AARCH64_negate_ra_state on AArch64.
+				printf("    DW_CFA_%s\n", (this->image->getMachine() == EM_AARCH64) ? "AARCH64_negate_ra_state" :
+					"GNU_window_save");
+				break;
+			default:
+				printf("    DW_CFA_??? (0x%02x)\n", opcode);
+				valid = false;
+				break;
+		}
+		if (valid == false)
+			break;
+	}
+}
+
+/*   Prints every CIE, FDE statistics and the state of the .eh_frame_hdr
+	search table.   */
+void ELFUnwind::readUnwind()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+	if (parseFrame() == false)
+	{
+		printf("ELFUnwind: No .eh_frame found!\n\n");
+		return;
+	}
+
+	printf(".eh_frame:\t\t0x%llx (%llu bytes)\n", this->frameAddress, this->frameSize);
+	if (this->header != NULL)
+	{
+		printf(".eh_frame_hdr:\t\t0x%llx (%llu bytes)\n", this->headerAddress, this->headerSize);
+		if (this->tableEntrySize != 0)
+		{
+			// The loader's binary search relies on it being sorted.
+			bool sorted = true;
+			unsigned long long previous = 0;
+			for (unsigned long long i = 0; i < this->tableCount && sorted == true; i++)
+			{
+				const unsigned char* entry = this->table + i * this->tableEntrySize;
+				unsigned long long location;
+				ReadEncoded(entry, entry + this->tableEntrySize, this->tableEncoding,
+					this->headerAddress + (entry - this->header), location);
+				sorted = (i == 0 || location >= previous);
+				previous = location;
+			}
+			printf("  Search table:\t\t%llu entries, %s, %s\n", this->tableCount,
+				GetEncodingName(this->tableEncoding).c_str(), sorted ? "sorted" : "NOT sorted");
+		}
+		else
+			printf("  Search table:\t\tnone, lookups use an index built from .eh_frame\n");
+	}
+	else
+		printf(".eh_frame_hdr:\t\tnone, lookups use an index built from .eh_frame\n");
+
+	printf("\nCIEs: %zu\n", this->CIEs.size());
+	printf("  Offset\tVersion\tAugmentation\tCode\tData\tRA\tFDE encoding\t\tPersonality\n");
+	for (unsigned long long i = 0; i < this->CIEs.size(); i++)
+	{
+		UNWIND_CIE& cie = this->CIEs[i];
+		char personality[32] = "-";
+		if (cie.personalityEncoding != DW_EH_PE_omit)
+			snprintf(personality, sizeof(personality), "%s0x%llx", (cie.personalityEncoding & DW_EH_PE_indirect) ? "*" : "",
+				cie.personality);
+		printf("  0x%08llx\t%u\t%-12s\t%llu\t%lld\t%s\t%-16s\t%s\n", cie.offset, cie.version,
+			cie.augmentation.empty() ? "-" : cie.augmentation.c_str(), cie.codeAlignment, cie.dataAlignment,
+			GetRegisterName(cie.returnRegister).c_str(), GetEncodingName(cie.pointerEncoding).c_str(), personality);
+	}
+
+	unsigned long long covered = 0, withLsda = 0, empty = 0, instructionBytes = 0;
+	unsigned long long lowest = ~0ULL, highest = 0;
+	for (unsigned long long i = 0; i < this->FDEs.size(); i++)
+	{
+		UNWIND_FDE& fde = this->FDEs[i];
+		instructionBytes += fde.instructionsSize;
+		if (fde.lsda != 0)
+			withLsda++;
+		if (fde.pcRange == 0 || fde.pcBegin == 0)
+		{
+			empty++;
+			continue;
+		}
+		covered += fde.pcRange;
+		lowest = min(lowest, fde.pcBegin);
+		highest = max(highest, fde.pcBegin + fde.pcRange);
+	}
+
+	printf("\nFDEs: %zu\n", this->FDEs.size());
+	if (this->FDEs.empty())
+	{
+		printf("\n");
+		return;
+	}
+	printf("  Code covered:\t\t%llu bytes", covered);
+	if (highest > lowest)
+		printf(" in 0x%llx-0x%llx", lowest, highest);
+	printf("\n  With LSDA:\t\t%llu\n", withLsda);
+	printf("  Empty or discarded:\t%llu\n", empty);
+	printf("  CFA program bytes:\t%llu (%.1f per FDE)\n", instructionBytes, (double)instructionBytes / this->FDEs.size());
+	if (this->tableEntrySize != 0 && this->tableCount != this->Index.size())
+		printf("  Search table holds %llu entries for %zu FDEs with code\n", this->tableCount, this->Index.size());
+	printf("\n");
+}
+
+/*   Prints the function boundaries of the FDE ranges, named by the
+	symbols when there are any, and how they compare with them.   */
+void ELFUnwind::readFunctions()
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	vector<pair<unsigned long long, unsigned long long> > ranges;
+	if (readFunctionRanges(ranges) == false)
+	{
+		printf("ELFUnwind: No .eh_frame found!\n\n");
+		return;
+	}
+
+	// Names of function symbols by address, .symtab first.
+	vector<pair<unsigned long long, string> > names;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		unsigned int type = this->image->SectionHeaders[i].sh_type;
+		if (type != SHT_SYMTAB && type != SHT_DYNSYM)
+			continue;
+
+		vector<Elf64_Sym> symbols;
+		this->image->readSymbols(i, symbols);
+		for (unsigned long long j = 0; j < symbols.size(); j++)
+		{
+			if (ELF64_ST_TYPE(symbols[j].st_info) == STT_FUNC && symbols[j].st_shndx != SHN_UNDEF)
+				names.push_back(make_pair((unsigned long long)symbols[j].st_value,
+					this->image->GetSymbolName(i, symbols[j])));
+		}
+	}
+	stable_sort(names.begin(), names.end(), [](const pair<unsigned long long, string>& a,
+		const pair<unsigned long long, string>& b)
+	{
+		return a.first < b.first;
+	});
+
+	unsigned long long named = 0, bytes = 0;
+	printf("Functions from FDE ranges: %zu\n", ranges.size());
+	printf("  Start\t\t\tEnd\t\t\tSize\t\tName\n");
+	for (unsigned long long i = 0; i < ranges.size(); i++)
+	{
+		unsigned long long start = ranges[i].first, size = ranges[i].second;
+		auto found = lower_bound(names.begin(), names.end(), make_pair(start, string()));
+		string name;
+		if (found != names.end() && found->first == start)
+		{
+			name = found->second;
+			named++;
+		}
+		else
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "fde_%llx", start);
+			name = text;
+		}
+		bytes += size;
+		printf("  0x%016llx\t0x%016llx\t%8llu\t%s\n", start, start + size, size, name.c_str());
+	}
+
+	printf("\n  %llu bytes covered, %llu ranges start at a function symbol", bytes, named);
+	if (names.empty())
+		printf(" (no symbols, names are fde_<start>)");
+	printf("\n\n");
+}
+
+/*   Prints the FDE covering an address with its CIE and the CFA programs.   */
+void ELFUnwind::readLookup(unsigned long long address)
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+	if (locateTables() == false)
+	{
+		printf("ELFUnwind: No .eh_frame found!\n\n");
+		return;
+	}
+
+	UNWIND_FDE fde;
+	bool usedHeader = false;
+	if (FindFDE(address, fde, usedHeader) == false)
+	{
+		printf("ELFUnwind: No FDE covers 0x%llx!\n\n", address);
+		return;
+	}
+
+	UNWIND_CIE cie;
+	parseCIE(fde.cieOffset, cie);
+
+	printf("FDE for 0x%llx, found by %s:\n", address, usedHeader ? ".eh_frame_hdr binary search" :
+		"the index built from .eh_frame");
+	printf("  Offset:\t\t.eh_frame+0x%llx\n", fde.offset);
+	printf("  Range:\t\t0x%llx-0x%llx (%llu bytes)\n", fde.pcBegin, fde.pcBegin + fde.pcRange, fde.pcRange);
+	if (fde.lsda != 0)
+		printf("  LSDA:\t\t\t0x%llx\n", fde.lsda);
+	printf("  CIE:\t\t\t.eh_frame+0x%llx, version %u, augmentation \"%s\"%s\n", cie.offset, cie.version,
+		cie.augmentation.c_str(), cie.signalFrame ? ", signal frame" : "");
+	printf("  Alignment:\t\tcode %llu, data %lld, return address in %s\n\n", cie.codeAlignment, cie.dataAlignment,
+		GetRegisterName(cie.returnRegister).c_str());
+
+	printf("  Initial instructions:\n");
+	printInstructions(cie, cie.instructions, cie.instructionsSize, fde.pcBegin);
+	printf("  Instructions:\n");
+	printInstructions(cie, fde.instructions, fde.instructionsSize, fde.pcBegin);
+	printf("\n");
+}
@@ -0,0 +1,583 @@
+#include "stdafx.h"
+
+#ifndef ELFXref_H
+#define ELFXref_H
+class ELFXref
+{
+public:
+	explicit ELFXref(string);
+	~ELFXref();
+	bool IsReady();
+
+	/*   Options   */
+	void setRebuild(bool);
+
+	/*   Print the instructions and data words referencing an address,
+		a symbol or a string literal   */
+	void readReferences(string);
+private:
+	enum ReferenceKind { CALL, JUMP, RIP_RELATIVE, ABSOLUTE, RELOCATION, DATA_WORD };
+
+	/*   One reference of the index, sorted by target then source.   */
+	typedef struct XrefEntry {
+		unsigned long long target;
+		unsigned long long source;		// Instruction or data word address.
+		unsigned int kind;
+		unsigned int reserved;
+	} XREF_ENTRY;
+
+	/*   Start of the cached index, followed by the entries.   */
+	typedef struct XrefHeader {
+		char magic[8];				// "ELFXREF1"
+		unsigned long long count;
+	} XREF_HEADER;
+
+	/*   Range of a section scanned by one worker.   */
+	typedef struct ScanUnit {
+		int section;
+		unsigned long long offset;
+		unsigned long long size;
+		bool code;				// Decoded, otherwise read as pointers.
+	} SCAN_UNIT;
+
+	/*   Symbol used to name sources and targets.   */
+	typedef struct XrefSymbol {
+		string name;
+		unsigned long long address;
+		unsigned long long size;
+	} XREF_SYMBOL;
+
+	ELFMapping* mapping = NULL;
+	ELFImage* image = NULL;
+	ELFCache* cache = NULL;
+	bool InvalidELFFormat = false;
+
+	bool rebuild = false;
+	unsigned long long wordSize = 8;
+	unsigned long long gotAddress = 0;	// i386 @GOTOFF base.
+
+	vector<pair<unsigned long long, unsigned long long> > Ranges;	// Allocated sections.
+	vector<SCAN_UNIT> Units;
+	vector<const unsigned char*> SectionData;
+	vector<XREF_SYMBOL> Symbols;
+
+	// Index in use, either mapped from the cache or built here.
+	const XREF_ENTRY* Entries = NULL;
+	unsigned long long EntryCount = 0;
+	vector<XREF_ENTRY> Built;
+
+	bool IsInImage(unsigned long long);
+	void collectRanges();
+	void collectSymbols();
+	void collectUnits();
+	void scanCode(const SCAN_UNIT&, vector<XREF_ENTRY>&);
+	void scanData(const SCAN_UNIT&, vector<XREF_ENTRY>&);
+	void addRelocations(vector<XREF_ENTRY>&);
+	void add(vector<XREF_ENTRY>&, unsigned long long, unsigned long long, ReferenceKind);
+	bool loadIndex();
+	void buildIndex();
+	bool ResolveQuery(string, vector<pair<unsigned long long, unsigned long long> >&);
+	string Describe(unsigned long long);
+	static const char* GetKindName(unsigned int);
+};
+#endif // !~ ELFXref_H
+
+/*   Constructor with string of filename.   */
+ELFXref::ELFXref(string FileName)
+{
+	this->mapping = new ELFMapping(FileName);
+	this->image = new ELFImage(this->mapping);
+	this->cache = new ELFCache(FileName, "xref");
+	if (this->image->IsReady() == false)
+	{
+		printf("ELFXref: Failed to read ELF headers!\n");
+		this->InvalidELFFormat = true;
+		return;
+	}
+
+	unsigned short type = this->image->getType();
+	if (type != ET_EXEC && type != ET_DYN)
+	{
+		printf("ELFXref: Only linked executables and shared objects have final addresses!\n");
+		this->InvalidELFFormat = true;
+	}
+}
+
+/*   Deconstructor of the class.   */
+ELFXref::~ELFXref()
+{
+	delete this->cache;
+	delete this->image;
+	delete this->mapping;
+}
+
+/*   Checks if the class is ready.   */
+bool ELFXref::IsReady()
+{
+	return this->InvalidELFFormat == false;
+}
+
+/*   Options.   */
+void ELFXref::setRebuild(bool value)
+{
+	this->rebuild = value;
+}
+
+/*   Name of a reference kind.   */
+const char* ELFXref::GetKindName(unsigned int kind)
+{
+	static const char* names[] = { "call", "jump", "rip-relative", "absolute", "relocation", "data word" };
+	return (kind <= DATA_WORD) ? names[kind] : "unknown";
+}
+
+/*   Ranges of the allocated sections, .bss included, so operands that are
+	plain numbers are told apart from addresses.   */
+void ELFXref::collectRanges()
+{
+	this->wordSize = this->image->is64() ? 8 : 4;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) != 0 && section.sh_addr != 0 && section.sh_size > 0)
+			this->Ranges.push_back(make_pair((unsigned long long)section.sh_addr,
+				(unsigned long long)(section.sh_addr + section.sh_size)));
+
+		// i386 PIC code addresses data as @GOTOFF from the GOT.
+		string name = this->image->GetSectionName(i);
+		if (name == ".got.plt" || (name == ".got" && this->gotAddress == 0))
+			this->gotAddress = section.sh_addr;
+	}
+	sort(this->Ranges.begin(), this->Ranges.end());
+}
+bool ELFXref::IsInImage(unsigned long long address)
+{
+	auto found = upper_bound(this->Ranges.begin(), this->Ranges.end(), make_pair(address, ~0ULL));
+	if (found == this->Ranges.begin())
+		return false;
+	--found;
+	return address < found->second;
+}
+
+/*   Function and object symbols of both tables, sorted by address.   */
+void ELFXref::collectSymbols()
+{
+	XREF_SYMBOL entry;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		unsigned int type = this->image->SectionHeaders[i].sh_type;
+		if (type != SHT_SYMTAB && type != SHT_DYNSYM)
+			continue;
+
+		vector<Elf64_Sym> symbols;
+		this->image->readSymbols(i, symbols);
+		for (unsigned long long j = 0; j < symbols.size(); j++)
+		{
+			Elf64_Sym& symbol = symbols[j];
+			unsigned char kind = ELF64_ST_TYPE(symbol.st_info);
+			if ((kind != STT_FUNC && kind != STT_OBJECT && kind != STT_GNU_IFUNC) || symbol.st_shndx == SHN_UNDEF ||
+				symbol.st_shndx >= SHN_LORESERVE)
+				continue;
+
+			entry.name = this->image->GetSymbolName(i, symbol);
+			entry.address = symbol.st_value;
+			entry.size = symbol.st_size;
+			this->Symbols.push_back(entry);
+		}
+	}
+
+	sort(this->Symbols.begin(), this->Symbols.end(), [](const XREF_SYMBOL& a, const XREF_SYMBOL& b)
+	{
+		return (a.address != b.address) ? a.address < b.address : a.name < b.name;
+	});
+	this->Symbols.erase(unique(this->Symbols.begin(), this->Symbols.end(), [](const XREF_SYMBOL& a, const XREF_SYMBOL& b)
+	{
+		return a.address == b.address && a.name == b.name;
+	}), this->Symbols.end());
+}
+
+/*   Symbol plus offset of an address, the bare address outside any.   */
+string ELFXref::Describe(unsigned long long address)
+{
+	auto found = upper_bound(this->Symbols.begin(), this->Symbols.end(), address,
+		[](unsigned long long value, const XREF_SYMBOL& symbol)
+	{
+		return value < symbol.address;
+	});
+
+	// A few symbols back, in case a smaller one starts inside the one
+	// covering the address.
+	char text[32];
+	for (int i = 0; i < 16 && found != this->Symbols.begin(); i++)
+	{
+		--found;
+		unsigned long long offset = address - found->address;
+		if (offset >= max(found->size, 1ULL))
+			continue;
+		if (offset == 0)
+			return found->name;
+		snprintf(text, sizeof(text), "+0x%llx", offset);
+		return found->name + text;
+	}
+	return "";
+}
+
+/*   Splits the executable sections into 1MB chunks to decode and the data
+	sections that may hold pointers into chunks to read, pinning every
+	section here since the workers only read them.   */
+void ELFXref::collectUnits()
+{
+	const unsigned long long chunk = 1 << 20;
+	this->SectionData.assign(this->image->SectionHeaders.size(), NULL);
+
+	unsigned short machine = this->image->getMachine();
+	bool decodable = (machine == EM_X86_64 || machine == EM_386);
+
+	SCAN_UNIT unit;
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0 || section.sh_type == SHT_NOBITS || section.sh_size == 0)
+			continue;
+
+		bool code = (section.sh_flags & SHF_EXECINSTR) != 0;
+		string name = this->image->GetSectionName(i);
+		if (code == true && decodable == false)
+			continue;
+		// Symbol, hash, version and relocation tables hold no pointers, and
+		// unwind tables refer to every function.
+		if (code == false && ((section.sh_type != SHT_PROGBITS && section.sh_type != SHT_DYNAMIC &&
+			section.sh_type != SHT_INIT_ARRAY && section.sh_type != SHT_FINI_ARRAY &&
+			section.sh_type != SHT_PREINIT_ARRAY) || name.compare(0, 9, ".eh_frame") == 0 ||
+			name.compare(0, 17, ".gcc_except_table") == 0))
+			continue;
+
+		this->SectionData[i] = (const unsigned char*)this->image->pinSection(i);
+		if (this->SectionData[i] == NULL)
+			continue;
+
+		unit.section = i;
+		unit.code = code;
+		for (unsigned long long offset = 0; offset < section.sh_size; offset += chunk)
+		{
+			unit.offset = offset;
+			unit.size = min(chunk, section.sh_size - offset);
+			this->Units.push_back(unit);
+		}
+	}
+}
+
+/*   Appends a reference when the target lies in the image.   */
+void ELFXref::add(vector<XREF_ENTRY>& entries, unsigned long long target, unsigned long long source, ReferenceKind kind)
+{
+	if (IsInImage(target) == false)
+		return;
+
+	XREF_ENTRY entry;
+	entry.target = target;
+	entry.source = source;
+	entry.kind = kind;
+	entry.reserved = 0;
+	entries.push_back(entry);
+}
+
+/*   Linear sweep recording calls, near jumps, RIP relative operands,
+	absolute displacements and immediates. Short branches stay inside
+	their function and would only bloat the index.   */
+void ELFXref::scanCode(const SCAN_UNIT& unit, vector<XREF_ENTRY>& entries)
+{
+	const unsigned char* code = this->SectionData[unit.section] + unit.offset;
+	unsigned long long address = this->image->SectionHeaders[unit.section].sh_addr + unit.offset;
+	bool is64 = (this->image->getMachine() == EM_X86_64);
+
+	unsigned long long offset = 0;
+	while (offset < unit.size)
+	{
+		X86Decoder::X86_INSTRUCTION instruction;
+		if (X86Decoder::Decode(code + offset, unit.size - offset, is64, instruction) == false)
+		{
+			offset++;
+			continue;
+		}
+
+		const unsigned char* bytes = code + offset;
+		unsigned long long source = address + offset;
+		unsigned long long next = source + instruction.length;
+		offset += instruction.length;
+
+		if (instruction.relativeBranch == true)
+		{
+			unsigned long long target = next + X86Decoder::GetBranchDisplacement(bytes, instruction);
+			if (X86Decoder::IsCall(instruction) == true)
+			{
+				// call next is the i386 way of reading EIP.
+				if (target != next)
+					add(entries, target, source, CALL);
+			}
+			else if (instruction.immSize == 4)
+				add(entries, target, source, JUMP);
+			continue;
+		}
+
+		if (instruction.dispSize == 4)
+		{
+			int displacement;
+			memcpy(&displacement, bytes + instruction.dispOffset, 4);
+			if (instruction.ripRelative == true)
+				add(entries, next + displacement, source, RIP_RELATIVE);
+			else
+			{
+				add(entries, (unsigned int)displacement, source, ABSOLUTE);
+				if (is64 == false && this->gotAddress != 0 && (instruction.modrm >> 6) != 0)
+					add(entries, (unsigned int)(this->gotAddress + displacement), source, ABSOLUTE);
+			}
+		}
+
+		if (instruction.immSize == 4)
+		{
+			unsigned int immediate;
+			memcpy(&immediate, bytes + instruction.immOffset, 4);
+			add(entries, immediate, source, ABSOLUTE);
+		}
+		else if (instruction.immSize == 8)
+		{
+			unsigned long long immediate;
+			memcpy(&immediate, bytes + instruction.immOffset, 8);
+			add(entries, immediate, source, ABSOLUTE);
+		}
+	}
+}
+
+/*   Records every aligned pointer sized word that holds an address of the
+	image. Non PIE tables and RELR places already hold the final value.   */
+void ELFXref::scanData(const SCAN_UNIT& unit, vector<XREF_ENTRY>& entries)
+{
+	const unsigned char* data = this->SectionData[unit.section];
+	unsigned long long address = this->image->SectionHeaders[unit.section].sh_addr;
+
+	unsigned long long offset = unit.offset;
+	if ((address + offset) % this->wordSize != 0)
+		offset += this->wordSize - (address + offset) % this->wordSize;
+
+	for (; offset + this->wordSize <= unit.offset + unit.size; offset += this->wordSize)
+	{
+		unsigned long long value = 0;
+		memcpy(&value, data + offset, this->wordSize);
+		add(entries, value, address + offset, DATA_WORD);
+	}
+}
+
+/*   Records the place of every dynamic relocation against the address it
+	resolves to inside the image: the addend of relative ones, the symbol
+	of the others.   */
+void ELFXref::addRelocations(vector<XREF_ENTRY>& entries)
+{
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0 || (section.sh_type != SHT_REL && section.sh_type != SHT_RELA))
+			continue;
+
+		vector<Elf64_Rela> relocations;
+		if (this->image->readRelocations(i, relocations) == false)
+			continue;
+
+		vector<Elf64_Sym> symbols;
+		if (section.sh_link > 0 && section.sh_link < this->image->SectionHeaders.size())
+			this->image->readSymbols(section.sh_link, symbols);
+
+		for (unsigned long long j = 0; j < relocations.size(); j++)
+		{
+			Elf64_Rela& relocation = relocations[j];
+			unsigned long long index = ELF64_R_SYM(relocation.r_info);
+			unsigned long long target = relocation.r_addend;
+			if (index != 0)
+			{
+				if (index >= symbols.size() || symbols[index].st_shndx == SHN_UNDEF)
+					continue;
+				target += symbols[index].st_value;
+			}
+			add(entries, target, relocation.r_offset, RELOCATION);
+		}
+	}
+}
+
+/*   Maps the cached index when it was built from this very file.   */
+bool ELFXref::loadIndex()
+{
+	if (this->rebuild == true)
+		return false;
+
+	unsigned long long size = 0;
+	const char* payload = this->cache->load(size);
+	if (payload == NULL || size < sizeof(XREF_HEADER))
+		return false;
+
+	XREF_HEADER header;
+	memcpy(&header, payload, sizeof(header));
+	if (memcmp(header.magic, "ELFXREF1", 8) != 0 || header.count != (size - sizeof(header)) / sizeof(XREF_ENTRY))
+		return false;
+
+	this->Entries = (const XREF_ENTRY*)(payload + sizeof(header));
+	this->EntryCount = header.count;
+	return true;
+}
+
+/*   Scans code and data on the pool into per worker buffers, sorts the
+	references once by target and stores them in the cache.   */
+void ELFXref::buildIndex()
+{
+	collectUnits();
+
+	ThreadPool pool;
+	vector<vector<XREF_ENTRY> > buffers(pool.getThreadCount());
+	pool.parallelFor(this->Units.size(), [&](unsigned long long index, unsigned int worker)
+	{
+		if (this->Units[index].code == true)
+			scanCode(this->Units[index], buffers[worker]);
+		else
+			scanData(this->Units[index], buffers[worker]);
+	});
+
+	for (unsigned long long i = 0; i < this->SectionData.size(); i++)
+		this->image->unpin((const char*)this->SectionData[i]);
+	this->SectionData.clear();
+
+	unsigned long long total = 0;
+	for (unsigned long long i = 0; i < buffers.size(); i++)
+		total += buffers[i].size();
+	this->Built.reserve(total);
+	for (unsigned long long i = 0; i < buffers.size(); i++)
+	{
+		this->Built.insert(this->Built.end(), buffers[i].begin(), buffers[i].end());
+		vector<XREF_ENTRY>().swap(buffers[i]);
+	}
+	addRelocations(this->Built);
+
+	// A relocated word is seen both ways, keep the relocation.
+	sort(this->Built.begin(), this->Built.end(), [](const XREF_ENTRY& a, const XREF_ENTRY& b)
+	{
+		if (a.target != b.target)
+			return a.target < b.target;
+		return (a.source != b.source) ? a.source < b.source : a.kind < b.kind;
+	});
+	this->Built.erase(unique(this->Built.begin(), this->Built.end(), [](const XREF_ENTRY& a, const XREF_ENTRY& b)
+	{
+		return a.target == b.target && a.source == b.source;
+	}), this->Built.end());
+
+	this->Entries = this->Built.data();
+	this->EntryCount = this->Built.size();
+
+	vector<char> payload(sizeof(XREF_HEADER) + this->EntryCount * sizeof(XREF_ENTRY));
+	XREF_HEADER header;
+	memcpy(header.magic, "ELFXREF1", 8);
+	header.count = this->EntryCount;
+	memcpy(payload.data(), &header, sizeof(header));
+	if (this->EntryCount > 0)
+		memcpy(payload.data() + sizeof(header), this->Entries, this->EntryCount * sizeof(XREF_ENTRY));
+	if (this->cache->store(payload.data(), payload.size()) == true)
+		printf("Index of %llu references written to %s\n\n", this->EntryCount, this->cache->getPath().c_str());
+}
+
+/*   Address ranges a query stands for: a 0x address, every symbol of that
+	name, or every NUL terminated copy of the string in read-only data.   */
+bool ELFXref::ResolveQuery(string query, vector<pair<unsigned long long, unsigned long long> >& targets)
+{
+	if (query.compare(0, 2, "0x") == 0 || query.compare(0, 2, "0X") == 0)
+	{
+		char* end = NULL;
+		unsigned long long address = strtoull(query.c_str() + 2, &end, 16);
+		if (end != NULL && *end == '\0' && query.size() > 2)
+		{
+			targets.push_back(make_pair(address, address + 1));
+			return true;
+		}
+	}
+
+	for (unsigned long long i = 0; i < this->Symbols.size(); i++)
+	{
+		if (this->Symbols[i].name == query)
+			targets.push_back(make_pair(this->Symbols[i].address,
+				this->Symbols[i].address + max(this->Symbols[i].size, 1ULL)));
+	}
+	if (targets.empty() == false)
+		return true;
+
+	// String literals, tail merged copies included.
+	for (unsigned long long i = 0; i < this->image->SectionHeaders.size(); i++)
+	{
+		Elf64_Shdr& section = this->image->SectionHeaders[i];
+		if ((section.sh_flags & SHF_ALLOC) == 0 || (section.sh_flags & (SHF_WRITE | SHF_EXECINSTR)) != 0 ||
+			section.sh_type != SHT_PROGBITS || section.sh_size <= query.size())
+			continue;
+
+		const char* data = this->image->mapSection(i);
+		if (data == NULL)
+			continue;
+
+		const char* end = data + section.sh_size;
+		const char* found = data;
+		while ((found = (const char*)memmem(found, end - found, query.c_str(), query.size() + 1)) != NULL)
+		{
+			unsigned long long address = section.sh_addr + (found - data);
+			targets.push_back(make_pair(address, address + query.size() + 1));
+			found++;
+		}
+	}
+	return targets.empty() == false;
+}
+
+/*   Loads the index from the cache or builds it once, then answers the
+	query with a binary search over the references sorted by target.   */
+void ELFXref::readReferences(string query)
+{
+	if (IsReady() == false)
+	{
+		printf("ELF class not ready yet!\n");
+		return;
+	}
+
+	collectRanges();
+	collectSymbols();
+
+	vector<pair<unsigned long long, unsigned long long> > targets;
+	if (ResolveQuery(query, targets) == false)
+	{
+		printf("ELFXref: %s is neither an address, a symbol nor a string of the file!\n\n", query.c_str());
+		return;
+	}
+
+	if (loadIndex() == false)
+		buildIndex();
+
+	for (unsigned long long i = 0; i < targets.size(); i++)
+	{
+		unsigned long long low = targets[i].first, high = targets[i].second;
+		string name = Describe(low);
+		printf("References to 0x%llx%s%s%s:\n", low, name.empty() ? "" : " (", name.c_str(), name.empty() ? "" : ")");
+
+		const XREF_ENTRY* first = lower_bound(this->Entries, this->Entries + this->EntryCount, low,
+			[](const XREF_ENTRY& entry, unsigned long long value)
+		{
+			return entry.target < value;
+		});
+
+		unsigned long long count = 0;
+		for (const XREF_ENTRY* entry = first; entry < this->Entries + this->EntryCount && entry->target < high; entry++)
+		{
+			// Jumps between the blocks of a function are not references
+			//  to it, a recursive call to its start is.
+			if (entry->source >= low && entry->source < high && entry->target != low)
+				continue;
+
+			string source = Describe(entry->source);
+			if (entry->target != low)
+				printf("  0x%016llx\t%-12s\t%s -> +0x%llx\n", entry->source, GetKindName(entry->kind),
+					source.c_str(), entry->target - low);
+			else
+				printf("  0x%016llx\t%-12s\t%s\n", entry->source, GetKindName(entry->kind), source.c_str());
+			count++;
+		}
+		printf("  %llu references\n\n", count);
+	}
+}
@@ -0,0 +1,280 @@
+#include "stdafx.h"
+
+#ifndef HashFunctions_H
+#define HashFunctions_H
+/*   64 bit xxHash (XXH64), fast non-cryptographic content hash.   */
+class XXHash64
+{
+public:
+	static unsigned long long Digest(const void*, unsigned long long, unsigned long long = 0);
+	static unsigned long long Combine(const vector<unsigned long long>&, unsigned long long);
+private:
+	static const unsigned long long PRIME1 = 0x9E3779B185EBCA87ULL;
+	static const unsigned long long PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+	static const unsigned long long PRIME3 = 0x165667B19E3779F9ULL;
+	static const unsigned long long PRIME4 = 0x85EBCA77C2B2AE63ULL;
+	static const unsigned long long PRIME5 = 0x27D4EB2F165667C5ULL;
+
+	static unsigned long long Rotate(unsigned long long, int);
+	static unsigned long long Round(unsigned long long, unsigned long long);
+	static unsigned long long Merge(unsigned long long, unsigned long long);
+	static unsigned long long Read64(const unsigned char*);
+	static unsigned int Read32(const unsigned char*);
+};
+
+/*   SHA-256, for integrity checks that must match other tools.   */
+class SHA256
+{
+public:
+	SHA256();
+	void update(const void*, unsigned long long);
+	string final();
+private:
+	unsigned int state[8];
+	unsigned char buffer[64];
+	unsigned long long length = 0;
+	unsigned int buffered = 0;
+
+	void transform(const unsigned char*);
+};
+
+/*   Symbol name hashes of the dynamic loader tables.   */
+class SymbolHash
+{
+public:
+	static unsigned int GNU(const char*);
+	static unsigned int SysV(const char*);
+};
+#endif // !~ HashFunctions_H
+
+unsigned long long XXHash64::Rotate(unsigned long long value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+unsigned long long XXHash64::Round(unsigned long long accumulator, unsigned long long input)
+{
+	accumulator += input * PRIME2;
+	accumulator = Rotate(accumulator, 31);
+	return accumulator * PRIME1;
+}
+unsigned long long XXHash64::Merge(unsigned long long accumulator, unsigned long long value)
+{
+	accumulator ^= Round(0, value);
+	return accumulator * PRIME1 + PRIME4;
+}
+unsigned long long XXHash64::Read64(const unsigned char* p)
+{
+	unsigned long long value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+unsigned int XXHash64::Read32(const unsigned char* p)
+{
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/*   Hashes a buffer, 32 byte stripes over four independent lanes.   */
+unsigned long long XXHash64::Digest(const void* data, unsigned long long size, unsigned long long seed)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+	unsigned long long hash;
+
+	if (size >= 32)
+	{
+		unsigned long long v1 = seed + PRIME1 + PRIME2;
+		unsigned long long v2 = seed + PRIME2;
+		unsigned long long v3 = seed;
+		unsigned long long v4 = seed - PRIME1;
+
+		const unsigned char* limit = end - 32;
+		do
+		{
+			v1 = Round(v1, Read64(p));
+			v2 = Round(v2, Read64(p + 8));
+			v3 = Round(v3, Read64(p + 16));
+			v4 = Round(v4, Read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		hash = Rotate(v1, 1) + Rotate(v2, 7) + Rotate(v3, 12) + Rotate(v4, 18);
+		hash = Merge(hash, v1);
+		hash = Merge(hash, v2);
+		hash = Merge(hash, v3);
+		hash = Merge(hash, v4);
+	}
+	else
+		hash = seed + PRIME5;
+
+	hash += size;
+
+	for (; p + 8 <= end; p += 8)
+	{
+		hash ^= Round(0, Read64(p));
+		hash = Rotate(hash, 27) * PRIME1 + PRIME4;
+	}
+	if (p + 4 <= end)
+	{
+		hash ^= (unsigned long long)Read32(p) * PRIME1;
+		hash = Rotate(hash, 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+	for (; p < end; p++)
+	{
+		hash ^= (*p) * PRIME5;
+		hash = Rotate(hash, 11) * PRIME1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+/*   Combines the digests of consecutive chunks into one tree digest.   */
+unsigned long long XXHash64::Combine(const vector<unsigned long long>& digests, unsigned long long totalSize)
+{
+	if (digests.size() == 1)
+		return digests[0];
+
+	return XXHash64::Digest(digests.data(), digests.size() * sizeof(unsigned long long), totalSize);
+}
+
+static const unsigned int SHA256_ROUND[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*   Constructor, sets the initial hash values.   */
+SHA256::SHA256()
+{
+	const unsigned int initial[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+	memcpy(this->state, initial, sizeof(this->state));
+}
+
+/*   Compresses one 64 byte block into the state.   */
+void SHA256::transform(const unsigned char* block)
+{
+	unsigned int w[64];
+	for (int i = 0; i < 16; i++)
+		w[i] = (block[i * 4] << 24) | (block[i * 4 + 1] << 16) | (block[i * 4 + 2] << 8) | block[i * 4 + 3];
+
+	for (int i = 16; i < 64; i++)
+	{
+		unsigned int s0 = ((w[i - 15] >> 7) | (w[i - 15] << 25)) ^ ((w[i - 15] >> 18) | (w[i - 15] << 14)) ^ (w[i - 15] >> 3);
+		unsigned int s1 = ((w[i - 2] >> 17) | (w[i - 2] << 15)) ^ ((w[i - 2] >> 19) | (w[i - 2] << 13)) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	unsigned int a = state[0], b = state[1], c = state[2], d = state[3];
+	unsigned int e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for (int i = 0; i < 64; i++)
+	{
+		unsigned int S1 = ((e >> 6) | (e << 26)) ^ ((e >> 11) | (e << 21)) ^ ((e >> 25) | (e << 7));
+		unsigned int ch = (e & f) ^ (~e & g);
+		unsigned int t1 = h + S1 + ch + SHA256_ROUND[i] + w[i];
+		unsigned int S0 = ((a >> 2) | (a << 30)) ^ ((a >> 13) | (a << 19)) ^ ((a >> 22) | (a << 10));
+		unsigned int maj = (a & b) ^ (a & c) ^ (b & c);
+		unsigned int t2 = S0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/*   Adds bytes to the message.   */
+void SHA256::update(const void* data, unsigned long long size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	this->length += size;
+
+	// Finish a partially filled block first.
+	if (this->buffered > 0)
+	{
+		unsigned int take = 64 - this->buffered;
+		if (take > size)
+			take = size;
+
+		memcpy(this->buffer + this->buffered, p, take);
+		this->buffered += take;
+		p += take;
+		size -= take;
+
+		if (this->buffered < 64)
+			return;
+		transform(this->buffer);
+		this->buffered = 0;
+	}
+
+	for (; size >= 64; p += 64, size -= 64)
+		transform(p);
+
+	memcpy(this->buffer, p, size);
+	this->buffered = size;
+}
+
+/*   Pads the message and returns the digest as hex.   */
+string SHA256::final()
+{
+	unsigned long long bits = this->length * 8;
+
+	unsigned char padding[72] = { 0x80 };
+	unsigned int padLength = (this->buffered < 56) ? 56 - this->buffered : 120 - this->buffered;
+	update(padding, padLength);
+
+	unsigned char size[8];
+	for (int i = 0; i < 8; i++)
+		size[i] = (unsigned char)(bits >> (56 - i * 8));
+	update(size, 8);
+
+	char hex[65];
+	for (int i = 0; i < 8; i++)
+		snprintf(hex + i * 8, 9, "%08x", this->state[i]);
+	return string(hex, 64);
+}
+
+/*   Hash of .gnu.hash, Bernstein's h * 33 + c.   */
+unsigned int SymbolHash::GNU(const char* name)
+{
+	unsigned int hash = 5381;
+	for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++)
+		hash = hash * 33 + *p;
+	return hash;
+}
+
+/*   Hash of the System V .hash table.   */
+unsigned int SymbolHash::SysV(const char* name)
+{
+	unsigned int hash = 0;
+	for (const unsigned char* p = (const unsigned char*)name; *p != '\0'; p++)
+	{
+		hash = (hash << 4) + *p;
+		unsigned int high = hash & 0xf0000000;
+		if (high != 0)
+			hash ^= high >> 24;
+		hash &= ~high;
+	}
+	return hash;
+}
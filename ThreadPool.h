@@ -0,0 +1,78 @@
+#include "stdafx.h"
+
+#ifndef ThreadPool_H
+#define ThreadPool_H
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int = 0);
+	unsigned int getThreadCount();
+
+	/*   Runs task(index, worker) for every index in [0, count)   */
+	void parallelFor(unsigned long long, function<void(unsigned long long, unsigned int)>);
+
+	static void setDefaultThreads(unsigned int);
+private:
+	unsigned int threadCount;
+	static unsigned int defaultThreads;
+};
+#endif // !~ ThreadPool_H
+
+unsigned int ThreadPool::defaultThreads = 0;
+
+/*   Constructor with the number of workers, 0 uses the default.   */
+ThreadPool::ThreadPool(unsigned int threads)
+{
+	if (threads == 0)
+		threads = defaultThreads;
+	if (threads == 0)
+		threads = thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+
+	this->threadCount = threads;
+}
+
+/*   Number of workers used by parallelFor.   */
+unsigned int ThreadPool::getThreadCount()
+{
+	return this->threadCount;
+}
+
+/*   Hands out indexes to the workers one at a time, so uneven tasks
+	(small and large members, functions, chunks) stay balanced.   */
+void ThreadPool::parallelFor(unsigned long long count, function<void(unsigned long long, unsigned int)> task)
+{
+	unsigned int workers = this->threadCount;
+	if (workers > count)
+		workers = count;
+
+	// Not worth a thread for a single task.
+	if (workers <= 1)
+	{
+		for (unsigned long long i = 0; i < count; i++)
+			task(i, 0);
+		return;
+	}
+
+	atomic<unsigned long long> next(0);
+	vector<thread> threads;
+	for (unsigned int worker = 0; worker < workers; worker++)
+	{
+		threads.push_back(thread([&next, count, &task, worker]()
+		{
+			unsigned long long index;
+			while ((index = next.fetch_add(1)) < count)
+				task(index, worker);
+		}));
+	}
+
+	for (unsigned long long i = 0; i < threads.size(); i++)
+		threads[i].join();
+}
+
+/*   Sets the worker count used when none is given (--threads).   */
+void ThreadPool::setDefaultThreads(unsigned int threads)
+{
+	defaultThreads = threads;
+}
@@ -0,0 +1,592 @@
+#include "stdafx.h"
+
+#ifndef X86Decoder_H
+#define X86Decoder_H
+/*   Instruction length decoder for x86 and x86-64. It finds the prefixes,
+	opcode, ModRM, displacement and immediate of an instruction, which is
+	enough to walk code and to locate addresses embedded in it.   */
+class X86Decoder
+{
+public:
+	enum Encoding { LEGACY, VEX, EVEX, XOP };
+
+	/*   One decoded instruction.   */
+	typedef struct X86Instruction {
+		unsigned int length;			// Total length in bytes.
+		Encoding encoding;
+		unsigned int map;			// 0 one byte, 1 0F, 2 0F38, 3 0F3A, 8..10 XOP.
+		unsigned char opcode;
+		bool hasModRM;
+		unsigned char modrm;
+		unsigned char rex;			// REX byte, 0 when absent.
+		bool operandSize;			// 66 prefix (or VEX/EVEX pp = 66).
+		bool repz;				// F3 prefix (or pp = F3).
+		bool repnz;				// F2 prefix (or pp = F2).
+		unsigned int vectorLength;		// VEX/EVEX L, 0 for 128 bits.
+		unsigned int dispOffset, dispSize;	// Displacement within the instruction.
+		unsigned int immOffset, immSize;	// Immediate, also relative branch offsets.
+		bool ripRelative;			// Displacement is relative to the next instruction.
+		bool relativeBranch;			// Immediate is a branch displacement.
+	} X86_INSTRUCTION;
+
+	static bool Decode(const unsigned char*, unsigned long long, bool, X86_INSTRUCTION&);
+
+	/*   Branch helpers   */
+	static bool IsCall(const X86_INSTRUCTION&);
+	static bool IsReturn(const X86_INSTRUCTION&);
+	static long long GetBranchDisplacement(const unsigned char*, const X86_INSTRUCTION&);
+
+	/*   Instruction set extension an instruction belongs to, by opcode class.   */
+	enum Extension {
+		BASE, X87, MMX, SSE, SSE2, SSE3, SSSE3, SSE4_1, SSE4_2, POPCNT, LZCNT, MOVBE,
+		AVX, AVX2, FMA, F16C, BMI1, BMI2, AVX512, AVX512_FP16,
+		AES, SHA, ADX, RDRAND, TSX, XOP_AMD, EXTENSION_COUNT
+	};
+	static Extension GetExtension(const X86_INSTRUCTION&);
+	static const char* GetExtensionName(Extension);
+	static unsigned int GetExtensionLevel(Extension);
+private:
+	static unsigned int GetMandatoryPrefix(const X86_INSTRUCTION&);
+	static Extension GetLegacyExtension(const X86_INSTRUCTION&, unsigned int);
+	static Extension GetVexExtension(const X86_INSTRUCTION&, unsigned int);
+	static bool HasModRMLegacy(unsigned char);
+	static bool HasModRM0F(unsigned char);
+	static unsigned int GetImmediateSize(const X86_INSTRUCTION&, bool, bool);
+	static long long ReadSigned(const unsigned char*, unsigned int);
+};
+#endif // !~ X86Decoder_H
+
+/*   One byte opcodes followed by a ModRM byte.   */
+bool X86Decoder::HasModRMLegacy(unsigned char opcode)
+{
+	if (opcode < 0x40)
+		return (opcode & 0x04) == 0;
+	switch (opcode)
+	{
+		case 0x62: case 0x63: case 0x69: case 0x6B:
+		case 0xC0: case 0xC1: case 0xC4: case 0xC5: case 0xC6: case 0xC7:
+		case 0xD0: case 0xD1: case 0xD2: case 0xD3:
+		case 0xF6: case 0xF7: case 0xFE: case 0xFF:
+			return true;
+	}
+	return (opcode >= 0x80 && opcode <= 0x8F) || (opcode >= 0xD8 && opcode <= 0xDF);
+}
+
+/*   Two byte (0F xx) opcodes followed by a ModRM byte.   */
+bool X86Decoder::HasModRM0F(unsigned char opcode)
+{
+	switch (opcode)
+	{
+		case 0x04: case 0x05: case 0x06: case 0x07: case 0x08: case 0x09:
+		case 0x0A: case 0x0B: case 0x0C: case 0x0E:
+		case 0x77: case 0xA0: case 0xA1: case 0xA2: case 0xA8: case 0xA9: case 0xAA:
+			return false;
+	}
+	return !((opcode >= 0x30 && opcode <= 0x37) || (opcode >= 0x80 && opcode <= 0x8F) ||
+		(opcode >= 0xC8 && opcode <= 0xCF));
+}
+
+/*   Size of the immediate following the ModRM and displacement.   */
+unsigned int X86Decoder::GetImmediateSize(const X86_INSTRUCTION& instruction, bool is64, bool addressSize)
+{
+	unsigned char op = instruction.opcode;
+	unsigned int sizeZ = instruction.operandSize ? 2 : 4;
+	unsigned int reg = (instruction.modrm >> 3) & 7;
+
+	if (instruction.encoding == XOP)
+		return (instruction.map == 8) ? 1 : (instruction.map == 10) ? 4 : 0;
+
+	if (instruction.map == 3)
+		return 1;
+	if (instruction.map == 2 || instruction.map > 3)
+		return 0;
+
+	if (instruction.map == 1)
+	{
+		if (op >= 0x80 && op <= 0x8F)
+			return 4;
+		switch (op)
+		{
+			case 0x0F: case 0x70: case 0x71: case 0x72: case 0x73:
+			case 0xA4: case 0xAC: case 0xBA: case 0xC2: case 0xC4: case 0xC5: case 0xC6:
+				return 1;
+		}
+		return 0;
+	}
+
+	// One byte map.
+	if (op < 0x40 && (op & 0x07) == 0x04)
+		return 1;
+	if (op < 0x40 && (op & 0x07) == 0x05)
+		return sizeZ;
+	if ((op >= 0x70 && op <= 0x7F) || (op >= 0xB0 && op <= 0xB7) || (op >= 0xE0 && op <= 0xE7))
+		return 1;
+	if (op >= 0xB8 && op <= 0xBF)
+		return (instruction.rex & 0x08) ? 8 : sizeZ;
+	if (op >= 0xA0 && op <= 0xA3)
+		return is64 ? (addressSize ? 4 : 8) : (addressSize ? 2 : 4);
+
+	switch (op)
+	{
+		case 0x6A: case 0x6B: case 0x80: case 0x82: case 0x83: case 0xA8:
+		case 0xC0: case 0xC1: case 0xC6: case 0xCD: case 0xD4: case 0xD5: case 0xEB:
+			return 1;
+		case 0x68: case 0x69: case 0x81: case 0xA9: case 0xC7:
+			return sizeZ;
+		case 0xE8: case 0xE9:
+			return is64 ? 4 : sizeZ;
+		case 0xC2: case 0xCA:
+			return 2;
+		case 0xC8:
+			return 3;
+		case 0x9A: case 0xEA:
+			return sizeZ + 2;
+		case 0xF6:
+			return (reg <= 1) ? 1 : 0;
+		case 0xF7:
+			return (reg <= 1) ? sizeZ : 0;
+	}
+	return 0;
+}
+
+/*   Reads a little endian signed value of 1, 2, 4 or 8 bytes.   */
+long long X86Decoder::ReadSigned(const unsigned char* p, unsigned int size)
+{
+	switch (size)
+	{
+		case 1:
+			return (signed char)p[0];
+		case 2:
+		{
+			short value;
+			memcpy(&value, p, 2);
+			return value;
+		}
+		case 4:
+		{
+			int value;
+			memcpy(&value, p, 4);
+			return value;
+		}
+		case 8:
+		{
+			long long value;
+			memcpy(&value, p, 8);
+			return value;
+		}
+	}
+	return 0;
+}
+
+/*   Decodes the instruction at code, false when it is truncated or
+	longer than the 15 byte limit.   */
+bool X86Decoder::Decode(const unsigned char* code, unsigned long long available, bool is64, X86_INSTRUCTION& instruction)
+{
+	memset(&instruction, 0, sizeof(instruction));
+	instruction.encoding = LEGACY;
+
+	unsigned long long limit = (available < 15) ? available : 15;
+	unsigned int i = 0;
+	bool addressSize = false;
+
+	// Legacy prefixes, in any order.
+	for (; i < limit; i++)
+	{
+		unsigned char b = code[i];
+		if (b == 0x66)
+			instruction.operandSize = true;
+		else if (b == 0x67)
+			addressSize = true;
+		else if (b == 0xF3)
+			instruction.repz = true;
+		else if (b == 0xF2)
+			instruction.repnz = true;
+		else if (b != 0xF0 && b != 0x2E && b != 0x36 && b != 0x3E && b != 0x26 && b != 0x64 && b != 0x65)
+			break;
+	}
+
+	// REX only counts right before the opcode.
+	if (is64 == true && i < limit && (code[i] & 0xF0) == 0x40)
+		instruction.rex = code[i++];
+	if (i >= limit)
+		return false;
+
+	unsigned char b = code[i];
+
+	// VEX, EVEX and XOP reuse opcodes that need a register ModRM in 32 bit mode.
+	bool extended = (i + 1 < limit) && (is64 == true || (code[i + 1] & 0xC0) == 0xC0);
+	if ((b == 0xC4 || b == 0xC5 || b == 0x62) && extended == true && instruction.rex == 0)
+	{
+		unsigned int pp;
+		if (b == 0xC5)
+		{
+			if (i + 2 >= limit)
+				return false;
+			instruction.encoding = VEX;
+			instruction.map = 1;
+			pp = code[i + 1] & 3;
+			instruction.vectorLength = (code[i + 1] >> 2) & 1;
+			i += 2;
+		}
+		else if (b == 0xC4)
+		{
+			if (i + 3 >= limit)
+				return false;
+			instruction.encoding = VEX;
+			instruction.map = code[i + 1] & 0x1F;
+			pp = code[i + 2] & 3;
+			instruction.vectorLength = (code[i + 2] >> 2) & 1;
+			instruction.rex = 0x40 | ((code[i + 2] & 0x80) ? 0x08 : 0);
+			i += 3;
+		}
+		else
+		{
+			if (i + 4 >= limit)
+				return false;
+			instruction.encoding = EVEX;
+			instruction.map = code[i + 1] & 0x07;
+			pp = code[i + 2] & 3;
+			instruction.vectorLength = (code[i + 3] >> 5) & 3;
+			instruction.rex = 0x40 | ((code[i + 2] & 0x80) ? 0x08 : 0);
+			i += 4;
+		}
+
+		instruction.operandSize = (pp == 1);
+		instruction.repz = (pp == 2);
+		instruction.repnz = (pp == 3);
+		// EVEX adds maps 5 and 6 (FP16), VEX stops at 3.
+		if (instruction.map < 1 || instruction.map == 4 || instruction.map > (instruction.encoding == EVEX ? 6 : 3))
+			return false;
+
+		instruction.opcode = code[i++];
+		instruction.hasModRM = (instruction.encoding == EVEX || instruction.opcode != 0x77 || instruction.map != 1);
+	}
+	else if (b == 0x8F && i + 1 < limit && (code[i + 1] & 0x1F) >= 8)
+	{
+		if (i + 3 >= limit)
+			return false;
+		instruction.encoding = XOP;
+		instruction.map = code[i + 1] & 0x1F;
+		instruction.vectorLength = (code[i + 2] >> 2) & 1;
+		i += 3;
+		instruction.opcode = code[i++];
+		instruction.hasModRM = true;
+	}
+	else if (b == 0x0F)
+	{
+		if (i + 1 >= limit)
+			return false;
+		if (code[i + 1] == 0x38 || code[i + 1] == 0x3A)
+		{
+			if (i + 2 >= limit)
+				return false;
+			instruction.map = (code[i + 1] == 0x38) ? 2 : 3;
+			instruction.opcode = code[i + 2];
+			instruction.hasModRM = true;
+			i += 3;
+		}
+		else
+		{
+			instruction.map = 1;
+			instruction.opcode = code[i + 1];
+			instruction.hasModRM = HasModRM0F(instruction.opcode);
+			i += 2;
+		}
+	}
+	else
+	{
+		instruction.map = 0;
+		instruction.opcode = b;
+		instruction.hasModRM = HasModRMLegacy(b);
+		i++;
+	}
+
+	if (instruction.hasModRM == true)
+	{
+		if (i >= limit)
+			return false;
+		instruction.modrm = code[i++];
+
+		unsigned int mod = instruction.modrm >> 6;
+		unsigned int rm = instruction.modrm & 7;
+
+		if (mod != 3)
+		{
+			// 16 bit addressing only exists outside 64 bit mode.
+			if (is64 == false && addressSize == true)
+			{
+				if (mod == 1)
+					instruction.dispSize = 1;
+				else if (mod == 2 || (mod == 0 && rm == 6))
+					instruction.dispSize = 2;
+			}
+			else
+			{
+				if (rm == 4)
+				{
+					if (i >= limit)
+						return false;
+					unsigned char sib = code[i++];
+					if (mod == 0 && (sib & 7) == 5)
+						instruction.dispSize = 4;
+				}
+				else if (mod == 0 && rm == 5)
+				{
+					instruction.dispSize = 4;
+					instruction.ripRelative = is64;
+				}
+
+				if (mod == 1)
+					instruction.dispSize = 1;
+				else if (mod == 2)
+					instruction.dispSize = 4;
+			}
+		}
+
+		instruction.dispOffset = i;
+		i += instruction.dispSize;
+	}
+
+	instruction.immSize = GetImmediateSize(instruction, is64, addressSize);
+	instruction.immOffset = i;
+	i += instruction.immSize;
+
+	if (instruction.encoding == LEGACY)
+	{
+		unsigned char op = instruction.opcode;
+		instruction.relativeBranch = (instruction.map == 0 && ((op >= 0x70 && op <= 0x7F) ||
+			(op >= 0xE0 && op <= 0xE3) || op == 0xE8 || op == 0xE9 || op == 0xEB)) ||
+			(instruction.map == 1 && op >= 0x80 && op <= 0x8F);
+	}
+
+	if (i > limit)
+		return false;
+
+	instruction.length = i;
+	return true;
+}
+
+/*   Direct or indirect call.   */
+bool X86Decoder::IsCall(const X86_INSTRUCTION& instruction)
+{
+	if (instruction.encoding != LEGACY || instruction.map != 0)
+		return false;
+
+	if (instruction.opcode == 0xE8)
+		return true;
+	return instruction.opcode == 0xFF && ((instruction.modrm >> 3) & 7) == 2;
+}
+
+/*   Near or far return.   */
+bool X86Decoder::IsReturn(const X86_INSTRUCTION& instruction)
+{
+	if (instruction.encoding != LEGACY || instruction.map != 0)
+		return false;
+
+	unsigned char op = instruction.opcode;
+	return op == 0xC3 || op == 0xC2 || op == 0xCB || op == 0xCA;
+}
+
+/*   Signed displacement of a relative branch, from the next instruction.   */
+long long X86Decoder::GetBranchDisplacement(const unsigned char* code, const X86_INSTRUCTION& instruction)
+{
+	if (instruction.relativeBranch == false)
+		return 0;
+
+	return ReadSigned(code + instruction.immOffset, instruction.immSize);
+}
+
+/*   Mandatory prefix of an SSE/VEX opcode: 0 none, 1 66, 2 F3, 3 F2.   */
+unsigned int X86Decoder::GetMandatoryPrefix(const X86_INSTRUCTION& instruction)
+{
+	if (instruction.repnz == true)
+		return 3;
+	if (instruction.repz == true)
+		return 2;
+	return instruction.operandSize ? 1 : 0;
+}
+
+/*   Extension of a legacy encoded instruction.   */
+X86Decoder::Extension X86Decoder::GetLegacyExtension(const X86_INSTRUCTION& instruction, unsigned int prefix)
+{
+	unsigned char op = instruction.opcode;
+	unsigned int reg = (instruction.modrm >> 3) & 7;
+	bool registerForm = (instruction.modrm >> 6) == 3;
+
+	if (instruction.map == 0)
+	{
+		if (op >= 0xD8 && op <= 0xDF)
+			return X87;
+		// XBEGIN and XABORT.
+		if ((op == 0xC7 || op == 0xC6) && instruction.modrm == 0xF8)
+			return TSX;
+		return BASE;
+	}
+
+	if (instruction.map == 1)
+	{
+		if (op == 0x01 && (instruction.modrm == 0xD5 || instruction.modrm == 0xD6))
+			return TSX;
+		if (op == 0xC7 && registerForm == true && (reg == 6 || reg == 7))
+			return RDRAND;
+		if (prefix == 2 && op == 0xB8)
+			return POPCNT;
+		if (prefix == 2 && op == 0xBD)
+			return LZCNT;
+		if (prefix == 2 && op == 0xBC)
+			return BMI1;
+
+		bool simd = (op >= 0x10 && op <= 0x17) || (op >= 0x28 && op <= 0x2F) || (op >= 0x50 && op <= 0x7F) ||
+			(op >= 0xC2 && op <= 0xC6) || op >= 0xD0;
+		if (simd == false)
+			return BASE;
+
+		bool floating = (op >= 0x10 && op <= 0x17) || (op >= 0x28 && op <= 0x2F) || (op >= 0x50 && op <= 0x5F) ||
+			op == 0xC2 || op == 0xC6;
+		switch (prefix)
+		{
+			case 0:
+				return floating ? SSE : MMX;
+			case 1:
+				return (op == 0xD0 || op == 0x7C || op == 0x7D) ? SSE3 : SSE2;
+			case 2:
+				if (op == 0x12 || op == 0x16)
+					return SSE3;
+				return (op == 0x10 || op == 0x11 || op == 0x2A || op == 0x2C || op == 0x2D ||
+					(op >= 0x51 && op <= 0x53) || (op >= 0x58 && op <= 0x5F && op != 0x5A && op != 0x5B) ||
+					op == 0xC2) ? SSE : SSE2;
+			default:
+				return (op == 0x12 || op == 0x7C || op == 0x7D || op == 0xD0 || op == 0xF0) ? SSE3 : SSE2;
+		}
+	}
+
+	if (instruction.map == 2)
+	{
+		if (op == 0xF0 || op == 0xF1)
+			return (prefix == 3) ? SSE4_2 : MOVBE;
+		if (op == 0xF6 && (prefix == 1 || prefix == 2))
+			return ADX;
+		if (op >= 0xC8 && op <= 0xCD)
+			return SHA;
+		if (op >= 0xDB && op <= 0xDF)
+			return AES;
+		if (op <= 0x0B || (op >= 0x1C && op <= 0x1E))
+			return SSSE3;
+		if (op == 0x37)
+			return SSE4_2;
+		return SSE4_1;
+	}
+
+	// Map 3, 0F 3A.
+	if (op == 0x0F)
+		return SSSE3;
+	if (op >= 0x60 && op <= 0x63)
+		return SSE4_2;
+	if (op == 0x44 || op == 0xDF)
+		return AES;
+	if (op == 0xCC)
+		return SHA;
+	return SSE4_1;
+}
+
+/*   Extension of a VEX encoded instruction. Integer operations widened to
+	256 bits and the gathers, broadcasts and permutes are AVX2.   */
+X86Decoder::Extension X86Decoder::GetVexExtension(const X86_INSTRUCTION& instruction, unsigned int prefix)
+{
+	unsigned char op = instruction.opcode;
+	bool wide = instruction.vectorLength != 0;
+
+	if (instruction.map == 1)
+	{
+		bool integer = prefix == 1 && ((op >= 0x60 && op <= 0x7F && op != 0x7C && op != 0x7D) ||
+			(op >= 0xD1 && op != 0xE6 && op != 0xF0));
+		return (integer == true && wide == true) ? AVX2 : AVX;
+	}
+
+	if (instruction.map == 2)
+	{
+		// General purpose register forms.
+		if (prefix != 1 && op >= 0xF2 && op <= 0xF7)
+			return (op == 0xF2 || op == 0xF3 || (op == 0xF7 && prefix == 0)) ? BMI1 : BMI2;
+		if (op >= 0x96 && op <= 0xBF)
+			return FMA;
+		if (op == 0x13)
+			return F16C;
+		if (op >= 0xDB && op <= 0xDF)
+			return AES;
+		switch (op)
+		{
+			case 0x16: case 0x36: case 0x45: case 0x46: case 0x47: case 0x58: case 0x59: case 0x5A:
+			case 0x78: case 0x79: case 0x8C: case 0x8E: case 0x90: case 0x91: case 0x92: case 0x93:
+				return AVX2;
+		}
+		bool integer = op <= 0x0B || (op >= 0x1C && op <= 0x1E) || (op >= 0x20 && op <= 0x25) ||
+			(op >= 0x28 && op <= 0x2B) || (op >= 0x30 && op <= 0x40);
+		return (integer == true && wide == true) ? AVX2 : AVX;
+	}
+
+	// Map 3.
+	if (prefix == 3 && op == 0xF0)
+		return BMI2;
+	if (op == 0x1D)
+		return F16C;
+	if (op == 0x44 || op == 0xDF)
+		return AES;
+	switch (op)
+	{
+		case 0x00: case 0x01: case 0x02: case 0x38: case 0x39: case 0x46:
+			return AVX2;
+	}
+	bool integer = op == 0x0E || op == 0x0F || (op >= 0x14 && op <= 0x16) || op == 0x20 || op == 0x22 ||
+		op == 0x42 || op == 0x4C;
+	return (integer == true && wide == true) ? AVX2 : AVX;
+}
+
+/*   Extension an instruction needs. Sub-features of AVX-512 are folded
+	together, telling them apart needs the EVEX payload per opcode.   */
+X86Decoder::Extension X86Decoder::GetExtension(const X86_INSTRUCTION& instruction)
+{
+	unsigned int prefix = GetMandatoryPrefix(instruction);
+	switch (instruction.encoding)
+	{
+		case LEGACY:
+			return GetLegacyExtension(instruction, prefix);
+		case VEX:
+			return GetVexExtension(instruction, prefix);
+		case EVEX:
+			return (instruction.map >= 5) ? AVX512_FP16 : AVX512;
+		case XOP:
+			return XOP_AMD;
+	}
+	return BASE;
+}
+
+/*   Printable extension name.   */
+const char* X86Decoder::GetExtensionName(Extension extension)
+{
+	static const char* names[EXTENSION_COUNT] = {
+		"base", "x87", "MMX", "SSE", "SSE2", "SSE3", "SSSE3", "SSE4.1", "SSE4.2", "POPCNT", "LZCNT", "MOVBE",
+		"AVX", "AVX2", "FMA", "F16C", "BMI1", "BMI2", "AVX-512", "AVX-512 FP16",
+		"AES/PCLMUL", "SHA", "ADX", "RDRAND", "TSX", "XOP"
+	};
+	return names[extension];
+}
+
+/*   x86-64 psABI level that includes the extension: 1 baseline, 2 to 4 for
+	x86-64-v2 to v4, 5 for extensions no level includes.   */
+unsigned int X86Decoder::GetExtensionLevel(Extension extension)
+{
+	switch (extension)
+	{
+		case BASE: case X87: case MMX: case SSE: case SSE2:
+			return 1;
+		case SSE3: case SSSE3: case SSE4_1: case SSE4_2: case POPCNT:
+			return 2;
+		case AVX: case AVX2: case FMA: case F16C: case BMI1: case BMI2: case LZCNT: case MOVBE:
+			return 3;
+		case AVX512:
+			return 4;
+		default:
+			return 5;
+	}
+}
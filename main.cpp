@@ -1,4 +1,28 @@
 #include "ELFReader.h"
+#include "ELFEntropy.h"
+#include "ELFHardening.h"
+#include "ELFBatch.h"
+#include "ELFCore.h"
+#include "ELFArchive.h"
+#include "ELFSearch.h"
+#include "ELFStrings.h"
+#include "ELFHash.h"
+#include "ELFSize.h"
+#include "ELFDiff.h"
+#include "ELFFingerprint.h"
+#include "ELFFolding.h"
+#include "ELFGroups.h"
+#include "ELFRelocator.h"
+#include "ELFLayout.h"
+#include "ELFHotText.h"
+#include "ELFRelr.h"
+#include "ELFHashStats.h"
+#include "ELFIsa.h"
+#include "ELFAlignment.h"
+#include "ELFUnreferenced.h"
+#include "ELFCallGraph.h"
+#include "ELFXref.h"
+#include "ELFUnwind.h"
 
 #include "HexReader.h"
 
@@ -26,8 +50,35 @@ void HelpTable()
 	printf("-a, --all\t\t\t\tPrints out all headers\n");
 	printf("-S, --section-headers\t\t\tPrints out all section headers\n");
 	printf("-s, --section %%index || %%name\t\tPrints out specific section header\n");
-	printf("-F, --functions\t\t\t\tPrints out all symbols\n");
+	printf("-F, --functions\t\t\t\tPrints out all symbols (of every member for archives)\n");
 	printf("-f, --function %%name\t\t\tPrints out specific symbol\n");
+	printf("--grep [--regex] %%pattern %%filename\tSearches symbols by glob or regular expression\n");
+	printf("--strings [-n %%min] [--utf16] [--section %%name] %%filename\n\t\t\t\t\tPrints printable strings per section\n");
+	printf("--hash-sections [--sha256] %%filename\tPrints content hashes of every section and segment\n");
+	printf("--entropy [--window %%bytes] %%filename\tPrints section entropy and a window profile\n");
+	printf("--size [--demangle] [-n %%count] %%filename\tAttributes bytes to segments, sections and symbols\n");
+	printf("--diff [--content] %%old %%new\t\tCompares sections, segments, dynamic entries and symbols\n");
+	printf("--fingerprint %%filename [%%new]\t\tPrints function fingerprints, or the functions changed in %%new\n");
+	printf("--icf [-n %%count] %%files\t\t\tFinds identical functions linker ICF could fold\n");
+	printf("--groups [--demangle] [-n %%count] %%paths\tTotals duplicated COMDAT groups of object files\n");
+	printf("--relocate [--base %%address] [--section %%name] %%filename\n\t\t\t\t\tApplies the relocations of an object file\n");
+	printf("--layout [--page-size %%bytes] %%filename\tPrints page footprint and huge page fit of load segments\n");
+	printf("--hot-text [-n %%count] [--order %%output] %%profile %%filename\n\t\t\t\t\tMaps samples to functions and projects hot text pages\n");
+	printf("--relr %%filename\t\t\tEstimates the savings of packing relative relocations as RELR\n");
+	printf("--hash-stats %%filename [%%importers]\tPrints .gnu.hash and .hash quality and simulated lookups\n");
+	printf("--hardening %%filename\t\t\tPrints RELRO, canary, NX, PIE, fortify and CET properties\n");
+	printf("--isa [--baseline %%level] [-n %%count] %%filename\n\t\t\t\t\tCounts instruction set extensions per function\n");
+	printf("--alignment [-n %%count] %%filename\tPrints function alignment, padding and cache line crossings\n");
+	printf("--unreferenced [-n %%count] %%filename\tLists local functions no code, data or relocation refers to\n");
+	printf("--call-graph [-n %%count] [--output %%file] %%filename\n\t\t\t\t\tExtracts direct calls into a compressed sparse row file\n");
+	printf("--xref [--rebuild] %%target %%filename\tLists references to an address, symbol or string, indexed once\n");
+	printf("--eh-frame [--functions | --lookup %%address] %%filename\n\t\t\t\t\tDecodes unwind tables, function extents or the FDE of an address\n");
+	printf("--archive %%filename\t\t\tPrints members and symbol index of an archive\n");
+	printf("-C, --core %%filename\t\t\tPrints threads, process info and mapped files of a core\n");
+	printf("-m, --memory %%address %%size %%filename\tPrints memory of a core at a virtual address\n");
+	printf("--max-map %%bytes[K|M|G]\t\t\tLimits the bytes mapped at once (default 512M)\n");
+	printf("--threads %%count\t\t\tWorker threads for parallel modes (default all cores)\n");
+	printf("-B, --batch [--physical-order] %%option %%files\tRuns -a, -S, -F, --entropy or --hardening over many files\n");
 
 	printf("\nCopyrights to ramb0 (c) 2019-2020\n\n");
 }
@@ -50,6 +101,41 @@ bool isNumber(string str)
 
 int main(int argc, char* argv[])
 {
+	// Strip global options first, so the option checks below keep working.
+	int kept = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--max-map")
+		{
+			unsigned long long budget;
+			if (i + 1 >= argc || ELFMapping::parseSize(argv[i + 1], budget) == false)
+			{
+				printf("Usage: ELFReader --max-map %%bytes[K|M|G] ...\n\n");
+				return -1;
+			}
+
+			ELFMapping::setMaxMap(budget);
+			i++;
+			continue;
+		}
+		else if (arg == "--threads")
+		{
+			if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+			{
+				printf("Usage: ELFReader --threads %%count ...\n\n");
+				return -1;
+			}
+
+			ThreadPool::setDefaultThreads(atoi(argv[i + 1]));
+			i++;
+			continue;
+		}
+
+		argv[kept++] = argv[i];
+	}
+	argc = kept;
+
 	if (argc < 2)
 	{
 		printf("Usage: ELFReader [-A] [-S] [-F] [-E] [-P] %%filename\n");
@@ -115,10 +201,540 @@ int main(int argc, char* argv[])
 				return -1;
 			}
 
+			// Archives are parsed member by member.
+			if (ELFArchive::IsArchive(argv[i + 1]) == true)
+			{
+				ELFArchive archive(argv[i + 1]);
+				archive.readAllSymbols();
+				return 0;
+			}
+
 			ELFReader reader(argv[i +1]);
 			reader.readAllSymbols();
 			return 0;
 		}
+		else if (arg == "--grep")
+		{
+			// Glob by default, extended regular expression with --regex.
+			bool isRegex = (argc == 5 && string(argv[i + 1]) == "--regex");
+			if (argc != 4 && isRegex == false)
+			{
+				printf("Usage: ELFReader --grep [--regex] %%pattern %%filename\n\n");
+				return -1;
+			}
+
+			int next = isRegex ? i + 2 : i + 1;
+			ELFSearch search(argv[next + 1], argv[next], isRegex);
+			search.readMatches();
+			return 0;
+		}
+		else if (arg == "--strings")
+		{
+			if (argc < 3)
+			{
+				printf("Usage: ELFReader --strings [-n %%min] [--utf16] [--section %%name] %%filename\n\n");
+				return -1;
+			}
+
+			ELFStrings strings(argv[argc - 1]);
+			for (int j = i + 1; j < argc - 1; j++)
+			{
+				string option = argv[j];
+				if (option == "-n" && j + 1 < argc - 1)
+					strings.setMinimumLength(atoi(argv[++j]));
+				else if (option == "--utf16")
+					strings.setUTF16(true);
+				else if (option == "--section" && j + 1 < argc - 1)
+					strings.addSection(argv[++j]);
+				else
+				{
+					printf("Unknown argument/option combination: %s\n\n", option.c_str());
+					return -1;
+				}
+			}
+
+			strings.readStrings();
+			return 0;
+		}
+		else if (arg == "--hash-sections")
+		{
+			bool withSHA = (argc == 4 && string(argv[i + 1]) == "--sha256");
+			if (argc != 3 && withSHA == false)
+			{
+				printf("Usage: ELFReader --hash-sections [--sha256] %%filename\n\n");
+				return -1;
+			}
+
+			ELFHash hash(argv[argc - 1]);
+			hash.setSHA256(withSHA);
+			hash.readHashes();
+			return 0;
+		}
+		else if (arg == "--entropy")
+		{
+			bool withWindow = (argc == 5 && string(argv[i + 1]) == "--window");
+			if (argc != 3 && withWindow == false)
+			{
+				printf("Usage: ELFReader --entropy [--window %%bytes] %%filename\n\n");
+				return -1;
+			}
+
+			ELFEntropy entropy(argv[argc - 1]);
+			if (withWindow == true)
+				entropy.setWindowSize(atoi(argv[i + 2]));
+			entropy.readProfile();
+			return 0;
+		}
+		else if (arg == "--size")
+		{
+			if (argc < 3)
+			{
+				printf("Usage: ELFReader --size [--demangle] [-n %%count] %%filename\n\n");
+				return -1;
+			}
+
+			ELFSize size(argv[argc - 1]);
+			for (int j = i + 1; j < argc - 1; j++)
+			{
+				string option = argv[j];
+				if (option == "--demangle")
+					size.setDemangle(true);
+				else if (option == "-n" && j + 1 < argc - 1)
+					size.setTopCount(atoi(argv[++j]));
+				else
+				{
+					printf("Unknown argument/option combination: %s\n\n", option.c_str());
+					return -1;
+				}
+			}
+
+			size.readSizes();
+			return 0;
+		}
+		else if (arg == "--diff")
+		{
+			// --content also matches renamed functions by their bytes.
+			bool withContent = (argc == 5 && string(argv[i + 1]) == "--content");
+			if (argc != 4 && withContent == false)
+			{
+				printf("Usage: ELFReader --diff [--content] %%old %%new\n\n");
+				return -1;
+			}
+
+			ELFDiff diff(argv[argc - 2], argv[argc - 1]);
+			diff.setContentMatching(withContent);
+			diff.readDiff();
+			return 0;
+		}
+		else if (arg == "--fingerprint")
+		{
+			if (argc != 3 && argc != 4)
+			{
+				printf("Usage: ELFReader --fingerprint %%filename [%%new]\n\n");
+				return -1;
+			}
+
+			ELFFingerprint before(argv[i + 1]);
+			if (argc == 3)
+			{
+				before.readFingerprints();
+				return 0;
+			}
+
+			ELFFingerprint after(argv[i + 2]);
+			ELFFingerprint::CompareBuilds(before, after);
+			return 0;
+		}
+		else if (arg == "--icf")
+		{
+			int next = i + 1;
+			unsigned int count = 20;
+			if (next + 1 < argc && string(argv[next]) == "-n")
+			{
+				count = atoi(argv[next + 1]);
+				next += 2;
+			}
+
+			if (next >= argc)
+			{
+				printf("Usage: ELFReader --icf [-n %%count] %%files\n\n");
+				return -1;
+			}
+
+			vector<string> files;
+			for (int j = next; j < argc; j++)
+				files.push_back(argv[j]);
+
+			ELFFolding folding(files);
+			folding.setTopCount(count);
+			folding.readCandidates();
+			return 0;
+		}
+		else if (arg == "--groups")
+		{
+			int next = i + 1;
+			unsigned int count = 20;
+			bool demangle = false;
+			for (; next < argc; next++)
+			{
+				string option = argv[next];
+				if (option == "--demangle")
+					demangle = true;
+				else if (option == "-n" && next + 1 < argc)
+					count = atoi(argv[++next]);
+				else
+					break;
+			}
+
+			if (next >= argc)
+			{
+				printf("Usage: ELFReader --groups [--demangle] [-n %%count] %%paths\n\n");
+				return -1;
+			}
+
+			vector<string> paths;
+			for (int j = next; j < argc; j++)
+				paths.push_back(argv[j]);
+
+			ELFGroups groups(paths);
+			groups.setTopCount(count);
+			groups.setDemangle(demangle);
+			groups.readGroups();
+			return 0;
+		}
+		else if (arg == "--relocate")
+		{
+			int next = i + 1;
+			unsigned long long base = 0;
+			string sectionName;
+			for (; next < argc; next++)
+			{
+				string option = argv[next];
+				if (option == "--base" && next + 1 < argc)
+					base = strtoull(argv[++next], NULL, 0);
+				else if (option == "--section" && next + 1 < argc)
+					sectionName = argv[++next];
+				else
+					break;
+			}
+
+			if (next + 1 != argc)
+			{
+				printf("Usage: ELFReader --relocate [--base %%address] [--section %%name] %%filename\n\n");
+				return -1;
+			}
+
+			ELFRelocator relocator(argv[next]);
+			relocator.setBaseAddress(base);
+			relocator.readRelocated(sectionName);
+			return 0;
+		}
+		else if (arg == "--layout")
+		{
+			int next = i + 1;
+			unsigned long long pageSize = 4096;
+			if (next + 1 < argc && string(argv[next]) == "--page-size")
+			{
+				pageSize = strtoull(argv[next + 1], NULL, 0);
+				next += 2;
+			}
+
+			if (next + 1 != argc || pageSize == 0 || (pageSize & (pageSize - 1)) != 0)
+			{
+				printf("Usage: ELFReader --layout [--page-size %%bytes] %%filename\n\n");
+				return -1;
+			}
+
+			ELFLayout layout(argv[next]);
+			layout.setPageSize(pageSize);
+			layout.readLayout();
+			return 0;
+		}
+		else if (arg == "--hot-text")
+		{
+			int next = i + 1;
+			unsigned int count = 20;
+			string orderFile;
+			for (; next < argc; next++)
+			{
+				string option = argv[next];
+				if (option == "-n" && next + 1 < argc)
+					count = atoi(argv[++next]);
+				else if (option == "--order" && next + 1 < argc)
+					orderFile = argv[++next];
+				else
+					break;
+			}
+
+			if (next + 2 != argc)
+			{
+				printf("Usage: ELFReader --hot-text [-n %%count] [--order %%output] %%profile %%filename\n\n");
+				return -1;
+			}
+
+			ELFHotText hotText(argv[next + 1]);
+			hotText.setTopCount(count);
+			hotText.setOrderFile(orderFile);
+			if (hotText.readProfile(argv[next]) == false)
+				return -1;
+			hotText.readHotText();
+			return 0;
+		}
+		else if (arg == "--relr")
+		{
+			if (argc != 3)
+			{
+				printf("Usage: ELFReader --relr %%filename\n\n");
+				return -1;
+			}
+
+			ELFRelr relr(argv[i + 1]);
+			relr.readSavings();
+			return 0;
+		}
+		else if (arg == "--hash-stats")
+		{
+			if (argc < 3)
+			{
+				printf("Usage: ELFReader --hash-stats %%filename [%%importers]\n\n");
+				return -1;
+			}
+
+			ELFHashStats stats(argv[i + 1]);
+			for (int j = i + 2; j < argc; j++)
+				stats.addImporter(argv[j]);
+			stats.readStats();
+			return 0;
+		}
+		else if (arg == "--hardening")
+		{
+			if (argc != 3)
+			{
+				printf("Usage: ELFReader --hardening %%filename\n\n");
+				return -1;
+			}
+
+			ELFHardening hardening(argv[i + 1]);
+			hardening.readHardening();
+			return 0;
+		}
+		else if (arg == "--isa")
+		{
+			int next = i + 1;
+			unsigned int count = 20, baseline = 1;
+			bool valid = true;
+			for (; next < argc; next++)
+			{
+				string option = argv[next];
+				if (option == "--baseline" && next + 1 < argc)
+					valid = ELFIsa::ParseBaseline(argv[++next], baseline) && valid;
+				else if (option == "-n" && next + 1 < argc)
+					count = atoi(argv[++next]);
+				else
+					break;
+			}
+
+			if (next + 1 != argc || valid == false)
+			{
+				printf("Usage: ELFReader --isa [--baseline x86-64|x86-64-v2|x86-64-v3|x86-64-v4] [-n %%count] %%filename\n\n");
+				return -1;
+			}
+
+			ELFIsa isa(argv[next]);
+			isa.setBaseline(baseline);
+			isa.setTopCount(count);
+			isa.readCensus();
+			return 0;
+		}
+		else if (arg == "--alignment")
+		{
+			int next = i + 1;
+			unsigned int count = 10;
+			if (next + 1 < argc && string(argv[next]) == "-n")
+			{
+				count = atoi(argv[next + 1]);
+				next += 2;
+			}
+
+			if (next + 1 != argc)
+			{
+				printf("Usage: ELFReader --alignment [-n %%count] %%filename\n\n");
+				return -1;
+			}
+
+			ELFAlignment alignment(argv[next]);
+			alignment.setTopCount(count);
+			alignment.readAlignment();
+			return 0;
+		}
+		else if (arg == "--unreferenced")
+		{
+			int next = i + 1;
+			unsigned int count = 20;
+			if (next + 1 < argc && string(argv[next]) == "-n")
+			{
+				count = atoi(argv[next + 1]);
+				next += 2;
+			}
+
+			if (next + 1 != argc)
+			{
+				printf("Usage: ELFReader --unreferenced [-n %%count] %%filename\n\n");
+				return -1;
+			}
+
+			ELFUnreferenced unreferenced(argv[next]);
+			unreferenced.setTopCount(count);
+			unreferenced.readUnreferenced();
+			return 0;
+		}
+		else if (arg == "--call-graph")
+		{
+			int next = i + 1;
+			unsigned int count = 10;
+			string outputFile;
+			for (; next < argc; next++)
+			{
+				string option = argv[next];
+				if (option == "-n" && next + 1 < argc)
+					count = atoi(argv[++next]);
+				else if (option == "--output" && next + 1 < argc)
+					outputFile = argv[++next];
+				else
+					break;
+			}
+
+			if (next + 1 != argc)
+			{
+				printf("Usage: ELFReader --call-graph [-n %%count] [--output %%file] %%filename\n\n");
+				return -1;
+			}
+
+			ELFCallGraph callGraph(argv[next]);
+			callGraph.setTopCount(count);
+			callGraph.setOutputFile(outputFile);
+			callGraph.readCallGraph();
+			return 0;
+		}
+		else if (arg == "--xref")
+		{
+			int next = i + 1;
+			bool rebuild = false;
+			if (next < argc && string(argv[next]) == "--rebuild")
+			{
+				rebuild = true;
+				next++;
+			}
+
+			if (next + 2 != argc)
+			{
+				printf("Usage: ELFReader --xref [--rebuild] %%symbol|%%address|%%string %%filename\n\n");
+				return -1;
+			}
+
+			ELFXref xref(argv[next + 1]);
+			xref.setRebuild(rebuild);
+			xref.readReferences(argv[next]);
+			return 0;
+		}
+		else if (arg == "--eh-frame")
+		{
+			int next = i + 1;
+			bool functions = false, lookup = false;
+			unsigned long long address = 0;
+			if (next < argc && string(argv[next]) == "--functions")
+			{
+				functions = true;
+				next++;
+			}
+			else if (next + 1 < argc && string(argv[next]) == "--lookup")
+			{
+				lookup = true;
+				address = strtoull(argv[next + 1], NULL, 16);
+				next += 2;
+			}
+
+			if (next + 1 != argc)
+			{
+				printf("Usage: ELFReader --eh-frame [--functions | --lookup %%address] %%filename\n\n");
+				return -1;
+			}
+
+			ELFUnwind unwind(argv[next]);
+			if (functions == true)
+				unwind.readFunctions();
+			else if (lookup == true)
+				unwind.readLookup(address);
+			else
+				unwind.readUnwind();
+			return 0;
+		}
+		else if (arg == "--archive")
+		{
+			if (argc != 3)
+			{
+				printf("Usage: ELFReader --archive %%filename\n\n");
+				return -1;
+			}
+
+			ELFArchive archive(argv[i + 1]);
+			archive.readIndex();
+			return 0;
+		}
+		else if (arg == "-C" || arg == "--core")
+		{
+			if (argc != 3)
+			{
+				printf("Usage: ELFReader -C %%filename\n\n");
+				return -1;
+			}
+
+			ELFCore core(argv[i + 1]);
+			core.readCore();
+			return 0;
+		}
+		else if (arg == "-m" || arg == "--memory")
+		{
+			if (argc != 5)
+			{
+				printf("Usage: ELFReader -m %%address %%size %%filename\n\n");
+				return -1;
+			}
+
+			unsigned long long address = strtoull(argv[i + 1], NULL, 0);
+			unsigned long long size = strtoull(argv[i + 2], NULL, 0);
+
+			ELFCore core(argv[i + 3]);
+			core.readMemory(address, size);
+			return 0;
+		}
+		else if (arg == "-B" || arg == "--batch")
+		{
+			// Optional ordering flag before the command option.
+			bool physicalOrder = false;
+			int next = i + 1;
+			if (next < argc && string(argv[next]) == "--physical-order")
+			{
+				physicalOrder = true;
+				next++;
+			}
+
+			if (argc - next < 2)
+			{
+				printf("Usage: ELFReader -B [--physical-order] %%option %%files\n\n");
+				return -1;
+			}
+
+			string command = argv[next];
+			vector<string> files;
+			for (int j = next + 1; j < argc; j++)
+				files.push_back(argv[j]);
+
+			ELFBatch batch(command, files);
+			batch.setPhysicalOrder(physicalOrder);
+			batch.run();
+			return 0;
+		}
 		else
 		{
 			printf("Unknown argument/option combination: %s\n\n", arg.c_str());
@@ -13,5 +13,35 @@
 #include <fstream> // File I/O
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+#include <functional>
+#include <thread> // Worker threads
+#include <atomic>
+#include <mutex>
+#include <ctype.h>
+#include <math.h>
+#include <cxxabi.h>
+#include <ar.h> // Static archives
+#include <fnmatch.h> // Symbol search
+#include <regex>
+#ifdef __SSE2__
+#include <emmintrin.h> // Vectorized scans
+#endif
+
+#include <elf.h> // ELF structures
+#include <sys/stat.h>
+#include <sys/mman.h> // Mapped file access
+
+#include <fcntl.h> // Batch I/O ordering
+#include <unistd.h>
+#include <dirent.h> // Directory scans
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
 
 using namespace std;